@@ -1,34 +1,86 @@
 #include <iostream>
+#include "LoopParallelization.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Passes/PassPlugin.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/Delinearization.h"
 #include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/IVDescriptors.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/LoopIterator.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
 #include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/Analysis/VectorUtils.h"
+#include "llvm/ADT/bit.h"
+#include "llvm/Frontend/OpenMP/OMPIRBuilder.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/PatternMatch.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/identity.hpp>
+#include <boost/container_hash/hash.hpp>
+#include <map>
+#include <unordered_set>
 #include <utility>
 #include <algorithm>
 
 using namespace llvm;
 
+#define DEBUG_TYPE "loop-parallelization"
+
+/*
+ * The verdicts are reported as optimization remarks. The bounds, accesses, dependences and verdicts of the analysis can
+ * also be printed as text, which is slow on big modules, since every access is printed.
+ */
+static cl::opt<bool> DumpAnalysis("loop-parallelization-dump", cl::Hidden, cl::init(false),
+                                  cl::desc("Print the loop bounds, array accesses, dependences and verdicts of loop-parallelization"));
+
+static cl::opt<unsigned> ExactTestBudget("loop-parallelization-exact-budget", cl::Hidden, cl::init(1u << 20),
+                                         cl::desc("Work allowed to the exact dependence test of a pair of accesses, "
+                                                  "0 disables the test"));
+
+static cl::opt<unsigned> OmegaBudget("loop-parallelization-omega-budget", cl::Hidden, cl::init(200000),
+                                     cl::desc("Constraints the Omega test may build for the dependence problems of one "
+                                              "loop, 0 disables the test"));
+
+static cl::opt<unsigned> WavefrontTile("loop-parallelization-wavefront-tile", cl::Hidden, cl::init(32),
+                                       cl::desc("Side of the tiles the OpenMP transform runs as wavefronts in loop nests "
+                                                "whose loops all carry dependences, 0 disables wavefronts"));
+
+/*
+ * Values taken by the induction variable of a loop. For a loop with a runtime trip count, symbolicUpperBound is the
+ * upper bound as a SCEV, and upperBound, if known, only a maximum of it.
+ */
 struct Bounds {
     bool isKnown;
-    int lowerBound;
-    int upperBound;
+    int64_t lowerBound;
+    int64_t upperBound;
+    const SCEV *symbolicUpperBound = nullptr;
 };
 
 struct IndexAccess {
     Bounds bounds;
-    int coef;
+    int64_t coef;
 };
 
 struct ArrayIndexAccess {
     bool isKnown;
-    int freeCoef;
+    int64_t freeCoef;
     std::vector<IndexAccess> linearCombination;
 };
 
@@ -36,9 +88,99 @@ struct ArrayAccess {
     Value* baseAccess;
     bool type; // true - read ; false - write
     std::vector<ArrayIndexAccess> arrayIndexAccesses;
+    bool isReduction = false; // load or store of a memory reduction
+    Instruction* instruction = nullptr; // first load or store with this signature, where remarks are reported
+};
+
+struct ArrayAccessHash {
+    std::size_t operator()(const ArrayAccess& arrayAccess) const {
+        std::size_t seed = 0;
+        boost::hash_combine(seed, arrayAccess.baseAccess);
+        boost::hash_combine(seed, arrayAccess.type);
+        boost::hash_combine(seed, arrayAccess.isReduction);
+        for (const ArrayIndexAccess& arrayIndexAccess : arrayAccess.arrayIndexAccesses) {
+            boost::hash_combine(seed, arrayIndexAccess.isKnown);
+            boost::hash_combine(seed, arrayIndexAccess.freeCoef);
+            for (const IndexAccess& indexAccess : arrayIndexAccess.linearCombination)
+                boost::hash_combine(seed, indexAccess.coef);
+        }
+        return seed;
+    }
+};
+
+struct ArrayAccessEqual {
+    bool operator()(const ArrayAccess& access1, const ArrayAccess& access2) const {
+        if (access1.baseAccess != access2.baseAccess || access1.type != access2.type ||
+            access1.isReduction != access2.isReduction ||
+            access1.arrayIndexAccesses.size() != access2.arrayIndexAccesses.size())
+            return false;
+        for (int index = 0; index < access1.arrayIndexAccesses.size(); ++index) {
+            const ArrayIndexAccess& indexAccess1 = access1.arrayIndexAccesses[index];
+            const ArrayIndexAccess& indexAccess2 = access2.arrayIndexAccesses[index];
+            if (indexAccess1.isKnown != indexAccess2.isKnown || indexAccess1.freeCoef != indexAccess2.freeCoef ||
+                indexAccess1.linearCombination.size() != indexAccess2.linearCombination.size())
+                return false;
+            for (int i = 0; i < indexAccess1.linearCombination.size(); ++i) {
+                if (indexAccess1.linearCombination[i].coef != indexAccess2.linearCombination[i].coef)
+                    return false;
+            }
+        }
+        return true;
+    }
+};
+
+struct byBase {};
+struct bySignature {};
+
+/*
+ * The accesses of a loop body in program order, hashed by base pointer so that only accesses to the same array
+ * are paired up. Accesses with the same base, type and subscripts cannot be told apart by the dependence tests,
+ * so they are stored once.
+ */
+typedef boost::multi_index::multi_index_container<
+        ArrayAccess,
+        boost::multi_index::indexed_by<
+                boost::multi_index::sequenced<>,
+                boost::multi_index::hashed_non_unique<
+                        boost::multi_index::tag<byBase>,
+                        boost::multi_index::member<ArrayAccess, Value*, &ArrayAccess::baseAccess> >,
+                boost::multi_index::hashed_unique<
+                        boost::multi_index::tag<bySignature>,
+                        boost::multi_index::identity<ArrayAccess>, ArrayAccessHash, ArrayAccessEqual>
+        >
+> ArrayAccessSet;
+
+using Direction = LoopParallelismInfo::Direction;
+using Distance = LoopParallelismInfo::Distance;
+using DependenceVector = LoopParallelismInfo::DependenceVector;
+
+struct Dependence {
+    const ArrayAccess* access1;
+    const ArrayAccess* access2;
+    std::vector<DependenceVector> dependenceVectors;
 };
 
 namespace {
+    thread_local raw_ostream *ReportStream = nullptr;
+}
+
+raw_ostream& loopParallelizationReport() {
+    return ReportStream ? *ReportStream : errs();
+}
+
+void setLoopParallelizationReport(raw_ostream *OS) {
+    ReportStream = OS;
+}
+
+void setLoopParallelizationDumpDefault(bool Dump) {
+    DumpAnalysis.setInitialValue(Dump);
+}
+
+namespace {
+    raw_ostream& report() {
+        return loopParallelizationReport();
+    }
+
     std::string getLoopHeaderAsString(const Loop* L) {
         std::string headerStr;
         raw_string_ostream rso(headerStr);
@@ -46,32 +188,88 @@ namespace {
         return headerStr;
     }
 
-    std::string extractEquation(const SCEV *S, ScalarEvolution &SE) {
-        if (!S)
-            return "UnknownExpr";
+    /*
+     * a += b * c, or false if it overflows. The affine forms and the tests are computed in 64 bits, and whatever
+     * overflows is treated as unknown.
+     */
+    bool checkedMulAdd(int64_t& a, int64_t b, int64_t c) {
+        int64_t product;
+        return !__builtin_mul_overflow(b, c, &product) && !__builtin_add_overflow(a, product, &a);
+    }
+
+    ArrayIndexAccess unknownArrayIndexAccess() {
+        return {false, 0, std::vector<IndexAccess>()};
+    }
+
+    ArrayIndexAccess constantArrayIndexAccess(int64_t value, const std::vector<Bounds>& bounds) {
+        ArrayIndexAccess arrayIndexAccess;
+        arrayIndexAccess.isKnown = true;
+        arrayIndexAccess.freeCoef = value;
+        arrayIndexAccess.linearCombination = std::vector<IndexAccess>(bounds.size());
+        for (int i = 0; i < bounds.size(); ++i)
+            arrayIndexAccess.linearCombination[i] = {bounds[i], 0};
+        return arrayIndexAccess;
+    }
 
+    /*
+     * Add scale * S to the affine form of an array index. The coefficient of an add recurrence goes to the
+     * position of its loop in the nest (outermost loop first), so only loops enclosing L are accepted.
+     * Return false if S is not an affine combination of the enclosing induction variables, or if a coefficient does not
+     * fit in 64 bits.
+     */
+    bool accumulateAffineTerms(const SCEV *S, int64_t scale, const Loop *L, ScalarEvolution &SE, ArrayIndexAccess& arrayIndexAccess) {
         if (const auto *C = dyn_cast<SCEVConstant>(S)) {
-            return std::to_string(C->getAPInt().getSExtValue());
+            return C->getAPInt().isSignedIntN(64) &&
+                   checkedMulAdd(arrayIndexAccess.freeCoef, scale, C->getAPInt().getSExtValue());
         }
 
         if (const auto *AddRec = dyn_cast<SCEVAddRecExpr>(S)) {
-            if (const auto *C = dyn_cast<SCEVConstant>(AddRec->getStepRecurrence(SE))) {
-                std::string Start = extractEquation(AddRec->getStart(), SE);
-                std::string Step = extractEquation(AddRec->getStepRecurrence(SE), SE);
-                std::string LoopVar = getLoopHeaderAsString(AddRec->getLoop());
-                if (Start == "UnknownExpr" || Step == "UnknownExpr" || LoopVar == "UnknownExpr")
-                    return "UnknownExpr";
-                return Start + " + " + Step + " * " + LoopVar;
-            } else {
-                return "UnknownExpr";
+            const auto *Step = dyn_cast<SCEVConstant>(AddRec->getStepRecurrence(SE));
+            const Loop *AddRecLoop = AddRec->getLoop();
+            if (!AddRec->isAffine() || !Step || !AddRecLoop->contains(L) || !Step->getAPInt().isSignedIntN(64))
+                return false;
+            int loopIndex = AddRecLoop->getLoopDepth() - 1;
+            if (!checkedMulAdd(arrayIndexAccess.linearCombination[loopIndex].coef, scale, Step->getAPInt().getSExtValue()))
+                return false;
+            return accumulateAffineTerms(AddRec->getStart(), scale, L, SE, arrayIndexAccess);
+        }
+
+        if (const auto *Add = dyn_cast<SCEVAddExpr>(S)) {
+            for (const SCEV *Op : Add->operands()) {
+                if (!accumulateAffineTerms(Op, scale, L, SE, arrayIndexAccess))
+                    return false;
             }
+            return true;
+        }
+
+        if (const auto *Mul = dyn_cast<SCEVMulExpr>(S)) {
+            // Constants are folded into the first operand of a canonical multiplication.
+            const auto *C = dyn_cast<SCEVConstant>(Mul->getOperand(0));
+            int64_t factor;
+            if (!C || Mul->getNumOperands() != 2 || !C->getAPInt().isSignedIntN(64) ||
+                __builtin_mul_overflow(scale, C->getAPInt().getSExtValue(), &factor))
+                return false;
+            return accumulateAffineTerms(Mul->getOperand(1), factor, L, SE, arrayIndexAccess);
         }
 
         if (const auto *SExt = dyn_cast<SCEVSignExtendExpr>(S)) {
-            return extractEquation(SExt->getOperand(), SE);
+            return accumulateAffineTerms(SExt->getOperand(), scale, L, SE, arrayIndexAccess);
+        }
+
+        // Optimized IR extends nonnegative indices with zext, which is a sext for them.
+        if (const auto *ZExt = dyn_cast<SCEVZeroExtendExpr>(S)) {
+            return SE.isKnownNonNegative(ZExt->getOperand()) &&
+                   accumulateAffineTerms(ZExt->getOperand(), scale, L, SE, arrayIndexAccess);
         }
 
-        return "UnknownExpr";
+        return false;
+    }
+
+    ArrayIndexAccess extractArrayIndexAccess(const SCEV *S, const Loop *L, const std::vector<Bounds>& bounds, ScalarEvolution &SE) {
+        ArrayIndexAccess arrayIndexAccess = constantArrayIndexAccess(0, bounds);
+        if (!accumulateAffineTerms(S, 1, L, SE, arrayIndexAccess))
+            return unknownArrayIndexAccess();
+        return arrayIndexAccess;
     }
 
     ArrayType* extractTopLevelArrayType(Value *V) {
@@ -97,234 +295,872 @@ namespace {
         return dims;
     }
 
-    void processGEPOperator(GEPOperator *GEPOp, ScalarEvolution &SE, std::vector<std::string>& accesses, int& totalDims) {
-        Type *targetTy = GEPOp->getSourceElementType();
-        int dims = countArrayDimensions(targetTy);
-
-        if (auto *InnerGEPOp = dyn_cast<GEPOperator>(GEPOp->getPointerOperand())) {
-            processGEPOperator(InnerGEPOp, SE, accesses, totalDims);
+    /*
+     * Subscripts of an access to a global or stack array of type arrayTy, read from the indices of the GEPs between the
+     * base and the pointer. A GEP whose source element type is one of the nested array types of arrayTy steps over
+     * elements of that type with its first index: the dimensions above it that the chain has not indexed yet are 0, and
+     * the first index is the subscript of the dimension of those elements. Return false if the chain does not have that
+     * form (byte offsets, a first index stepping over the arrays the previous GEP indexed into, another element type, or
+     * an access that is not one element of the array), so that the subscripts are recovered from the SCEV of the pointer.
+     */
+    bool extractGEPIndexAccesses(Value *ptrOperand, Type *accessTy, Value *base, ArrayType *arrayTy, const Loop *L,
+                                 const std::vector<Bounds>& bounds, ScalarEvolution &SE,
+                                 std::vector<ArrayIndexAccess>& accesses) {
+        SmallVector<GEPOperator*, 4> chain;
+        Value *V = ptrOperand->stripPointerCasts();
+        // Covers both GEP instructions and constant GEP expressions.
+        while (auto *GEPOp = dyn_cast<GEPOperator>(V)) {
+            chain.push_back(GEPOp);
+            V = GEPOp->getPointerOperand()->stripPointerCasts();
         }
+        if (V != base)
+            return false;
 
-        int toAdd = totalDims - dims;
-        while (toAdd > 0) {
-            accesses.push_back("0");
-            toAdd--;
+        // types[d] is the type of the elements of dimension d - 1, types[0] the whole array.
+        SmallVector<Type*, 4> types = {arrayTy};
+        while (auto *T = dyn_cast<ArrayType>(types.back()))
+            types.push_back(T->getElementType());
+        int totalDims = types.size() - 1;
+        for (GEPOperator *GEPOp : reverse(chain)) {
+            int depth = std::find(types.begin(), types.end(), GEPOp->getSourceElementType()) - types.begin();
+            if (depth < accesses.size() || depth > totalDims || depth + GEPOp->getNumIndices() - 1 > totalDims)
+                return false;
+            auto *First = dyn_cast<ConstantInt>(GEPOp->getOperand(1));
+            if (depth == accesses.size() && (!First || !First->isZero()))
+                return false;
+            while (accesses.size() + 1 < depth)
+                accesses.push_back(constantArrayIndexAccess(0, bounds));
+            if (depth > accesses.size())
+                accesses.push_back(extractArrayIndexAccess(SE.getSCEV(GEPOp->getOperand(1)), L, bounds, SE));
+            for (unsigned idx = 2; idx < GEPOp->getNumOperands(); ++idx)
+                accesses.push_back(extractArrayIndexAccess(SE.getSCEV(GEPOp->getOperand(idx)), L, bounds, SE));
         }
+        while (accesses.size() < totalDims)
+            accesses.push_back(constantArrayIndexAccess(0, bounds));
+        const DataLayout &DL = L->getHeader()->getModule()->getDataLayout();
+        return DL.getTypeStoreSize(accessTy) == DL.getTypeAllocSize(types.back());
+    }
 
-        totalDims = dims;
-
-        for (unsigned idx = 2; idx < GEPOp->getNumOperands(); ++idx) {
-            Value *IndexVal = GEPOp->getOperand(idx);
-            const SCEV *IndexScev = SE.getSCEV(IndexVal);
-            accesses.push_back(extractEquation(IndexScev, SE));
-            totalDims--;
+    /*
+     * Offset of ptrOperand from base in elements of elementSize bytes, as an affine form over the induction variables of
+     * L and its parents, from the SCEV of the pointer. Return false if it is not affine or not a whole number of elements.
+     */
+    bool extractElementOffset(Value *ptrOperand, Value *base, uint64_t elementSize, const Loop *L,
+                              const std::vector<Bounds>& bounds, ScalarEvolution &SE, ArrayIndexAccess& offset) {
+        const SCEV *Offset = SE.getMinusSCEV(SE.getSCEV(ptrOperand), SE.getSCEV(base));
+        if (isa<SCEVCouldNotCompute>(Offset) || elementSize == 0 || elementSize > INT64_MAX)
+            return false;
+        offset = extractArrayIndexAccess(Offset, L, bounds, SE);
+        if (!offset.isKnown)
+            return false;
+        int64_t size = elementSize;
+        if (offset.freeCoef % size != 0)
+            return false;
+        offset.freeCoef /= size;
+        for (IndexAccess& indexAccess : offset.linearCombination) {
+            if (indexAccess.coef % size != 0)
+                return false;
+            indexAccess.coef /= size;
         }
+        return true;
     }
 
-    void extractGEPIndices(GetElementPtrInst *GEP, ScalarEvolution &SE, std::vector<std::string>& accesses, int& totalDims) {
-        Type *targetTy = GEP->getSourceElementType();
-        int dims = countArrayDimensions(targetTy);
-        if (auto *GEPOp = dyn_cast<GEPOperator>(GEP->getPointerOperand())) {
-            processGEPOperator(GEPOp, SE, accesses, totalDims);
+    /*
+     * Split the offset of an access, in elements, into the subscripts of the dimensions of arrayTy, innermost first.
+     * The remainder of every coefficient by the size of the dimension (the one closest to 0) stays in the dimension and
+     * the quotient goes to the next one out; the constant is placed so that the subscript is within the dimension for all
+     * the iterations, by the bounds of the loops. A subscript of every inner dimension in [0, size - 1] makes the split
+     * the only one there is, so it is exact. Return false if a subscript cannot be proven to stay within its dimension.
+     */
+    bool delinearizeElementOffset(const ArrayIndexAccess& offset, ArrayType *arrayTy, const std::vector<Bounds>& bounds,
+                                  std::vector<ArrayIndexAccess>& accesses) {
+        std::vector<int64_t> sizes;
+        for (Type *ty = arrayTy; auto *T = dyn_cast<ArrayType>(ty); ty = T->getElementType()) {
+            if (T->getNumElements() == 0 || T->getNumElements() > INT64_MAX)
+                return false;
+            sizes.push_back(T->getNumElements());
         }
-
-        int toAdd = totalDims - dims;
-        while (toAdd > 0) {
-            accesses.push_back("0");
-            toAdd--;
+        ArrayIndexAccess rest = offset;
+        accesses = std::vector<ArrayIndexAccess>(sizes.size());
+        for (int d = sizes.size() - 1; d > 0; --d) {
+            int64_t size = sizes[d];
+            ArrayIndexAccess subscript = constantArrayIndexAccess(0, bounds);
+            int64_t low = 0, high = 0;
+            for (int level = 0; level < bounds.size(); ++level) {
+                int64_t coef = rest.linearCombination[level].coef;
+                int64_t remainder = coef % size;
+                if (remainder < 0)
+                    remainder += size;
+                if (remainder > size / 2)
+                    remainder -= size;
+                if (__builtin_sub_overflow(coef, remainder, &coef))
+                    return false;
+                subscript.linearCombination[level].coef = remainder;
+                rest.linearCombination[level].coef = coef / size;
+                if (remainder == 0)
+                    continue;
+                if (!bounds[level].isKnown || !checkedMulAdd(remainder > 0 ? high : low, remainder,
+                                                             std::max<int64_t>(bounds[level].upperBound, 0)))
+                    return false;
+            }
+            // The smallest constant congruent to the free coefficient that keeps the subscript nonnegative.
+            int64_t remainder = rest.freeCoef % size;
+            if (remainder < 0)
+                remainder += size;
+            int64_t lowest = -low, freeCoef;
+            int64_t shift = (remainder - lowest % size) % size;
+            if (shift < 0)
+                shift += size;
+            if (__builtin_add_overflow(lowest, shift, &freeCoef) || __builtin_add_overflow(freeCoef, high, &high) ||
+                high > size - 1 || __builtin_sub_overflow(rest.freeCoef, freeCoef, &rest.freeCoef))
+                return false;
+            subscript.freeCoef = freeCoef;
+            rest.freeCoef /= size;
+            accesses[d] = subscript;
         }
+        accesses[0] = rest;
+        return true;
+    }
 
-        totalDims = dims;
+    /*
+     * Subscripts of an access to a global or stack array, from the indices of its GEPs, or from the SCEV of the pointer
+     * for optimized IR, where instcombine turns constant offsets into i8 GEPs and GEPs on pointers to inner arrays. The
+     * subscripts that cannot be recovered are unknown.
+     */
+    std::vector<ArrayIndexAccess> extractArrayIndexAccesses(Value* ptrOperand, Type *accessTy, Value *base, const Loop *L,
+                                                            const std::vector<Bounds>& bounds, ScalarEvolution &SE) {
+        auto *arrayTy = extractTopLevelArrayType(base);
+        std::vector<ArrayIndexAccess> accesses;
+        if (extractGEPIndexAccesses(ptrOperand, accessTy, base, arrayTy, L, bounds, SE, accesses))
+            return accesses;
 
-        for (unsigned idx = 2; idx < GEP->getNumOperands(); ++idx) {
-            Value *IndexVal = GEP->getOperand(idx);
-            const SCEV *IndexScev = SE.getSCEV(IndexVal);
-            accesses.push_back(extractEquation(IndexScev, SE));
-            totalDims--;
-        }
+        Type *elementTy = arrayTy;
+        while (auto *T = dyn_cast<ArrayType>(elementTy))
+            elementTy = T->getElementType();
+        const DataLayout &DL = L->getHeader()->getModule()->getDataLayout();
+        ArrayIndexAccess offset;
+        if (DL.getTypeStoreSize(accessTy) == DL.getTypeAllocSize(elementTy) &&
+            extractElementOffset(ptrOperand, base, DL.getTypeAllocSize(elementTy), L, bounds, SE, offset) &&
+            delinearizeElementOffset(offset, arrayTy, bounds, accesses))
+            return accesses;
+        return std::vector<ArrayIndexAccess>(countArrayDimensions(arrayTy), unknownArrayIndexAccess());
     }
 
-    std::vector<std::string> extractArrayIndexAccess(Value* ptrOperand, ScalarEvolution &SE, int& totalDims, bool print = false) {
-        std::vector<std::string> accesses;
-        if (auto *GEP = dyn_cast<GetElementPtrInst>(ptrOperand)) {
-            extractGEPIndices(GEP, SE, accesses, totalDims);
-        } else if (auto *GEPConst = dyn_cast<ConstantExpr>(ptrOperand)) {
-            if (GEPConst->getOpcode() == Instruction::GetElementPtr) {
-                Instruction *TempGEP = GEPConst->getAsInstruction();
-                extractGEPIndices(cast<GetElementPtrInst>(TempGEP), SE, accesses, totalDims);
-                TempGEP->deleteValue();
-            }
-        }
-        while (totalDims > 0) {
-            accesses.push_back("0");
-            totalDims--;
-        }
-        if (print) {
-            for (const auto &access : accesses)
-                errs() << "  Accessing index: " << access << "\n";
-        }
-        return accesses;
-    }
+    /*
+     * Largest maximum of a symbolic bound that is used. It also bounds the bisection of findBoundGuard.
+     */
+    constexpr int64_t maxSymbolicBound = int64_t(1) << 32;
 
+    /*
+     * The iterations of L run the loop body once more than the backedge is taken when L is rotated (the latch exits), and
+     * as many times when it is not (the header exits, before the body). Return -1 or 0, to be added to the backedge taken
+     * count for the number of the last iteration.
+     */
+    int lastIterationOffset(const Loop *L) {
+        return L->getExitingBlock() && L->getExitingBlock() == L->getLoopLatch() ? 0 : -1;
+    }
 
-    Bounds extractConstantBound(std::string stringBound) {
-        int sgn = 1, index = 0, value = 0;
-        if (stringBound.size() > 0 && stringBound[0] == '-') {
-            sgn = -1;
-            index++;
-        }
-        while (index < stringBound.size()) {
-            if ('0' <= stringBound[index] && stringBound[index] <= '9') {
-                value = value * 10 + stringBound[index] - '0';
-            } else {
+    /*
+     * The induction variable of L takes the values [0, last iteration], from the backedge taken count. For a runtime trip
+     * count, the bound is known if SCEV can bound the trip count (e.g. from the loop guards or the range of the values it
+     * is computed from).
+     */
+    Bounds extractLoopBound(Loop *L, ScalarEvolution &SE) {
+        const SCEV *TripCount = SE.getBackedgeTakenCount(L);
+        int offset = lastIterationOffset(L);
+        if (const auto *C = dyn_cast<SCEVConstant>(TripCount)) {
+            if (C->getAPInt().getActiveBits() > 63)
                 return {false, 0, 0};
-            }
-            index++;
+            return {true, 0, static_cast<int64_t>(C->getAPInt().getZExtValue()) + offset};
         }
-        return {true, 0, value * sgn - 1};
-    }
+        if (isa<SCEVCouldNotCompute>(TripCount))
+            return {false, 0, 0};
 
-    int extractNumber(std::string& expression, int& index) {
-        int sgn = 1, value = 0;
-        if (index < expression.size() && expression[index] == '-') {
-            sgn = -1;
-            index++;
-        }
-        while (index < expression.size() && '0' <= expression[index] && expression[index] <= '9') {
-            value = value * 10 + expression[index] - '0';
-            index++;
+        Bounds bounds = {false, 0, 0, SE.getAddExpr(TripCount, SE.getConstant(TripCount->getType(), offset, true))};
+        const auto *MaxTripCount = dyn_cast<SCEVConstant>(SE.getConstantMaxBackedgeTakenCount(L));
+        if (MaxTripCount && MaxTripCount->getAPInt().ule(maxSymbolicBound + 1 + offset)) {
+            bounds.isKnown = true;
+            bounds.upperBound = static_cast<int64_t>(MaxTripCount->getAPInt().getZExtValue()) + offset;
         }
-        return sgn * value;
+        return bounds;
     }
 
-    ArrayIndexAccess extractArrayIndexAccess(std::string string_access, const std::vector<std::string>& inductionVars, const std::vector<Bounds>& bounds) {
-        if (string_access == "UnknownExpr") {
-            return {false, 0, std::vector<IndexAccess>()};
-        } else {
-            int index = 0;
-            ArrayIndexAccess arrayIndexAccess;
-            arrayIndexAccess.isKnown = true;
-            arrayIndexAccess.freeCoef = extractNumber(string_access, index);
-            arrayIndexAccess.linearCombination = std::vector<IndexAccess>(inductionVars.size());
-            for (int i = 0; i < arrayIndexAccess.linearCombination.size(); ++i)
-                arrayIndexAccess.linearCombination[i].bounds = bounds[i];
-            while (index < string_access.size()) {
-                index += 3;
-                int coef = extractNumber(string_access, index);
-                index += 4;
-                std::string inductionVar = "%" + std::to_string(extractNumber(string_access, index));
-                int inductionIndex = std::distance(inductionVars.begin(), std::find(inductionVars.begin(), inductionVars.end(), inductionVar));
-                arrayIndexAccess.linearCombination[inductionIndex].coef = coef;
-            }
-            return arrayIndexAccess;
-        }
-    }
-
-    std::pair<std::vector<Bounds>, std::vector<std::string> > extractParentLoopBounds(Loop *L, ScalarEvolution &SE, bool print = true) {
-        std::vector<std::string> inductionVars;
+    std::vector<Bounds> extractParentLoopBounds(Loop *L, ScalarEvolution &SE, bool print = true) {
         std::vector<Bounds> bounds;
         for (Loop *Parent = L; Parent != nullptr; Parent = Parent->getParentLoop()) {
-            inductionVars.push_back(getLoopHeaderAsString(Parent));
-            const SCEV *TripCount = SE.getBackedgeTakenCount(Parent);
-            bounds.push_back(extractConstantBound(extractEquation(TripCount, SE)));
+            bounds.push_back(extractLoopBound(Parent, SE));
         }
 
         std::reverse(bounds.begin(), bounds.end());
-        std::reverse(inductionVars.begin(), inductionVars.end());
 
         if (print) {
+            std::vector<Loop*> loops;
+            for (Loop *Parent = L; Parent != nullptr; Parent = Parent->getParentLoop())
+                loops.push_back(Parent);
+            std::reverse(loops.begin(), loops.end());
+
             std::string padding;
-            for (int i = 0; i < inductionVars.size(); ++i) {
-                errs() << padding + "Loop induction variable: var_" << i << "(" + inductionVars[i] + ")" << '\n';
-                if (bounds[i].isKnown)
-                    errs() << padding << "Loop bounds: [ " << bounds[i].lowerBound << ", " << bounds[i].upperBound << " ]" << "\n";
+            for (int i = 0; i < loops.size(); ++i) {
+                report() << padding + "Loop induction variable: var_" << i << "(" + getLoopHeaderAsString(loops[i]) + ")" << '\n';
+                if (bounds[i].symbolicUpperBound) {
+                    report() << padding << "Loop bounds: [ " << bounds[i].lowerBound << ", " << *bounds[i].symbolicUpperBound << " ]";
+                    if (bounds[i].isKnown)
+                        report() << ", at most " << bounds[i].upperBound;
+                    report() << "\n";
+                }
+                else if (bounds[i].isKnown)
+                    report() << padding << "Loop bounds: [ " << bounds[i].lowerBound << ", " << bounds[i].upperBound << " ]" << "\n";
                 else
-                    errs() << padding << "Loop bounds: [ " << bounds[i].lowerBound << ", unknown ]" << "\n";
+                    report() << padding << "Loop bounds: [ " << bounds[i].lowerBound << ", unknown ]" << "\n";
                 padding += "  ";
             }
-            errs() << "\n\n";
+            report() << "\n\n";
         }
-        return {bounds, inductionVars};
+        return bounds;
     }
 
-    void printArrayIndexAccess(ArrayIndexAccess& arrayIndexAccess) {
+    void printArrayIndexAccess(const ArrayIndexAccess& arrayIndexAccess) {
         if (!arrayIndexAccess.isKnown) {
-            errs() << "UnknownExpr";
+            report() << "UnknownExpr";
         } else {
-            errs() << arrayIndexAccess.freeCoef;
+            report() << arrayIndexAccess.freeCoef;
             for (int i = 0; i < arrayIndexAccess.linearCombination.size(); ++i) {
-                IndexAccess indexAccess = arrayIndexAccess.linearCombination[i];
-                errs() << " + var_" << i << "[ " << indexAccess.bounds.lowerBound << ", " << indexAccess.bounds.upperBound << " ]" << " * " << indexAccess.coef;
+                const IndexAccess& indexAccess = arrayIndexAccess.linearCombination[i];
+                report() << " + var_" << i << "[ " << indexAccess.bounds.lowerBound << ", " << indexAccess.bounds.upperBound << " ]" << " * " << indexAccess.coef;
             }
         }
     }
 
-    void printArrayAccess(ArrayAccess arrayAccess) {
+    void printArrayAccess(const ArrayAccess& arrayAccess) {
         if (arrayAccess.type == true)
-            errs() << "Load in: " << *(arrayAccess.baseAccess) << "\n";
+            report() << "Load in: " << *(arrayAccess.baseAccess) << "\n";
         else
-            errs() << "Store in: " << *(arrayAccess.baseAccess) << "\n";
-        for (ArrayIndexAccess arrayIndexAccess : arrayAccess.arrayIndexAccesses) {
-            errs() << "Array index access: ";
+            report() << "Store in: " << *(arrayAccess.baseAccess) << "\n";
+        for (const ArrayIndexAccess& arrayIndexAccess : arrayAccess.arrayIndexAccesses) {
+            report() << "Array index access: ";
             printArrayIndexAccess(arrayIndexAccess);
-            errs() << "\n";
+            report() << "\n";
+        }
+    }
+
+    /*
+     * The object an access points into: the underlying object of the base of the SCEV of its pointer, so that pointers
+     * stepped by a phi (p++) or computed from a row pointer of an outer loop still resolve to the array they walk. A
+     * pointer loaded from memory is a base of its own; whether it may overlap the other bases is up to the caller.
+     */
+    Value* getBasePointer(Value *Ptr, ScalarEvolution &SE) {
+        if (SE.isSCEVable(Ptr->getType())) {
+            if (const auto *Base = dyn_cast<SCEVUnknown>(SE.getPointerBase(SE.getSCEV(Ptr))))
+                return getUnderlyingObject(Base->getValue(), /* MaxLookup = */ 0);
+        }
+        return getUnderlyingObject(Ptr, /* MaxLookup = */ 0);
+    }
+
+    /*
+     * Subscripts of an access through a base that is not a global or stack array (e.g. a pointer parameter). The base is
+     * seen as an array of the element type of the access: the pointer has to be the base itself or a single GEP on it,
+     * whose first index steps over whole elements, and all accesses to a base have to agree on the element type. Other
+     * pointers, such as the i8 GEPs of optimized IR, are read as one subscript from the offset of their SCEV to the base,
+     * in elements of the type of the access.
+     */
+    bool extractPointerIndexAccesses(Value* ptrOperand, Type *accessTy, Value *base, const Loop *L, const std::vector<Bounds>& bounds,
+                                     ScalarEvolution &SE, std::unordered_map<Value*, Type*>& elementTypes,
+                                     std::vector<ArrayIndexAccess>& accesses) {
+        const DataLayout &DL = L->getHeader()->getModule()->getDataLayout();
+        Type *elementTy = accessTy;
+        int totalDims = 1;
+        auto *GEPOp = dyn_cast<GEPOperator>(ptrOperand->stripPointerCasts());
+        if (GEPOp) {
+            Type *scalarTy = GEPOp->getSourceElementType();
+            while (auto *T = dyn_cast<ArrayType>(scalarTy))
+                scalarTy = T->getElementType();
+            if (GEPOp->getPointerOperand()->stripPointerCasts() == base &&
+                DL.getTypeAllocSize(scalarTy) == DL.getTypeStoreSize(accessTy)) {
+                elementTy = GEPOp->getSourceElementType();
+                totalDims = 1 + countArrayDimensions(elementTy);
+                if (GEPOp->getNumIndices() > totalDims)
+                    return false;
+            } else {
+                GEPOp = nullptr;
+                ArrayIndexAccess offset;
+                if (!extractElementOffset(ptrOperand, base, DL.getTypeStoreSize(accessTy), L, bounds, SE, offset))
+                    return false;
+                accesses.push_back(offset);
+            }
+        } else if (ptrOperand->stripPointerCasts() != base) {
+            return false;
+        }
+
+        auto [it, inserted] = elementTypes.insert({base, elementTy});
+        if (!inserted && it->second != elementTy)
+            return false;
+
+        if (GEPOp) {
+            for (Value *IndexVal : GEPOp->indices())
+                accesses.push_back(extractArrayIndexAccess(SE.getSCEV(IndexVal), L, bounds, SE));
+        }
+        while (accesses.size() < totalDims)
+            accesses.push_back(constantArrayIndexAccess(0, bounds));
+        return true;
+    }
+
+    /*
+     * The last iteration of L as a SCEV that only has to hold when L runs: a backedge taken count (C smax X) whose
+     * iterations for X <= C would not run L is X then.
+     */
+    const SCEV* getLastIterationWhenRun(const Loop *L, ScalarEvolution &SE) {
+        const SCEV *BackedgeTakenCount = SE.getBackedgeTakenCount(L);
+        if (isa<SCEVCouldNotCompute>(BackedgeTakenCount))
+            return nullptr;
+        int offset = lastIterationOffset(L);
+        const auto *SMax = dyn_cast<SCEVSMaxExpr>(BackedgeTakenCount);
+        if (SMax && SMax->getNumOperands() == 2) {
+            const auto *C = dyn_cast<SCEVConstant>(SMax->getOperand(0));
+            if (C && C->getAPInt().sle(-1 - offset))
+                BackedgeTakenCount = SMax->getOperand(1);
+        }
+        return SE.getAddExpr(BackedgeTakenCount, SE.getConstant(BackedgeTakenCount->getType(), offset, true));
+    }
+
+    /*
+     * Whether a subscript stays in [0, Size - 1] in all the iterations that run it, by the bounds of the loops or, when
+     * the size is a parameter, by their last iteration as a SCEV. The difference to the size is enough for the upper
+     * bound: the last iteration of a loop that runs does not wrap, which SCEV cannot tell from j < n.
+     */
+    bool isWithinDimension(const ArrayIndexAccess& subscript, const SCEV *Size, const std::vector<Loop*>& loops,
+                           const std::vector<Bounds>& bounds, ScalarEvolution &SE) {
+        Type *Ty = Size->getType();
+        int64_t low = subscript.freeCoef, high = subscript.freeCoef;
+        const SCEV *Low = SE.getConstant(Ty, subscript.freeCoef, true), *High = Low;
+        bool knownBounds = true, symbolicBounds = true;
+        for (int level = 0; level < bounds.size(); ++level) {
+            int64_t coef = subscript.linearCombination[level].coef;
+            if (coef == 0)
+                continue;
+            if (!bounds[level].isKnown ||
+                !checkedMulAdd(coef > 0 ? high : low, coef, std::max<int64_t>(bounds[level].upperBound, 0)))
+                knownBounds = false;
+            const SCEV *Last = getLastIterationWhenRun(loops[level], SE);
+            if (!Last || SE.getTypeSizeInBits(Last->getType()) > SE.getTypeSizeInBits(Ty)) {
+                symbolicBounds = false;
+                continue;
+            }
+            const SCEV *Term = SE.getMulExpr(SE.getConstant(Ty, coef, true), SE.getNoopOrSignExtend(Last, Ty));
+            if (coef > 0)
+                High = SE.getAddExpr(High, Term);
+            else
+                Low = SE.getAddExpr(Low, Term);
+        }
+        const auto *ConstantSize = dyn_cast<SCEVConstant>(Size);
+        bool lowWithin = (knownBounds && low >= 0) || (symbolicBounds && SE.isKnownNonNegative(Low));
+        bool highWithin = (knownBounds && ConstantSize && ConstantSize->getAPInt().sgt(high)) ||
+                          (symbolicBounds && (SE.isKnownPredicate(ICmpInst::ICMP_SLT, High, Size) ||
+                                              SE.isKnownPositive(SE.getMinusSCEV(Size, High))));
+        return lowWithin && highWithin;
+    }
+
+    /*
+     * Sizes of the dimensions of a flat array indexed as a multidimensional one, from the byte offsets of its accesses:
+     * the sizes of all dimensions but the outermost, in elements, and the size of the elements. Sizes that are parameters
+     * (a[i*n + j]) are found by LLVM's delinearization; constant ones are the ratios of the strides of the accesses,
+     * which have to divide each other, the smallest being one element.
+     */
+    bool findFlatArrayDimensions(ArrayRef<const SCEV*> offsets, const SCEV *ElementSize, const Loop *L,
+                                 const std::vector<Bounds>& bounds, ScalarEvolution &SE,
+                                 SmallVectorImpl<const SCEV*>& sizes) {
+        SmallVector<const SCEV*, 8> terms;
+        for (const SCEV *Offset : offsets)
+            collectParametricTerms(SE, Offset, terms);
+        if (!terms.empty()) {
+            findArrayDimensions(SE, terms, sizes, ElementSize);
+            return sizes.size() > 1;
+        }
+
+        int64_t elementSize = cast<SCEVConstant>(ElementSize)->getAPInt().getSExtValue();
+        std::vector<int64_t> strides;
+        for (const SCEV *Offset : offsets) {
+            ArrayIndexAccess offset = extractArrayIndexAccess(Offset, L, bounds, SE);
+            if (!offset.isKnown)
+                return false;
+            for (const IndexAccess& indexAccess : offset.linearCombination) {
+                if (indexAccess.coef == INT64_MIN || indexAccess.coef % elementSize != 0)
+                    return false;
+                if (indexAccess.coef != 0)
+                    strides.push_back(std::abs(indexAccess.coef) / elementSize);
+            }
+        }
+        std::sort(strides.begin(), strides.end());
+        strides.erase(std::unique(strides.begin(), strides.end()), strides.end());
+        if (strides.size() < 2 || strides[0] != 1)
+            return false;
+        for (int i = strides.size() - 1; i > 0; --i) {
+            if (strides[i] % strides[i - 1] != 0)
+                return false;
+            sizes.push_back(SE.getConstant(ElementSize->getType(), strides[i] / strides[i - 1]));
+        }
+        sizes.push_back(ElementSize);
+        return true;
+    }
+
+    /*
+     * Subscripts of the accesses of L to flat arrays (1-dimensional global or stack arrays, and, with allowPointerBases,
+     * pointer bases) that index them as multidimensional arrays, like a[i*n + j] or a C++ wrapper around a vector. The
+     * offset of every access is split into the dimensions of its base by computeAccessFunctions, and every subscript but
+     * the outermost has to stay within its dimension, which makes them exact. A base is only delinearized if all of its
+     * accesses are; the others are left to extractArrayIndexAccesses and extractPointerIndexAccesses.
+     */
+    std::unordered_map<const Instruction*, std::vector<ArrayIndexAccess>>
+    delinearizeFlatArrays(Loop &L, const std::vector<Bounds>& bounds, ScalarEvolution &SE, bool allowPointerBases) {
+        std::vector<Loop*> loops;
+        for (Loop *Parent = &L; Parent != nullptr; Parent = Parent->getParentLoop())
+            loops.push_back(Parent);
+        std::reverse(loops.begin(), loops.end());
+
+        MapVector<Value*, SmallVector<Instruction*, 8>> accessesOfBase;
+        for (BasicBlock *BB : L.blocks()) {
+            for (Instruction &I : *BB) {
+                Value *Ptr = getLoadStorePointerOperand(&I);
+                if (!Ptr)
+                    continue;
+                Value *base = getBasePointer(Ptr, SE);
+                ArrayType *arrayTy = extractTopLevelArrayType(base);
+                if (arrayTy ? countArrayDimensions(arrayTy) == 1 : allowPointerBases)
+                    accessesOfBase[base].push_back(&I);
+            }
+        }
+
+        const DataLayout &DL = L.getHeader()->getModule()->getDataLayout();
+        std::unordered_map<const Instruction*, std::vector<ArrayIndexAccess>> subscripts;
+        for (auto& [base, instructions] : accessesOfBase) {
+            uint64_t elementSize = DL.getTypeStoreSize(getLoadStoreType(instructions[0]));
+            ArrayType *arrayTy = extractTopLevelArrayType(base);
+            if (elementSize == 0 || elementSize > INT64_MAX ||
+                (arrayTy && DL.getTypeAllocSize(arrayTy->getElementType()) != elementSize))
+                continue;
+            SmallVector<const SCEV*, 8> offsets;
+            for (Instruction *I : instructions) {
+                const SCEV *Offset = SE.getMinusSCEV(SE.getSCEV(getLoadStorePointerOperand(I)), SE.getSCEV(base));
+                if (DL.getTypeStoreSize(getLoadStoreType(I)) != elementSize || isa<SCEVCouldNotCompute>(Offset))
+                    break;
+                offsets.push_back(Offset);
+            }
+            SmallVector<const SCEV*, 4> sizes;
+            if (offsets.size() != instructions.size() ||
+                !findFlatArrayDimensions(offsets, SE.getConstant(offsets[0]->getType(), elementSize), &L, bounds, SE, sizes))
+                continue;
+
+            std::vector<std::vector<ArrayIndexAccess>> baseSubscripts;
+            for (const SCEV *Offset : offsets) {
+                SmallVector<const SCEV*, 4> accessSubscripts, accessSizes(sizes.begin(), sizes.end());
+                computeAccessFunctions(SE, Offset, accessSubscripts, accessSizes);
+                if (accessSubscripts.size() != sizes.size())
+                    break;
+                std::vector<ArrayIndexAccess> accesses;
+                for (int d = 0; d < accessSubscripts.size(); ++d) {
+                    ArrayIndexAccess subscript = extractArrayIndexAccess(accessSubscripts[d], &L, bounds, SE);
+                    if (!subscript.isKnown || (d > 0 && !isWithinDimension(subscript, sizes[d - 1], loops, bounds, SE)))
+                        break;
+                    accesses.push_back(subscript);
+                }
+                if (accesses.size() != sizes.size())
+                    break;
+                baseSubscripts.push_back(std::move(accesses));
+            }
+            if (baseSubscripts.size() != instructions.size())
+                continue;
+            for (int i = 0; i < instructions.size(); ++i)
+                subscripts[instructions[i]] = std::move(baseSubscripts[i]);
+        }
+        return subscripts;
+    }
+
+    /*
+     * A reduction of L. Either a header phi recognised by RecurrenceDescriptor, or a memory reduction: the load and the
+     * store of one loop invariant element around an associative operation (a[0] += b[i]). next is the value that an
+     * iteration passes on to the following one.
+     */
+    struct Reduction {
+        RecurKind kind;
+        FastMathFlags FMF;
+        PHINode *phi;
+        LoadInst *load;
+        StoreInst *store;
+        Value *next;
+    };
+
+    bool isSupportedReductionKind(RecurKind kind) {
+        switch (kind) {
+            case RecurKind::Add:
+            case RecurKind::Mul:
+            case RecurKind::Or:
+            case RecurKind::And:
+            case RecurKind::Xor:
+            case RecurKind::SMin:
+            case RecurKind::SMax:
+            case RecurKind::UMin:
+            case RecurKind::UMax:
+            case RecurKind::FAdd:
+            case RecurKind::FMul:
+            case RecurKind::FMin:
+            case RecurKind::FMax:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    const char* getReductionName(RecurKind kind) {
+        switch (kind) {
+            case RecurKind::Add: return "add";
+            case RecurKind::Mul: return "mul";
+            case RecurKind::Or: return "or";
+            case RecurKind::And: return "and";
+            case RecurKind::Xor: return "xor";
+            case RecurKind::SMin: return "smin";
+            case RecurKind::SMax: return "smax";
+            case RecurKind::UMin: return "umin";
+            case RecurKind::UMax: return "umax";
+            case RecurKind::FAdd: return "fadd";
+            case RecurKind::FMul: return "fmul";
+            case RecurKind::FMin: return "fmin";
+            case RecurKind::FMax: return "fmax";
+            default: return "unknown";
+        }
+    }
+
+    /*
+     * Whether V is Acc or a chain of single use Opcode operations reaching it, e.g. (s + a[i]) + b[i].
+     */
+    bool reachesThroughChain(Value *V, Value *Acc, unsigned Opcode) {
+        if (V == Acc)
+            return true;
+        auto *BO = dyn_cast<BinaryOperator>(V);
+        if (!BO || BO->getOpcode() != Opcode || !BO->hasOneUse() || (isa<FPMathOperator>(BO) && !BO->hasAllowReassoc()))
+            return false;
+        return reachesThroughChain(BO->getOperand(0), Acc, Opcode) || reachesThroughChain(BO->getOperand(1), Acc, Opcode);
+    }
+
+    /*
+     * Match Op, the value that an iteration passes on, against op(Acc, x) for an associative operation. Acc may only be
+     * used by the operation in L, so x does not depend on it. Floating point additions and multiplications need
+     * reassociation to be allowed. Return RecurKind::None if Op is not such an operation.
+     */
+    RecurKind matchReductionOp(Value *Acc, Instruction *Op, Loop &L, FastMathFlags& FMF) {
+        using namespace PatternMatch;
+        if (!Op->hasOneUse() || Acc->getType() != Op->getType())
+            return RecurKind::None;
+        std::vector<User*> users;
+        for (User *U : Acc->users()) {
+            if (L.contains(cast<Instruction>(U)))
+                users.push_back(U);
+        }
+        if (isa<FPMathOperator>(Op))
+            FMF = Op->getFastMathFlags();
+
+        if (auto *BO = dyn_cast<BinaryOperator>(Op)) {
+            if (users.size() != 1 || !reachesThroughChain(BO, Acc, BO->getOpcode()))
+                return RecurKind::None;
+            switch (BO->getOpcode()) {
+                case Instruction::Add: return RecurKind::Add;
+                case Instruction::Mul: return RecurKind::Mul;
+                case Instruction::And: return RecurKind::And;
+                case Instruction::Or: return RecurKind::Or;
+                case Instruction::Xor: return RecurKind::Xor;
+                case Instruction::FAdd: return RecurKind::FAdd;
+                case Instruction::FMul: return RecurKind::FMul;
+                default: return RecurKind::None;
+            }
+        }
+
+        bool onlyUsedByOp = all_of(users, [&](User *U) {
+            return U == Op || (isa<CmpInst>(U) && U->hasOneUse() && U->user_back() == Op);
+        });
+        if (!onlyUsedByOp)
+            return RecurKind::None;
+        if (match(Op, m_c_SMax(m_Specific(Acc), m_Value())))
+            return RecurKind::SMax;
+        if (match(Op, m_c_SMin(m_Specific(Acc), m_Value())))
+            return RecurKind::SMin;
+        if (match(Op, m_c_UMax(m_Specific(Acc), m_Value())))
+            return RecurKind::UMax;
+        if (match(Op, m_c_UMin(m_Specific(Acc), m_Value())))
+            return RecurKind::UMin;
+        auto *II = dyn_cast<IntrinsicInst>(Op);
+        if (II && (II->getArgOperand(0) == Acc || II->getArgOperand(1) == Acc)) {
+            if (II->getIntrinsicID() == Intrinsic::maxnum)
+                return RecurKind::FMax;
+            if (II->getIntrinsicID() == Intrinsic::minnum)
+                return RecurKind::FMin;
+        }
+        return RecurKind::None;
+    }
+
+    /*
+     * Find the reductions of L. Every header phi has to be an induction or a reduction, since it would otherwise carry a
+     * value from one iteration to the next: return false if one is neither. Memory reductions have to be executed by
+     * every iteration, and their load and store have to be the only accesses to their address in L; whether other
+     * accesses may still touch that element is left to the dependence tests.
+     */
+    bool findReductions(Loop &L, ScalarEvolution &SE, DominatorTree &DT, std::vector<Reduction>& reductions) {
+        // The induction and recurrence descriptors read the incoming values of the preheader and the latch.
+        BasicBlock *Latch = L.getLoopLatch();
+        if (!Latch || !L.getLoopPreheader())
+            return false;
+        for (PHINode &Phi : L.getHeader()->phis()) {
+            InductionDescriptor ID;
+            if (InductionDescriptor::isInductionPHI(&Phi, &L, &SE, ID))
+                continue;
+            Value *Next = Phi.getIncomingValueForBlock(Latch);
+            RecurrenceDescriptor RedDes;
+            if (RecurrenceDescriptor::isReductionPHI(&Phi, &L, RedDes, nullptr, nullptr, &DT, &SE)) {
+                if (!isSupportedReductionKind(RedDes.getRecurrenceKind()) || RedDes.getExactFPMathInst() ||
+                    RedDes.getRecurrenceType() != Phi.getType())
+                    return false;
+                reductions.push_back({RedDes.getRecurrenceKind(), RedDes.getFastMathFlags(), &Phi, nullptr, nullptr, Next});
+                continue;
+            }
+            // RecurrenceDescriptor rejects a phi that is used after the loop, which is where the result of a loop
+            // that is not rotated is read from.
+            auto *Op = dyn_cast<Instruction>(Next);
+            FastMathFlags FMF;
+            RecurKind kind = Op && L.contains(Op) ? matchReductionOp(&Phi, Op, L, FMF) : RecurKind::None;
+            if (kind == RecurKind::None)
+                return false;
+            reductions.push_back({kind, FMF, &Phi, nullptr, nullptr, Next});
+        }
+
+        for (BasicBlock *BB : L.blocks()) {
+            if (!DT.dominates(BB, Latch))
+                continue;
+            for (Instruction &I : *BB) {
+                auto *Store = dyn_cast<StoreInst>(&I);
+                if (!Store)
+                    continue;
+                const SCEV *PtrSCEV = SE.getSCEV(Store->getPointerOperand());
+                if (!SE.isLoopInvariant(PtrSCEV, &L))
+                    continue;
+                LoadInst *Load = nullptr;
+                for (Instruction &Prev : make_range(BB->begin(), Store->getIterator())) {
+                    auto *PrevLoad = dyn_cast<LoadInst>(&Prev);
+                    if (PrevLoad && SE.getSCEV(PrevLoad->getPointerOperand()) == PtrSCEV)
+                        Load = PrevLoad;
+                }
+                int accesses = 0;
+                for (BasicBlock *Other : L.blocks()) {
+                    for (Instruction &J : *Other) {
+                        Value *Ptr = getLoadStorePointerOperand(&J);
+                        if (Ptr && SE.getSCEV(Ptr) == PtrSCEV)
+                            accesses++;
+                    }
+                }
+                auto *Op = dyn_cast<Instruction>(Store->getValueOperand());
+                if (!Load || accesses != 2 || !Op || !Load->isSimple() || !Store->isSimple())
+                    continue;
+                FastMathFlags FMF;
+                RecurKind kind = matchReductionOp(Load, Op, L, FMF);
+                if (kind != RecurKind::None)
+                    reductions.push_back({kind, FMF, nullptr, Load, Store, Op});
+            }
+        }
+        return true;
+    }
+
+    bool hasMemoryReduction(const std::vector<Reduction>& reductions) {
+        return any_of(reductions, [](const Reduction& reduction) { return reduction.store != nullptr; });
+    }
+
+    void printReduction(const Reduction& reduction) {
+        report() << "Reduction (" << getReductionName(reduction.kind) << ") in: ";
+        if (reduction.phi)
+            report() << *reduction.phi << "\n";
+        else
+            report() << *reduction.store << "\n";
+    }
+
+    /*
+     * Whether alias analysis proves that no access of L to one of the bases in pointerBases overlaps an access to another
+     * base, in any two iterations, when one of them is a store. The locations are the whole objects around the pointers,
+     * with the type (TBAA) and scoped noalias metadata of the instructions; the scopes are dropped when a scope is declared
+     * in the nest, since each iteration then opens one of its own.
+     */
+    bool areDisjointBases(Loop &L, const SmallPtrSetImpl<Value*>& pointerBases, ScalarEvolution &SE, AAResults &AA) {
+        Loop *Outermost = &L;
+        while (Outermost->getParentLoop())
+            Outermost = Outermost->getParentLoop();
+        bool declaresScopes = any_of(Outermost->blocks(), [](BasicBlock *BB) {
+            return any_of(*BB, [](Instruction &I) { return isa<NoAliasScopeDeclInst>(I); });
+        });
+
+        struct Access {
+            Value *base;
+            MemoryLocation location;
+            bool isStore;
+        };
+        std::vector<Access> accesses;
+        for (BasicBlock *BB : L.blocks()) {
+            for (Instruction &I : *BB) {
+                Value *Ptr = getLoadStorePointerOperand(&I);
+                if (!Ptr)
+                    continue;
+                AAMDNodes AATags = I.getAAMetadata();
+                if (declaresScopes)
+                    AATags.Scope = AATags.NoAlias = nullptr;
+                accesses.push_back({getBasePointer(Ptr, SE), MemoryLocation::getBeforeOrAfter(Ptr, AATags), isa<StoreInst>(I)});
+            }
         }
+        BatchAAResults BatchAA(AA);
+        for (int i = 0; i < accesses.size(); ++i) {
+            for (int j = i + 1; j < accesses.size(); ++j) {
+                const Access& access1 = accesses[i];
+                const Access& access2 = accesses[j];
+                if (access1.base == access2.base || (!access1.isStore && !access2.isStore) ||
+                    (!pointerBases.count(access1.base) && !pointerBases.count(access2.base)))
+                    continue;
+                if (BatchAA.alias(access1.location, access2.location) != AliasResult::NoAlias)
+                    return false;
+            }
+        }
+        return true;
     }
 
-    static Value* getBasePointer(Value *V, std::unordered_map<Value*, Value*> &baseMap) {
-        V = V->stripPointerCasts();
-        if (baseMap.count(V))
-            return getBasePointer(baseMap[V], baseMap);
-        if (auto *CE = dyn_cast<ConstantExpr>(V)) {
-            if (CE->getOpcode() == Instruction::GetElementPtr)
-                return getBasePointer(CE->getOperand(0)->stripPointerCasts(), baseMap);
+    /*
+     * Collect the array accesses in the blocks of L, with subscripts expressed over the induction variables of L and
+     * its parents. Return false if an access goes through a pointer that is not a global or stack array (e.g. a pointer
+     * parameter) and that may overlap the other bases, since nothing is known about what it points to, or through a base
+     * defined in the nest, which may change between iterations. With AA, such pointers are accepted when alias analysis
+     * proves them disjoint from the other bases (restrict parameters, distinct types), and with allowPointerBases, when
+     * their accesses can be described as array accesses; whether they overlap other bases is then left to the caller.
+     * Flat arrays indexed as multidimensional ones are delinearized first (see delinearizeFlatArrays). The loads and
+     * stores of the memory reductions are marked as such. instructionAccesses, if given, maps every load and store to
+     * its access, which it may share with other instructions.
+     */
+    bool collectArrayAccesses(Loop &L, const std::vector<Bounds>& bounds, ScalarEvolution &SE, ArrayAccessSet& arrayAccesses,
+                              bool print = true, bool allowPointerBases = false, const std::vector<Reduction>& reductions = {},
+                              std::unordered_map<const Instruction*, const ArrayAccess*> *instructionAccesses = nullptr,
+                              AAResults *AA = nullptr) {
+        std::unordered_map<Value*, Type*> pointerElementTypes;
+        SmallPtrSet<Value*, 8> pointerBases;
+        bool knownBases = true;
+        Loop *Outermost = &L;
+        while (Outermost->getParentLoop())
+            Outermost = Outermost->getParentLoop();
+
+        std::unordered_map<const Instruction*, std::vector<ArrayIndexAccess>> delinearized =
+            delinearizeFlatArrays(L, bounds, SE, allowPointerBases || AA);
+
+        auto extractSubscripts = [&](Value *ptrOperand, Type *accessTy, ArrayAccess& arrayAccess) {
+            auto *BaseInst = dyn_cast<Instruction>(arrayAccess.baseAccess);
+            auto it = delinearized.find(arrayAccess.instruction);
+            if (BaseInst && Outermost->contains(BaseInst))
+                knownBases = false;
+            else if (it != delinearized.end())
+                arrayAccess.arrayIndexAccesses = it->second;
+            else if (extractTopLevelArrayType(arrayAccess.baseAccess))
+                arrayAccess.arrayIndexAccesses = extractArrayIndexAccesses(ptrOperand, accessTy, arrayAccess.baseAccess,
+                                                                           &L, bounds, SE);
+            else if ((!allowPointerBases && !AA) || // ptr param
+                     !extractPointerIndexAccesses(ptrOperand, accessTy, arrayAccess.baseAccess, &L, bounds, SE,
+                                                  pointerElementTypes, arrayAccess.arrayIndexAccesses))
+                knownBases = false;
+            if (!extractTopLevelArrayType(arrayAccess.baseAccess))
+                pointerBases.insert(arrayAccess.baseAccess);
+        };
+        auto isReductionAccess = [&](Instruction *I) {
+            return any_of(reductions, [&](const Reduction& reduction) { return reduction.load == I || reduction.store == I; });
+        };
+
+        for (BasicBlock *BB : L.blocks()) {
+            for (Instruction &I : *BB)
+            {
+                if (auto *Store = dyn_cast<StoreInst>(&I))
+                {
+                    Value *ptrOperand = Store->getOperand(1);
+                    ArrayAccess arrayAccess;
+                    arrayAccess.baseAccess = getBasePointer(ptrOperand, SE);
+                    arrayAccess.type = false;
+                    arrayAccess.isReduction = isReductionAccess(Store);
+                    arrayAccess.instruction = Store;
+                    extractSubscripts(ptrOperand, Store->getValueOperand()->getType(), arrayAccess);
+                    if (print)
+                        printArrayAccess(arrayAccess);
+                    auto inserted = arrayAccesses.push_back(std::move(arrayAccess));
+                    if (instructionAccesses)
+                        (*instructionAccesses)[Store] = &*inserted.first;
+                }
+                else if (auto *Load = dyn_cast<LoadInst>(&I))
+                {
+                    Value *ptrOperand = Load->getOperand(0);
+                    ArrayAccess arrayAccess;
+                    arrayAccess.baseAccess = getBasePointer(ptrOperand, SE);
+                    arrayAccess.type = true;
+                    arrayAccess.isReduction = isReductionAccess(Load);
+                    arrayAccess.instruction = Load;
+                    extractSubscripts(ptrOperand, Load->getType(), arrayAccess);
+                    if (print)
+                        printArrayAccess(arrayAccess);
+                    auto inserted = arrayAccesses.push_back(std::move(arrayAccess));
+                    if (instructionAccesses)
+                        (*instructionAccesses)[Load] = &*inserted.first;
+                }
+            }
         }
-        if (auto *GEP = dyn_cast<GetElementPtrInst>(V))
-            return getBasePointer(GEP->getOperand(0)->stripPointerCasts(), baseMap);
-        if (auto *LI = dyn_cast<LoadInst>(V))
-            return getBasePointer(LI->getOperand(0)->stripPointerCasts(), baseMap);
-        return V;
+        if (knownBases && !allowPointerBases && !pointerBases.empty())
+            knownBases = areDisjointBases(L, pointerBases, SE, *AA);
+        return knownBases;
     }
 
     /*
      * Check if access1[index].linear_combination - access2[index].linear_combination contain 0 on all dimensions.
      * Return true if there is a dimension where 0 is not covered -> there is no dependency.
+     * A loop without a known upper bound only bounds the difference on one side, which may still exclude 0.
+     * A dimension whose bounds overflow proves nothing.
      */
     bool BanerjeeTest(const ArrayAccess& access1, const ArrayAccess& access2) {
         for (int index = 0; index < access1.arrayIndexAccesses.size(); ++index) {
-            ArrayIndexAccess indexAccess1 = access1.arrayIndexAccesses[index];
-            ArrayIndexAccess indexAccess2 = access2.arrayIndexAccesses[index];
+            const ArrayIndexAccess& indexAccess1 = access1.arrayIndexAccesses[index];
+            const ArrayIndexAccess& indexAccess2 = access2.arrayIndexAccesses[index];
             if (!indexAccess1.isKnown || !indexAccess2.isKnown)
                 continue;
-            int lb = indexAccess1.freeCoef - indexAccess2.freeCoef, ub = indexAccess1.freeCoef - indexAccess2.freeCoef;
+            int64_t lb = indexAccess1.freeCoef, ub;
+            if (!checkedMulAdd(lb, -1, indexAccess2.freeCoef))
+                continue;
+            ub = lb;
             std::vector<IndexAccess> linear_difference;
-            bool unknown_boundary = false;
+            bool lb_unbounded = false, ub_unbounded = false, overflow = false;
             for (int i = 0; i < indexAccess1.linearCombination.size() - 1; ++i) {
-                int coef = indexAccess1.linearCombination[i].coef - indexAccess2.linearCombination[i].coef;
+                int64_t coef = indexAccess1.linearCombination[i].coef;
+                overflow |= !checkedMulAdd(coef, -1, indexAccess2.linearCombination[i].coef);
                 linear_difference.push_back({indexAccess1.linearCombination[i].bounds, coef});
             }
             if (indexAccess1.linearCombination.size() > 0) {
                 int last_index = indexAccess1.linearCombination.size() - 1;
-                int coef = indexAccess1.linearCombination[last_index].coef;
+                int64_t coef = indexAccess1.linearCombination[last_index].coef;
                 linear_difference.push_back({indexAccess1.linearCombination[last_index].bounds, coef});
 
-                coef = -indexAccess2.linearCombination[last_index].coef;
+                coef = 0;
+                overflow |= !checkedMulAdd(coef, -1, indexAccess2.linearCombination[last_index].coef);
                 linear_difference.push_back({indexAccess2.linearCombination[last_index].bounds, coef});
             }
             for (auto index_bound : linear_difference) {
                 if (index_bound.coef != 0) {
                     if (!index_bound.bounds.isKnown) {
-                        unknown_boundary = true;
-                        break;
+                        if (index_bound.coef > 0) {
+                            overflow |= !checkedMulAdd(lb, index_bound.coef, index_bound.bounds.lowerBound);
+                            ub_unbounded = true;
+                        } else {
+                            overflow |= !checkedMulAdd(ub, index_bound.coef, index_bound.bounds.lowerBound);
+                            lb_unbounded = true;
+                        }
+                        continue;
                     }
-                    int delta_lb = index_bound.coef * index_bound.bounds.lowerBound, delta_ub = index_bound.coef * index_bound.bounds.upperBound;
-                    lb += std::min(delta_lb, delta_ub);
-                    ub += std::max(delta_lb, delta_ub);
+                    int64_t delta_lb = 0, delta_ub = 0;
+                    overflow |= !checkedMulAdd(delta_lb, index_bound.coef, index_bound.bounds.lowerBound) ||
+                                !checkedMulAdd(delta_ub, index_bound.coef, index_bound.bounds.upperBound) ||
+                                !checkedMulAdd(lb, 1, std::min(delta_lb, delta_ub)) ||
+                                !checkedMulAdd(ub, 1, std::max(delta_lb, delta_ub));
                 }
             }
-            if (unknown_boundary)
-                continue;
-            if (ub < 0 || lb > 0)
+            if (!overflow && ((!ub_unbounded && ub < 0) || (!lb_unbounded && lb > 0)))
                 return true;
         }
         return false;
@@ -345,16 +1181,18 @@ namespace {
      */
     bool StrongSIVTest(const ArrayAccess& access1, const ArrayAccess& access2) {
         for (int index = 0; index < access1.arrayIndexAccesses.size(); ++index) {
-            ArrayIndexAccess indexAccess1 = access1.arrayIndexAccesses[index];
-            ArrayIndexAccess indexAccess2 = access2.arrayIndexAccesses[index];
+            const ArrayIndexAccess& indexAccess1 = access1.arrayIndexAccesses[index];
+            const ArrayIndexAccess& indexAccess2 = access2.arrayIndexAccesses[index];
             if (!indexAccess1.isKnown || !indexAccess2.isKnown)
                 continue;
-            int free_coef = indexAccess1.freeCoef - indexAccess2.freeCoef;
+            // The distance is computed in magnitude, so it must not be INT64_MIN.
+            int64_t free_coef = indexAccess1.freeCoef;
+            if (!checkedMulAdd(free_coef, -1, indexAccess2.freeCoef) || free_coef == INT64_MIN)
+                continue;
             std::vector<IndexAccess> linear_difference;
             bool different_linear_combination = false;
             for (int i = 0; i < indexAccess1.linearCombination.size() - 1; ++i) {
-                int coef = indexAccess1.linearCombination[i].coef - indexAccess2.linearCombination[i].coef;
-                if (coef != 0) {
+                if (indexAccess1.linearCombination[i].coef != indexAccess2.linearCombination[i].coef) {
                     different_linear_combination = true;
                     break;
                 }
@@ -363,17 +1201,19 @@ namespace {
                 continue;
             if (indexAccess1.linearCombination.size() > 0) {
                 int last_index = indexAccess1.linearCombination.size() - 1;
-                int coef1 = indexAccess1.linearCombination[last_index].coef;
-                int coef2 = indexAccess2.linearCombination[last_index].coef;
+                int64_t coef1 = indexAccess1.linearCombination[last_index].coef;
+                int64_t coef2 = indexAccess2.linearCombination[last_index].coef;
                 if (coef1 != coef2 || coef1 == 0)
                     continue;
                 if (free_coef % coef1 != 0)
                     return true;
-                int d = free_coef / coef1;
+                int64_t d = free_coef / coef1;
                 if (d < 0)
                     d = -d;
-                if (indexAccess1.linearCombination[last_index].bounds.isKnown) {
-                    if (d > indexAccess1.linearCombination[last_index].bounds.upperBound - indexAccess1.linearCombination[last_index].bounds.lowerBound)
+                const Bounds& bounds = indexAccess1.linearCombination[last_index].bounds;
+                int64_t span = bounds.upperBound;
+                if (bounds.isKnown && checkedMulAdd(span, -1, bounds.lowerBound)) {
+                    if (d > span)
                         return true;
                 }
             }
@@ -382,10 +1222,15 @@ namespace {
     }
 
 
-    bool SameAccess(const ArrayAccess& access1, const ArrayAccess& access2) {
+    /*
+     * Both accesses use the same subscripts, so they only meet within one iteration, provided that some subscript
+     * moves with the innermost induction variable. Otherwise every iteration touches the same element.
+     */
+    bool SameAccess(const ArrayAccess& access1, const ArrayAccess& access2) {
+        bool innermostInSubscripts = false;
         for (int index = 0; index < access1.arrayIndexAccesses.size(); ++index) {
-            ArrayIndexAccess indexAccess1 = access1.arrayIndexAccesses[index];
-            ArrayIndexAccess indexAccess2 = access2.arrayIndexAccesses[index];
+            const ArrayIndexAccess& indexAccess1 = access1.arrayIndexAccesses[index];
+            const ArrayIndexAccess& indexAccess2 = access2.arrayIndexAccesses[index];
             if (!indexAccess1.isKnown || !indexAccess2.isKnown)
                 continue;
             if (indexAccess1.freeCoef != indexAccess2.freeCoef)
@@ -394,25 +1239,28 @@ namespace {
                 if (indexAccess1.linearCombination[i].coef != indexAccess2.linearCombination[i].coef)
                     return false;
             }
+            if (!indexAccess1.linearCombination.empty() && indexAccess1.linearCombination.back().coef != 0)
+                innermostInSubscripts = true;
         }
-        return true;
+        return innermostInSubscripts;
     }
 
     bool GCDTest(const ArrayAccess& access1, const ArrayAccess& access2) {
-        auto arrayIndexAccesses1 = access1.arrayIndexAccesses;
-        auto arrayIndexAccesses2 = access2.arrayIndexAccesses;
-        int gcd;
+        const auto& arrayIndexAccesses1 = access1.arrayIndexAccesses;
+        const auto& arrayIndexAccesses2 = access2.arrayIndexAccesses;
+        int64_t gcd;
 
         for(int i = 0;i < access1.arrayIndexAccesses.size(); i++)
         {
             if (!arrayIndexAccesses1[i].isKnown || !arrayIndexAccesses2[i].isKnown)
                 continue;
 
-            std::vector<int> coefficients;
-            auto linearCombination1 = arrayIndexAccesses1[i].linearCombination;
-            auto linearCombination2 = arrayIndexAccesses2[i].linearCombination;
+            std::vector<int64_t> coefficients;
+            const auto& linearCombination1 = arrayIndexAccesses1[i].linearCombination;
+            const auto& linearCombination2 = arrayIndexAccesses2[i].linearCombination;
             int currentIndex = linearCombination1.size() - 1;
-            int freeRemainingCoef = arrayIndexAccesses2[i].freeCoef - arrayIndexAccesses1[i].freeCoef;
+            int64_t freeRemainingCoef = arrayIndexAccesses2[i].freeCoef;
+            bool overflow = !checkedMulAdd(freeRemainingCoef, -1, arrayIndexAccesses1[i].freeCoef);
 
             for(int j = 0;j < access1.arrayIndexAccesses[i].linearCombination.size();j++)
             {
@@ -425,17 +1273,21 @@ namespace {
                 }
                 else
                 {
-                    int remainingCoef = linearCombination1[j].coef - linearCombination2[j].coef;
+                    int64_t remainingCoef = linearCombination1[j].coef;
+                    overflow |= !checkedMulAdd(remainingCoef, -1, linearCombination2[j].coef);
                     if (remainingCoef != 0)
                         coefficients.push_back(remainingCoef);
                 }
             }
+            // std::gcd needs the magnitudes to be representable.
             gcd = 0;
             for(int j = 0; j < coefficients.size();j++)
             {
-                gcd = std::gcd(gcd, coefficients[j]);
+                overflow |= coefficients[j] == INT64_MIN;
+                if (!overflow)
+                    gcd = std::gcd(gcd, coefficients[j]);
             }
-            if (gcd != 0 && freeRemainingCoef % gcd != 0)
+            if (!overflow && gcd != 0 && freeRemainingCoef % gcd != 0)
                 return true;
         }
         return false;
@@ -443,15 +1295,15 @@ namespace {
 
     bool ZIVTest(const ArrayAccess& access1, const ArrayAccess& access2)
     {
-        auto arrayIndexAccesses1 = access1.arrayIndexAccesses;
-        auto arrayIndexAccesses2 = access2.arrayIndexAccesses;
+        const auto& arrayIndexAccesses1 = access1.arrayIndexAccesses;
+        const auto& arrayIndexAccesses2 = access2.arrayIndexAccesses;
         for(int i = 0;i < access1.arrayIndexAccesses.size(); i++)
         {
             if (!arrayIndexAccesses1[i].isKnown || !arrayIndexAccesses2[i].isKnown)
                 continue;
             bool onlyFreeCoefficients = true;
-            auto linearCombination1 = arrayIndexAccesses1[i].linearCombination;
-            auto linearCombination2 = arrayIndexAccesses2[i].linearCombination;
+            const auto& linearCombination1 = arrayIndexAccesses1[i].linearCombination;
+            const auto& linearCombination2 = arrayIndexAccesses2[i].linearCombination;
             for (int j = 0;j < linearCombination1.size();j++)
             {
                 if (linearCombination1[j].coef != 0 || linearCombination2[j].coef != 0)
@@ -466,115 +1318,3924 @@ namespace {
         return false;
     }
 
-    bool isSafeParallelizable(const ArrayAccess& access1, const ArrayAccess& access2) {
-         return BanerjeeTest(access1, access2) || StrongSIVTest(access1, access2) || SameAccess(access1, access2) ||
-             GCDTest(access1, access2) || ZIVTest(access1, access2);
+    /*
+     * The load and the store of a memory reduction touch the same element in every iteration, which is fine since the
+     * reduction is computed privately by every thread.
+     */
+    bool SameReduction(const ArrayAccess& access1, const ArrayAccess& access2) {
+        if (!access1.isReduction || !access2.isReduction)
+            return false;
+        for (int index = 0; index < access1.arrayIndexAccesses.size(); ++index) {
+            const ArrayIndexAccess& indexAccess1 = access1.arrayIndexAccesses[index];
+            const ArrayIndexAccess& indexAccess2 = access2.arrayIndexAccesses[index];
+            if (!indexAccess1.isKnown || !indexAccess2.isKnown || indexAccess1.freeCoef != indexAccess2.freeCoef)
+                return false;
+            for (int i = 0; i < indexAccess1.linearCombination.size(); ++i) {
+                if (indexAccess1.linearCombination[i].coef != indexAccess2.linearCombination[i].coef)
+                    return false;
+            }
+        }
+        return true;
     }
 
-    struct LoopParallelization : PassInfoMixin<LoopParallelization> {
-        PreservedAnalyses run(Loop &L, LoopAnalysisManager &LAM,
-                              LoopStandardAnalysisResults &AR, LPMUpdater &U) {
-            if (!L.getSubLoops().empty()) {
-                return PreservedAnalyses::all();
+    /*
+     * Set dst |= src << shift on bitsets of the same number of words.
+     */
+    void orShifted(const std::vector<uint64_t>& src, std::vector<uint64_t>& dst, int64_t shift) {
+        int64_t words = shift / 64, bits = shift % 64;
+        for (int64_t i = static_cast<int64_t>(dst.size()) - 1; i >= words; --i) {
+            uint64_t word = src[i - words] << bits;
+            if (bits != 0 && i - words > 0)
+                word |= src[i - words - 1] >> (64 - bits);
+            dst[i] |= word;
+        }
+    }
+
+    /*
+     * Exact test for small iteration spaces, used when the tests above fail. The outer induction variables o are
+     * shared, and the accesses meet in different iterations i != i' of the innermost loop iff, on every known dimension,
+     *     coef1 * i - coef2 * i' = D(o) = freeCoef2 - freeCoef1 + sum((outerCoef2 - outerCoef1) * o).
+     * The distinct values of D are collected first, so that outer iterations with the same difference are solved once:
+     * in a bitset, shifted and or-ed a word at a time, when a single dimension is known, and in a hash set of vectors
+     * otherwise. Each value is then solved by enumerating i'. The test gives up once its work exceeds the budget, on
+     * coefficients or bounds of 2^28 or more, and when a sum over the outer levels overflows.
+     */
+    bool ExactTest(const ArrayAccess& access1, const ArrayAccess& access2) {
+        if (ExactTestBudget == 0)
+            return false;
+        std::vector<int> dimensions;
+        for (int index = 0; index < access1.arrayIndexAccesses.size(); ++index) {
+            if (access1.arrayIndexAccesses[index].isKnown && access2.arrayIndexAccesses[index].isKnown)
+                dimensions.push_back(index);
+        }
+        if (dimensions.empty() || access1.arrayIndexAccesses[dimensions[0]].linearCombination.empty())
+            return false;
+        const auto& levels = access1.arrayIndexAccesses[dimensions[0]].linearCombination;
+        int innermost = levels.size() - 1;
+        const Bounds& innerBounds = levels[innermost].bounds;
+        auto isSmall = [](int64_t value) {
+            return value > -(int64_t(1) << 28) && value < (int64_t(1) << 28);
+        };
+        auto hasSmallBounds = [&](const Bounds& bounds) {
+            return bounds.isKnown && isSmall(bounds.lowerBound) && isSmall(bounds.upperBound);
+        };
+        if (!hasSmallBounds(innerBounds))
+            return false;
+
+        int dims = dimensions.size();
+        std::vector<int64_t> base(dims), coef1(dims), coef2(dims);
+        std::vector<std::vector<int64_t>> outerDeltas;
+        std::vector<const Bounds*> outerBounds;
+        for (int d = 0; d < dims; ++d) {
+            const ArrayIndexAccess& indexAccess1 = access1.arrayIndexAccesses[dimensions[d]];
+            const ArrayIndexAccess& indexAccess2 = access2.arrayIndexAccesses[dimensions[d]];
+            base[d] = indexAccess2.freeCoef;
+            coef1[d] = indexAccess1.linearCombination[innermost].coef;
+            coef2[d] = indexAccess2.linearCombination[innermost].coef;
+            if (!checkedMulAdd(base[d], -1, indexAccess1.freeCoef) || !isSmall(base[d]) || !isSmall(coef1[d]) || !isSmall(coef2[d]))
+                return false;
+        }
+        // Levels with the same coefficients in both accesses do not move D and are not enumerated.
+        for (int level = 0; level < innermost; ++level) {
+            std::vector<int64_t> deltas(dims);
+            bool moves = false;
+            for (int d = 0; d < dims; ++d) {
+                deltas[d] = access2.arrayIndexAccesses[dimensions[d]].linearCombination[level].coef;
+                if (!checkedMulAdd(deltas[d], -1, access1.arrayIndexAccesses[dimensions[d]].linearCombination[level].coef) ||
+                    !isSmall(deltas[d]))
+                    return false;
+                moves |= deltas[d] != 0;
+            }
+            if (!moves)
+                continue;
+            if (!hasSmallBounds(levels[level].bounds))
+                return false;
+            outerDeltas.push_back(std::move(deltas));
+            outerBounds.push_back(&levels[level].bounds);
+        }
+
+        int64_t work = 0;
+        auto spend = [&](int64_t amount, int64_t times = 1) {
+            int64_t cost;
+            return !__builtin_mul_overflow(amount, times, &cost) && !__builtin_add_overflow(work, cost, &work) &&
+                   work <= ExactTestBudget;
+        };
+        int64_t L = innerBounds.lowerBound, U = innerBounds.upperBound;
+        int pivot = std::find_if(coef1.begin(), coef1.end(), [](int64_t coef) { return coef != 0; }) - coef1.begin();
+        auto meetsInOtherIteration = [&](const int64_t* D) {
+            for (int64_t i2 = L; i2 <= U; ++i2) {
+                if (pivot == dims) {
+                    bool meets = U > L;
+                    for (int d = 0; d < dims && meets; ++d) {
+                        int64_t value = D[d];
+                        meets = !checkedMulAdd(value, coef2[d], i2) || value == 0;
+                    }
+                    if (meets)
+                        return true;
+                    continue;
+                }
+                // A value that overflows may meet, as far as the test knows.
+                int64_t numerator = D[pivot];
+                if (!checkedMulAdd(numerator, coef2[pivot], i2))
+                    return true;
+                if (numerator % coef1[pivot] != 0)
+                    continue;
+                int64_t i1 = numerator / coef1[pivot];
+                if (i1 < L || i1 > U || i1 == i2)
+                    continue;
+                bool meets = true;
+                for (int d = 0; d < dims && meets; ++d)
+                    meets = coef1[d] * i1 - coef2[d] * i2 == D[d];
+                if (meets)
+                    return true;
+            }
+            return false;
+        };
+        int64_t solveCost = (U - L + 1) * dims;
+
+        if (dims == 1) {
+            // Every level adds |delta| * t for t in [0, upper - lower] on top of the smallest value of D.
+            int64_t lowest = base[0], width = 1;
+            for (int k = 0; k < outerDeltas.size(); ++k) {
+                int64_t delta = outerDeltas[k][0];
+                if (!checkedMulAdd(lowest, delta, delta > 0 ? outerBounds[k]->lowerBound : outerBounds[k]->upperBound) ||
+                    !checkedMulAdd(width, std::abs(delta), outerBounds[k]->upperBound - outerBounds[k]->lowerBound))
+                    return false;
+            }
+            // The values of D lie in [lowest, lowest + width), and (width + 63) must not wrap either.
+            int64_t highest = lowest;
+            if (!checkedMulAdd(highest, 1, width) || width > INT64_MAX - 63)
+                return false;
+            int64_t words = (width + 63) / 64;
+            if (!spend(words))
+                return false;
+            std::vector<uint64_t> values(words), next;
+            values[0] = 1;
+            for (int k = 0; k < outerDeltas.size(); ++k) {
+                int64_t step = std::abs(outerDeltas[k][0]), count = outerBounds[k]->upperBound - outerBounds[k]->lowerBound;
+                if (!spend(count, words))
+                    return false;
+                next = values;
+                for (int64_t t = 1; t <= count; ++t)
+                    orShifted(values, next, step * t);
+                values.swap(next);
+            }
+            for (int64_t w = 0; w < words; ++w) {
+                for (uint64_t word = values[w]; word != 0; word &= word - 1) {
+                    int64_t D = lowest + w * 64 + llvm::countr_zero(word);
+                    if (!spend(solveCost) || meetsInOtherIteration(&D))
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        std::unordered_set<std::vector<int64_t>, boost::hash<std::vector<int64_t>>> values{base}, next;
+        for (int k = 0; k < outerDeltas.size(); ++k) {
+            int64_t count = outerBounds[k]->upperBound - outerBounds[k]->lowerBound + 1;
+            if (!spend(values.size() * dims, count))
+                return false;
+            next.clear();
+            for (const auto& value : values) {
+                for (int64_t o = outerBounds[k]->lowerBound; o <= outerBounds[k]->upperBound; ++o) {
+                    std::vector<int64_t> moved(value);
+                    for (int d = 0; d < dims; ++d) {
+                        if (!checkedMulAdd(moved[d], outerDeltas[k][d], o))
+                            return false;
+                    }
+                    next.insert(std::move(moved));
+                }
             }
+            values.swap(next);
+        }
+        for (const auto& value : values) {
+            if (!spend(solveCost) || meetsInOtherIteration(value.data()))
+                return false;
+        }
+        return true;
+    }
 
-            ScalarEvolution &SE = AR.SE;
+    /*
+     * A system of affine constraints sum(coefs[v] * x_v) + constant == 0 or >= 0 over integer variables x_v.
+     */
+    struct OmegaConstraint {
+        std::vector<int64_t> coefs;
+        int64_t constant;
+    };
 
-            errs()<< "Analysing loop: " << L.getLocStr() << "\n";
+    struct OmegaProblem {
+        int variables = 0;
+        std::vector<OmegaConstraint> equalities;
+        std::vector<OmegaConstraint> inequalities;
+    };
 
-            auto [bounds, inductionVars] = extractParentLoopBounds(&L, SE, /* print = */ false);
+    enum class OmegaResult { Infeasible, Feasible, Unknown };
 
-            std::unordered_map<Value*, Value*> baseMap;
-            std::vector<ArrayAccess> arrayAccesses;
+    /*
+     * c1 += factor * c2, or false on overflow.
+     */
+    bool addScaled(OmegaConstraint& c1, int64_t factor, const OmegaConstraint& c2) {
+        for (int v = 0; v < c1.coefs.size(); ++v) {
+            if (!checkedMulAdd(c1.coefs[v], factor, c2.coefs[v]))
+                return false;
+        }
+        return checkedMulAdd(c1.constant, factor, c2.constant);
+    }
 
-            bool skip_loop = false;
+    int64_t floorDiv(int64_t a, int64_t b) {
+        return a / b - ((a % b != 0) && ((a < 0) != (b < 0)));
+    }
 
-            for (BasicBlock *BB : L.blocks()) {
-                for (Instruction &I : *BB)
-                {
-                    if (auto *Store = dyn_cast<StoreInst>(&I))
-                    {
-                        Value *ptrOperand = Store->getOperand(1);
-                        Value *base = getBasePointer(ptrOperand, baseMap);
-                        int totalDims = countArrayDimensions(extractTopLevelArrayType(base));
-                        if (totalDims == -1) // ptr param
-                            skip_loop = true;
-                        std::vector<std::string> accesses = extractArrayIndexAccess(ptrOperand, SE, totalDims, /* print = */ false);
-                        ArrayAccess arrayAccess;
-                        arrayAccess.baseAccess = base;
-                        arrayAccess.type = false;
-                        for (std::string access : accesses) {
-                            ArrayIndexAccess arrayIndexAccess = extractArrayIndexAccess(access, inductionVars, bounds);
-                            arrayAccess.arrayIndexAccesses.push_back(arrayIndexAccess);
-                        }
-                        arrayAccesses.push_back(arrayAccess);
-                        printArrayAccess(arrayAccess);
-                    }
-                    else if (auto *Load = dyn_cast<LoadInst>(&I))
-                    {
-                        Value *ptrOperand = Load->getOperand(0);
-                        Value *base = getBasePointer(ptrOperand, baseMap);
-                        int totalDims = countArrayDimensions(extractTopLevelArrayType(base));
-                        if (totalDims == -1) // ptr param
-                            skip_loop = true;
-                        std::vector<std::string> accesses = extractArrayIndexAccess(ptrOperand, SE, totalDims, /* print = */ false);
-                        ArrayAccess arrayAccess;
-                        arrayAccess.baseAccess = base;
-                        arrayAccess.type = true;
-                        for (std::string access : accesses) {
-                            ArrayIndexAccess arrayIndexAccess = extractArrayIndexAccess(access, inductionVars, bounds);
-                            arrayAccess.arrayIndexAccesses.push_back(arrayIndexAccess);
-                        }
-                        arrayAccesses.push_back(arrayAccess);
-                        printArrayAccess(arrayAccess);
-                    }
-                    else if (auto *GEP = dyn_cast<GetElementPtrInst>(&I))
-                    {
-                        Value *ptrOperand = GEP->getOperand(0)->stripPointerCasts();
-                        Value *base = getBasePointer(ptrOperand, baseMap);
-                        baseMap[GEP] = base;
-                    }
+    /*
+     * The symmetric remainder of Pugh, a - m * floor(a / m + 1 / 2), in [-m / 2, m / 2), or false on overflow.
+     */
+    bool modHat(int64_t a, int64_t m, int64_t& result) {
+        int64_t twiceA, numerator, denominator, product;
+        if (__builtin_mul_overflow(a, 2, &twiceA) || __builtin_add_overflow(twiceA, m, &numerator) ||
+            __builtin_mul_overflow(m, 2, &denominator) ||
+            __builtin_mul_overflow(m, floorDiv(numerator, denominator), &product))
+            return false;
+        return !__builtin_sub_overflow(a, product, &result);
+    }
+
+    /*
+     * Replace x_v by the expression of x_v == -(rest of equality) / coef in every constraint, where coef is 1 or -1.
+     */
+    bool substituteVariable(OmegaProblem& problem, int v, const OmegaConstraint& equality) {
+        for (auto* constraints : {&problem.equalities, &problem.inequalities}) {
+            for (OmegaConstraint& constraint : *constraints) {
+                int64_t factor = constraint.coefs[v], scale;
+                if (factor != 0 && (__builtin_mul_overflow(factor, equality.coefs[v], &scale) ||
+                                    __builtin_sub_overflow(0, scale, &scale) || !addScaled(constraint, scale, equality)))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+     * A coefficient or constant of INT64_MIN has no negation in 64 bits, which the solver takes on every constraint.
+     */
+    bool hasUnnegatableValue(const OmegaProblem& problem) {
+        for (const auto* constraints : {&problem.equalities, &problem.inequalities}) {
+            for (const OmegaConstraint& constraint : *constraints) {
+                if (constraint.constant == INT64_MIN || is_contained(constraint.coefs, INT64_MIN))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+     * Divide the constraints by the gcd of their coefficients, rounding the constant of inequalities down, which
+     * tightens them to the integer points. Constraints without variables are checked and dropped, and of two
+     * inequalities with the same coefficients only the tighter one is kept. No value of the problem may be INT64_MIN
+     * (see hasUnnegatableValue).
+     */
+    OmegaResult normalizeProblem(OmegaProblem& problem) {
+        auto normalize = [](OmegaConstraint& constraint, bool equality) {
+            int64_t gcd = 0;
+            for (int64_t coef : constraint.coefs)
+                gcd = std::gcd(gcd, coef < 0 ? -coef : coef);
+            if (gcd == 0)
+                return (equality ? constraint.constant == 0 : constraint.constant >= 0) ? OmegaResult::Feasible : OmegaResult::Infeasible;
+            if (equality && constraint.constant % gcd != 0)
+                return OmegaResult::Infeasible;
+            for (int64_t& coef : constraint.coefs)
+                coef /= gcd;
+            constraint.constant = floorDiv(constraint.constant, gcd);
+            return OmegaResult::Unknown;
+        };
+        std::vector<OmegaConstraint> equalities;
+        for (OmegaConstraint& equality : problem.equalities) {
+            OmegaResult result = normalize(equality, true);
+            if (result == OmegaResult::Infeasible)
+                return result;
+            if (result == OmegaResult::Unknown)
+                equalities.push_back(std::move(equality));
+        }
+        problem.equalities = std::move(equalities);
+
+        std::map<std::vector<int64_t>, int64_t> tightest;
+        for (OmegaConstraint& inequality : problem.inequalities) {
+            OmegaResult result = normalize(inequality, false);
+            if (result == OmegaResult::Infeasible)
+                return result;
+            if (result == OmegaResult::Feasible)
+                continue;
+            auto inserted = tightest.insert({inequality.coefs, inequality.constant});
+            if (!inserted.second)
+                inserted.first->second = std::min(inserted.first->second, inequality.constant);
+        }
+        problem.inequalities.clear();
+        for (const auto& entry : tightest) {
+            // Opposite inequalities e >= -c1 and -e >= -c2 leave no room if c1 + c2 < 0.
+            std::vector<int64_t> opposite(entry.first);
+            for (int64_t& coef : opposite)
+                coef = -coef;
+            auto it = tightest.find(opposite);
+            int64_t room;
+            if (it != tightest.end() && !__builtin_add_overflow(entry.second, it->second, &room) && room < 0)
+                return OmegaResult::Infeasible;
+            problem.inequalities.push_back({entry.first, entry.second});
+        }
+
+        // The inequalities of a single variable bound it to a box, and an inequality that holds on the whole box is
+        // redundant. This keeps the Fourier-Motzkin combinations of the loop bounds from piling up.
+        std::vector<int64_t> lowest(problem.variables, INT64_MIN), highest(problem.variables, INT64_MAX);
+        for (const OmegaConstraint& inequality : problem.inequalities) {
+            int count = 0, v = 0;
+            for (int u = 0; u < problem.variables; ++u) {
+                if (inequality.coefs[u] != 0) {
+                    ++count;
+                    v = u;
                 }
             }
+            if (count != 1)
+                continue;
+            if (inequality.coefs[v] > 0)
+                lowest[v] = std::max(lowest[v], -inequality.constant);
+            else
+                highest[v] = std::min(highest[v], inequality.constant);
+            if (lowest[v] > highest[v])
+                return OmegaResult::Infeasible;
+        }
+        auto isRedundant = [&](const OmegaConstraint& inequality) {
+            int64_t minimum = inequality.constant, count = 0;
+            for (int v = 0; v < problem.variables; ++v) {
+                int64_t coef = inequality.coefs[v], product;
+                if (coef == 0)
+                    continue;
+                ++count;
+                int64_t bound = coef > 0 ? lowest[v] : highest[v];
+                if (bound == INT64_MIN || bound == INT64_MAX || __builtin_mul_overflow(coef, bound, &product) ||
+                    __builtin_add_overflow(minimum, product, &minimum))
+                    return false;
+            }
+            return count > 1 && minimum >= 0;
+        };
+        problem.inequalities.erase(std::remove_if(problem.inequalities.begin(), problem.inequalities.end(), isRedundant),
+                                   problem.inequalities.end());
+        return OmegaResult::Unknown;
+    }
 
-            bool isParallelizable = true;
-            if (!skip_loop) {
-                for (int i = 0; i < arrayAccesses.size(); ++i) {
-                    for (int j = i + 1; j < arrayAccesses.size(); ++j) {
-                        if (arrayAccesses[i].baseAccess == arrayAccesses[j].baseAccess &&
-                            (!arrayAccesses[i].type || !arrayAccesses[j].type)) {
-                            isParallelizable &= isSafeParallelizable(arrayAccesses[i], arrayAccesses[j]);
-                        }
-                    }
+    /*
+     * Omega test (Pugh, 1991): decide whether the system has an integer solution. Equalities are eliminated exactly,
+     * with a new variable whenever no coefficient is 1 or -1, then variables are eliminated from the inequalities by
+     * Fourier-Motzkin. The elimination is exact on integers if every lower or every upper bound of the variable has a
+     * unit coefficient. Otherwise the problem is infeasible if the real shadow is, feasible if the dark shadow is, and
+     * else has a solution on one of the few planes parallel to a lower bound (the splinters). Every constraint built
+     * costs one unit of budget, and Unknown is returned once it is spent or on 64-bit overflow.
+     */
+    OmegaResult solveOmega(OmegaProblem problem, int64_t& budget) {
+        while (true) {
+            budget -= problem.equalities.size() + problem.inequalities.size();
+            if (budget < 0 || hasUnnegatableValue(problem))
+                return OmegaResult::Unknown;
+            if (normalizeProblem(problem) == OmegaResult::Infeasible)
+                return OmegaResult::Infeasible;
+            if (problem.equalities.empty())
+                break;
+
+            // Eliminate the variable with the smallest coefficient of the first equality.
+            OmegaConstraint equality = problem.equalities.front();
+            int v = -1;
+            for (int u = 0; u < problem.variables; ++u) {
+                if (equality.coefs[u] != 0 && (v < 0 || std::abs(equality.coefs[u]) < std::abs(equality.coefs[v])))
+                    v = u;
+            }
+            if (std::abs(equality.coefs[v]) != 1) {
+                // With m = |a_v| + 1, sum(modHat(a_u, m) * x_u) + modHat(c, m) == m * sigma has -sign(a_v) as the
+                // coefficient of x_v, and substituting it shrinks the coefficients of the equality.
+                int64_t m;
+                if (__builtin_add_overflow(std::abs(equality.coefs[v]), 1, &m))
+                    return OmegaResult::Unknown;
+                int sigma = problem.variables++;
+                for (auto* constraints : {&problem.equalities, &problem.inequalities}) {
+                    for (OmegaConstraint& constraint : *constraints)
+                        constraint.coefs.push_back(0);
                 }
-            } else {
-                isParallelizable = false;
+                OmegaConstraint reduced{std::vector<int64_t>(problem.variables, 0), 0};
+                if (!modHat(equality.constant, m, reduced.constant))
+                    return OmegaResult::Unknown;
+                for (int u = 0; u < sigma; ++u) {
+                    if (!modHat(equality.coefs[u], m, reduced.coefs[u]))
+                        return OmegaResult::Unknown;
+                }
+                reduced.coefs[sigma] = -m;
+                equality = std::move(reduced);
             }
+            if (!substituteVariable(problem, v, equality))
+                return OmegaResult::Unknown;
+        }
 
-            if (isParallelizable) {
-                errs() << "Loop is safe to be parallelized" << "\n";
+        // Pick the variable whose elimination builds the fewest constraints, preferring exact eliminations.
+        int best = -1;
+        bool bestExact = false;
+        int64_t bestCost = 0;
+        for (int v = 0; v < problem.variables; ++v) {
+            int64_t lower = 0, upper = 0;
+            bool unitLower = true, unitUpper = true;
+            for (const OmegaConstraint& inequality : problem.inequalities) {
+                int64_t coef = inequality.coefs[v];
+                if (coef > 0) {
+                    ++lower;
+                    unitLower &= coef == 1;
+                } else if (coef < 0) {
+                    ++upper;
+                    unitUpper &= coef == -1;
+                }
             }
-            else
-            {
-                errs() << "Loop is not safe to be parallelized" << "\n";
+            if (lower + upper == 0)
+                continue;
+            bool exact = unitLower || unitUpper;
+            int64_t cost = lower * upper - lower - upper;
+            if (best < 0 || (exact && !bestExact) || (exact == bestExact && cost < bestCost)) {
+                best = v;
+                bestExact = exact;
+                bestCost = cost;
             }
+        }
+        if (best < 0)
+            return OmegaResult::Feasible;
 
-            errs() << "==============================\n";
-            return PreservedAnalyses::all();
+        std::vector<const OmegaConstraint*> lowers, uppers;
+        OmegaProblem realShadow, darkShadow;
+        realShadow.variables = darkShadow.variables = problem.variables;
+        for (const OmegaConstraint& inequality : problem.inequalities) {
+            if (inequality.coefs[best] > 0)
+                lowers.push_back(&inequality);
+            else if (inequality.coefs[best] < 0)
+                uppers.push_back(&inequality);
+            else {
+                realShadow.inequalities.push_back(inequality);
+                darkShadow.inequalities.push_back(inequality);
+            }
+        }
+        budget -= static_cast<int64_t>(lowers.size() * uppers.size());
+        if (budget < 0)
+            return OmegaResult::Unknown;
+        // a * x + alpha >= 0 and -b * x + beta >= 0 have a real x iff b * alpha + a * beta >= 0, and an integer x if
+        // it is at least (a - 1) * (b - 1).
+        for (const OmegaConstraint* lower : lowers) {
+            for (const OmegaConstraint* upper : uppers) {
+                int64_t a = lower->coefs[best], b = -upper->coefs[best];
+                OmegaConstraint combined{std::vector<int64_t>(problem.variables, 0), 0};
+                if (!addScaled(combined, b, *lower) || !addScaled(combined, a, *upper))
+                    return OmegaResult::Unknown;
+                realShadow.inequalities.push_back(combined);
+                int64_t slack;
+                if (__builtin_mul_overflow(a - 1, b - 1, &slack) || __builtin_sub_overflow(combined.constant, slack, &combined.constant))
+                    return OmegaResult::Unknown;
+                darkShadow.inequalities.push_back(std::move(combined));
+            }
         }
+        if (bestExact)
+            return solveOmega(std::move(realShadow), budget);
 
-        static bool isRequired() { return true; }
-    };
-}
+        // Dependence problems are mostly feasible, which the dark shadow shows at once.
+        OmegaResult result = solveOmega(std::move(darkShadow), budget);
+        if (result != OmegaResult::Infeasible)
+            return result;
+        result = solveOmega(std::move(realShadow), budget);
+        if (result != OmegaResult::Feasible)
+            return result;
 
-// Boilerplate registration code.
-llvm::PassPluginLibraryInfo getParallelizePassInfo() {
-    const auto callback = [](PassBuilder &PB) {
-        PB.registerPipelineParsingCallback(
-                [&](StringRef name, LoopPassManager &LPM,
-                    ArrayRef<PassBuilder::PipelineElement>) {
-                    if (name == "loop-parallelization") {
-                        LPM.addPass(LoopParallelization());
+        // Integer points outside the dark shadow lie on a * x + alpha == i for some lower bound and small i >= 0.
+        int64_t maxUpper = 0;
+        for (const OmegaConstraint* upper : uppers)
+            maxUpper = std::max(maxUpper, -upper->coefs[best]);
+        for (const OmegaConstraint* lower : lowers) {
+            int64_t a = lower->coefs[best], splinters;
+            if (__builtin_mul_overflow(maxUpper, a, &splinters) || __builtin_sub_overflow(splinters, maxUpper, &splinters) ||
+                __builtin_sub_overflow(splinters, a, &splinters))
+                return OmegaResult::Unknown;
+            for (int64_t i = 0; i <= splinters / maxUpper; ++i) {
+                OmegaProblem splinter = problem;
+                splinter.equalities.push_back(*lower);
+                if (__builtin_sub_overflow(splinter.equalities.back().constant, i, &splinter.equalities.back().constant))
+                    return OmegaResult::Unknown;
+                result = solveOmega(std::move(splinter), budget);
+                if (result != OmegaResult::Infeasible)
+                    return result;
+            }
+        }
+        return OmegaResult::Infeasible;
+    }
+
+    /*
+     * The dependence problem of two accesses under a direction vector: variable 2k is the iteration of level k for
+     * access1 and 2k + 1 the one for access2. The subscripts of all known dimensions are equal at once, so coupled
+     * subscripts are handled together, and each iteration lies in the bounds of its loop.
+     */
+    OmegaProblem buildDependenceProblem(const ArrayAccess& access1, const ArrayAccess& access2,
+                                        const std::vector<Direction>& directions) {
+        OmegaProblem problem;
+        problem.variables = 2 * directions.size();
+        auto makeConstraint = [&](int64_t constant) {
+            return OmegaConstraint{std::vector<int64_t>(problem.variables, 0), constant};
+        };
+        const std::vector<IndexAccess>* levels = nullptr;
+        for (int index = 0; index < access1.arrayIndexAccesses.size(); ++index) {
+            const ArrayIndexAccess& indexAccess1 = access1.arrayIndexAccesses[index];
+            const ArrayIndexAccess& indexAccess2 = access2.arrayIndexAccesses[index];
+            if (!indexAccess1.isKnown || !indexAccess2.isKnown)
+                continue;
+            levels = &indexAccess1.linearCombination;
+            // Leaving out a dimension that does not fit only relaxes the problem.
+            OmegaConstraint equality = makeConstraint(indexAccess1.freeCoef);
+            bool overflow = !checkedMulAdd(equality.constant, -1, indexAccess2.freeCoef);
+            for (int level = 0; level < directions.size(); ++level) {
+                equality.coefs[2 * level] = indexAccess1.linearCombination[level].coef;
+                overflow |= !checkedMulAdd(equality.coefs[2 * level + 1], -1, indexAccess2.linearCombination[level].coef);
+            }
+            if (!overflow)
+                problem.equalities.push_back(std::move(equality));
+        }
+        if (!levels)
+            return problem;
+
+        for (int level = 0; level < directions.size(); ++level) {
+            const Bounds& bounds = (*levels)[level].bounds;
+            for (int v = 2 * level; v <= 2 * level + 1; ++v) {
+                OmegaConstraint lower = makeConstraint(0);
+                lower.coefs[v] = 1;
+                if (checkedMulAdd(lower.constant, -1, bounds.lowerBound))
+                    problem.inequalities.push_back(std::move(lower));
+                if (bounds.isKnown) {
+                    OmegaConstraint upper = makeConstraint(bounds.upperBound);
+                    upper.coefs[v] = -1;
+                    problem.inequalities.push_back(std::move(upper));
+                }
+            }
+            OmegaConstraint direction = makeConstraint(0);
+            switch (directions[level]) {
+                case Direction::EQ:
+                    direction.coefs[2 * level] = 1;
+                    direction.coefs[2 * level + 1] = -1;
+                    problem.equalities.push_back(std::move(direction));
+                    break;
+                case Direction::LT:
+                    direction.coefs[2 * level] = -1;
+                    direction.coefs[2 * level + 1] = 1;
+                    direction.constant = -1;
+                    problem.inequalities.push_back(std::move(direction));
+                    break;
+                case Direction::GT:
+                    direction.coefs[2 * level] = 1;
+                    direction.coefs[2 * level + 1] = -1;
+                    direction.constant = -1;
+                    problem.inequalities.push_back(std::move(direction));
+                    break;
+                default:
+                    break;
+            }
+        }
+        return problem;
+    }
+
+    /*
+     * False only if the Omega test proves that the accesses never meet with these directions. The problems of a loop
+     * share its budget, and a single problem may use a tenth of it, so that one hard problem does not starve the others.
+     */
+    bool mayDependByOmega(const ArrayAccess& access1, const ArrayAccess& access2, const std::vector<Direction>& directions,
+                          int64_t& budget) {
+        int64_t problemBudget = std::min<int64_t>(budget, OmegaBudget / 10);
+        if (problemBudget <= 0)
+            return true;
+        int64_t left = problemBudget;
+        OmegaResult result = solveOmega(buildDependenceProblem(access1, access2, directions), left);
+        budget -= problemBudget - std::max<int64_t>(left, 0);
+        return result != OmegaResult::Infeasible;
+    }
+
+    /*
+     * The innermost loop carries no dependence if the accesses cannot meet in two different iterations of it, with
+     * the iterations of the outer loops equal.
+     */
+    bool OmegaTest(const ArrayAccess& access1, const ArrayAccess& access2, int64_t& budget) {
+        if (access1.arrayIndexAccesses.empty() || access1.arrayIndexAccesses[0].linearCombination.empty())
+            return false;
+        std::vector<Direction> directions(access1.arrayIndexAccesses[0].linearCombination.size(), Direction::EQ);
+        for (Direction direction : {Direction::LT, Direction::GT}) {
+            directions.back() = direction;
+            if (mayDependByOmega(access1, access2, directions, budget))
+                return false;
+        }
+        return true;
+    }
+
+    /*
+     * The name of the first test that proves access1 and access2 independent, or nullptr if none does.
+     */
+    const char* getIndependenceTest(const ArrayAccess& access1, const ArrayAccess& access2, int64_t& omegaBudget) {
+        if (BanerjeeTest(access1, access2))
+            return "Banerjee";
+        if (StrongSIVTest(access1, access2))
+            return "StrongSIV";
+        if (SameAccess(access1, access2))
+            return "SameAccess";
+        if (GCDTest(access1, access2))
+            return "GCD";
+        if (ZIVTest(access1, access2))
+            return "ZIV";
+        if (SameReduction(access1, access2))
+            return "SameReduction";
+        if (OmegaTest(access1, access2, omegaBudget))
+            return "Omega";
+        if (ExactTest(access1, access2))
+            return "Exact";
+        return nullptr;
+    }
+
+    bool isSafeParallelizable(const ArrayAccess& access1, const ArrayAccess& access2) {
+        int64_t omegaBudget = OmegaBudget;
+        return getIndependenceTest(access1, access2, omegaBudget) != nullptr;
+    }
+
+    typedef function_ref<void(const ArrayAccess&, const ArrayAccess&, const char*)> PairCallback;
+
+    /*
+     * Test every pair of accesses to the same base where at least one of them is a write. Buckets that are only
+     * read are skipped, and the search stops at the first pair that cannot be proven independent. onPair, if given,
+     * is called with the test that proved each pair, and with nullptr for the pair the search stops at.
+     */
+    bool isSafeParallelizable(const ArrayAccessSet& arrayAccesses, PairCallback onPair = nullptr) {
+        int64_t omegaBudget = OmegaBudget;
+        auto isSafePair = [&](const ArrayAccess& access1, const ArrayAccess& access2) {
+            const char* test = getIndependenceTest(access1, access2, omegaBudget);
+            if (onPair)
+                onPair(access1, access2, test);
+            return test != nullptr;
+        };
+
+        const auto& accessesByBase = arrayAccesses.get<byBase>();
+        std::vector<const ArrayAccess*> reads, writes;
+        for (auto bucketBegin = accessesByBase.begin(); bucketBegin != accessesByBase.end(); ) {
+            auto bucketEnd = accessesByBase.equal_range(bucketBegin->baseAccess).second;
+            reads.clear();
+            writes.clear();
+            for (auto it = bucketBegin; it != bucketEnd; ++it) {
+                if (it->type)
+                    reads.push_back(&*it);
+                else
+                    writes.push_back(&*it);
+            }
+            bucketBegin = bucketEnd;
+
+            for (int i = 0; i < writes.size(); ++i) {
+                for (int j = i + 1; j < writes.size(); ++j) {
+                    if (!isSafePair(*writes[i], *writes[j]))
+                        return false;
+                }
+                for (const ArrayAccess* read : reads) {
+                    if (!isSafePair(*writes[i], *read))
+                        return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool isDirectionFeasible(const Bounds& bounds, Direction direction) {
+        if (direction != Direction::LT && direction != Direction::GT)
+            return true;
+        return !bounds.isKnown || bounds.upperBound > bounds.lowerBound;
+    }
+
+    /*
+     * Bounds of coef1 * i - coef2 * i' for i, i' in the bounds of a loop and related by direction. The region is a
+     * box for ALL, a diagonal for EQ and a triangle for LT / GT, so the extremes are reached on its vertices.
+     * Without a known upper bound U, the value on each vertex is linear in U: it is taken at the smallest U that
+     * makes the region non empty, and a side is unbounded if some vertex moves towards it as U grows.
+     * Return false if a value overflows.
+     */
+    bool directionalBounds(int64_t coef1, int64_t coef2, const Bounds& bounds, Direction direction, int64_t& lb, int64_t& ub,
+                           bool& lbUnbounded, bool& ubUnbounded) {
+        lbUnbounded = ubUnbounded = false;
+        if (coef1 == 0 && coef2 == 0) {
+            lb = ub = 0;
+            return true;
+        }
+        if (direction == Direction::EQ && coef1 == coef2) {
+            lb = ub = 0;
+            return true;
+        }
+
+        // The bounds come from trip counts below 2^63, so the vertices one step beyond them still fit.
+        auto getVertices = [direction](int64_t L, int64_t U) -> std::vector<std::pair<int64_t, int64_t> > {
+            switch (direction) {
+                case Direction::EQ:
+                    return {{L, L}, {U, U}};
+                case Direction::LT:
+                    return {{L, L + 1}, {L, U}, {U - 1, U}};
+                case Direction::GT:
+                    return {{L + 1, L}, {U, L}, {U, U - 1}};
+                default:
+                    return {{L, L}, {L, U}, {U, L}, {U, U}};
+            }
+        };
+        int64_t L = bounds.lowerBound;
+        int64_t U = bounds.upperBound;
+        if (!bounds.isKnown)
+            U = (direction == Direction::LT || direction == Direction::GT) ? L + 1 : L;
+        std::vector<std::pair<int64_t, int64_t> > vertices = getVertices(L, U);
+        std::vector<std::pair<int64_t, int64_t> > nextVertices = getVertices(L, U + 1);
+        auto getValue = [&](const std::pair<int64_t, int64_t>& vertex, int64_t& value) {
+            int64_t product;
+            value = 0;
+            return checkedMulAdd(value, coef1, vertex.first) && !__builtin_mul_overflow(coef2, vertex.second, &product) &&
+                   !__builtin_sub_overflow(value, product, &value);
+        };
+
+        if (!getValue(vertices[0], lb))
+            return false;
+        ub = lb;
+        for (int i = 0; i < vertices.size(); ++i) {
+            int64_t value;
+            if (!getValue(vertices[i], value))
+                return false;
+            lb = std::min(lb, value);
+            ub = std::max(ub, value);
+            if (!bounds.isKnown) {
+                int64_t nextValue;
+                if (!getValue(nextVertices[i], nextValue))
+                    return false;
+                lbUnbounded |= nextValue < value;
+                ubUnbounded |= nextValue > value;
+            }
+        }
+        return true;
+    }
+
+    /*
+     * Banerjee and GCD tests restricted to the direction vector. Return false if some dimension proves that the two
+     * accesses never touch the same element with these directions.
+     */
+    bool mayDependWithDirections(const ArrayAccess& access1, const ArrayAccess& access2, const std::vector<Direction>& directions) {
+        for (int index = 0; index < access1.arrayIndexAccesses.size(); ++index) {
+            const ArrayIndexAccess& indexAccess1 = access1.arrayIndexAccesses[index];
+            const ArrayIndexAccess& indexAccess2 = access2.arrayIndexAccesses[index];
+            if (!indexAccess1.isKnown || !indexAccess2.isKnown)
+                continue;
+
+            // Either test proves nothing on this dimension once one of its values overflows.
+            int64_t lb = indexAccess1.freeCoef, ub;
+            bool boundsOverflow = !checkedMulAdd(lb, -1, indexAccess2.freeCoef), gcdOverflow = false;
+            ub = lb;
+            bool lb_unbounded = false, ub_unbounded = false;
+            int64_t gcd = 0;
+            auto addToGcd = [&](int64_t coef) {
+                gcdOverflow |= coef == INT64_MIN;
+                if (!gcdOverflow)
+                    gcd = std::gcd(gcd, coef);
+            };
+            for (int i = 0; i < directions.size(); ++i) {
+                int64_t coef1 = indexAccess1.linearCombination[i].coef, coef2 = indexAccess2.linearCombination[i].coef;
+                int64_t delta_lb, delta_ub;
+                bool delta_lb_unbounded, delta_ub_unbounded;
+                boundsOverflow |= !directionalBounds(coef1, coef2, indexAccess1.linearCombination[i].bounds, directions[i],
+                                                     delta_lb, delta_ub, delta_lb_unbounded, delta_ub_unbounded) ||
+                                  !checkedMulAdd(lb, 1, delta_lb) || !checkedMulAdd(ub, 1, delta_ub);
+                lb_unbounded |= delta_lb_unbounded;
+                ub_unbounded |= delta_ub_unbounded;
+                if (directions[i] == Direction::EQ) {
+                    int64_t difference = coef1;
+                    gcdOverflow |= !checkedMulAdd(difference, -1, coef2);
+                    addToGcd(difference);
+                } else {
+                    addToGcd(coef1);
+                    addToGcd(coef2);
+                }
+            }
+            if (!boundsOverflow && ((!ub_unbounded && ub < 0) || (!lb_unbounded && lb > 0)))
+                return false;
+            int64_t freeRemainingCoef = indexAccess2.freeCoef;
+            gcdOverflow |= !checkedMulAdd(freeRemainingCoef, -1, indexAccess1.freeCoef);
+            if (!gcdOverflow && (gcd == 0 ? freeRemainingCoef != 0 : freeRemainingCoef % gcd != 0))
+                return false;
+        }
+        return true;
+    }
+
+    /*
+     * The distance at a level is known if some dimension only depends on that level with equal coefficients in both
+     * accesses (a strong SIV subscript), once the levels with direction EQ and equal coefficients cancel out.
+     */
+    std::vector<Distance> extractDistances(const ArrayAccess& access1, const ArrayAccess& access2, const std::vector<Direction>& directions) {
+        std::vector<Distance> distances(directions.size(), {false, 0});
+        for (int level = 0; level < directions.size(); ++level) {
+            if (directions[level] == Direction::EQ) {
+                distances[level] = {true, 0};
+                continue;
+            }
+            for (int index = 0; index < access1.arrayIndexAccesses.size() && !distances[level].isKnown; ++index) {
+                const ArrayIndexAccess& indexAccess1 = access1.arrayIndexAccesses[index];
+                const ArrayIndexAccess& indexAccess2 = access2.arrayIndexAccesses[index];
+                if (!indexAccess1.isKnown || !indexAccess2.isKnown)
+                    continue;
+                int64_t coef = indexAccess1.linearCombination[level].coef;
+                if (coef == 0 || coef != indexAccess2.linearCombination[level].coef)
+                    continue;
+                bool strongSIV = true;
+                for (int i = 0; i < directions.size(); ++i) {
+                    int64_t coef1 = indexAccess1.linearCombination[i].coef, coef2 = indexAccess2.linearCombination[i].coef;
+                    if (i != level && !(coef1 == 0 && coef2 == 0) && !(directions[i] == Direction::EQ && coef1 == coef2))
+                        strongSIV = false;
+                }
+                int64_t free_coef = indexAccess1.freeCoef;
+                if (!checkedMulAdd(free_coef, -1, indexAccess2.freeCoef) || free_coef == INT64_MIN)
+                    continue;
+                if (strongSIV && free_coef % coef == 0)
+                    distances[level] = {true, free_coef / coef};
+            }
+        }
+        return distances;
+    }
+
+    bool isLevelInSubscripts(const ArrayAccess& access1, const ArrayAccess& access2, int level) {
+        for (int index = 0; index < access1.arrayIndexAccesses.size(); ++index) {
+            const ArrayIndexAccess& indexAccess1 = access1.arrayIndexAccesses[index];
+            const ArrayIndexAccess& indexAccess2 = access2.arrayIndexAccesses[index];
+            if (!indexAccess1.isKnown || !indexAccess2.isKnown)
+                continue;
+            if (indexAccess1.linearCombination[level].coef != 0 || indexAccess2.linearCombination[level].coef != 0)
+                return true;
+        }
+        return false;
+    }
+
+    /*
+     * Hierarchical refinement: starting from (*, ..., *), the first ALL level of a direction vector that may carry a
+     * dependence is split into LT, EQ and GT, and only the feasible refinements are refined further. Levels that do not
+     * appear in any subscript are left as ALL, since every direction is equally possible there.
+     */
+    void refineDirections(const ArrayAccess& access1, const ArrayAccess& access2, const std::vector<Bounds>& bounds,
+                          std::vector<Direction>& directions, int level, std::vector<DependenceVector>& dependenceVectors,
+                          int64_t& omegaBudget) {
+        if (!mayDependWithDirections(access1, access2, directions))
+            return;
+        if (level == directions.size()) {
+            // A store does not depend on itself within the same iteration.
+            if (&access1 == &access2 && std::all_of(directions.begin(), directions.end(),
+                                                    [](Direction direction) { return direction == Direction::EQ; }))
+                return;
+            // The dimensions are tested together only on complete vectors, where the problems are the smallest.
+            if (!mayDependByOmega(access1, access2, directions, omegaBudget))
+                return;
+            dependenceVectors.push_back({directions, extractDistances(access1, access2, directions)});
+            return;
+        }
+        if (!isLevelInSubscripts(access1, access2, level)) {
+            refineDirections(access1, access2, bounds, directions, level + 1, dependenceVectors, omegaBudget);
+            return;
+        }
+        for (Direction direction : {Direction::LT, Direction::EQ, Direction::GT}) {
+            if (!isDirectionFeasible(bounds[level], direction))
+                continue;
+            directions[level] = direction;
+            refineDirections(access1, access2, bounds, directions, level + 1, dependenceVectors, omegaBudget);
+        }
+        directions[level] = Direction::ALL;
+    }
+
+    /*
+     * Direction vectors of every pair of accesses to the same base where at least one of them is a write, including
+     * a write with itself in other iterations.
+     */
+    std::vector<Dependence> computeDependences(const ArrayAccessSet& arrayAccesses, const std::vector<Bounds>& bounds) {
+        std::vector<Dependence> dependences;
+        int64_t omegaBudget = OmegaBudget;
+        const auto& accessesByBase = arrayAccesses.get<byBase>();
+        std::vector<const ArrayAccess*> reads, writes;
+        for (auto bucketBegin = accessesByBase.begin(); bucketBegin != accessesByBase.end(); ) {
+            auto bucketEnd = accessesByBase.equal_range(bucketBegin->baseAccess).second;
+            reads.clear();
+            writes.clear();
+            for (auto it = bucketBegin; it != bucketEnd; ++it) {
+                if (it->type)
+                    reads.push_back(&*it);
+                else
+                    writes.push_back(&*it);
+            }
+            bucketBegin = bucketEnd;
+
+            auto addDependence = [&](const ArrayAccess* access1, const ArrayAccess* access2) {
+                std::vector<Direction> directions(bounds.size(), Direction::ALL);
+                std::vector<DependenceVector> dependenceVectors;
+                refineDirections(*access1, *access2, bounds, directions, 0, dependenceVectors, omegaBudget);
+                if (!dependenceVectors.empty())
+                    dependences.push_back({access1, access2, std::move(dependenceVectors)});
+            };
+            for (int i = 0; i < writes.size(); ++i) {
+                for (int j = i; j < writes.size(); ++j)
+                    addDependence(writes[i], writes[j]);
+                for (const ArrayAccess* read : reads)
+                    addDependence(writes[i], read);
+            }
+        }
+        return dependences;
+    }
+
+    /*
+     * A dependence is carried by the first level whose direction is not EQ. ALL also stands for EQ, so the levels after
+     * it may carry the dependence as well. A loop can run its iterations in parallel (with the loops around it kept
+     * serial) if it carries no dependence.
+     */
+    std::vector<bool> extractCarriedLevels(const std::vector<Dependence>& dependences, int depth) {
+        std::vector<bool> carried(depth, false);
+        for (const Dependence& dependence : dependences) {
+            for (const DependenceVector& dependenceVector : dependence.dependenceVectors) {
+                for (int level = 0; level < depth; ++level) {
+                    Direction direction = dependenceVector.directions[level];
+                    if (direction != Direction::EQ)
+                        carried[level] = true;
+                    if (direction == Direction::LT || direction == Direction::GT)
+                        break;
+                }
+            }
+        }
+        return carried;
+    }
+
+    /*
+     * DOACROSS by chains: when every dependence the innermost loop carries, with the loops around it in the same
+     * iteration, has a known distance, the iterations whose indices differ by a multiple of the gcd g of the distances
+     * form g chains, and no chain touches an element touched by another one. Each chain runs in order, and the chains
+     * run in parallel. Return g, or 0 if a carried dependence has an unknown distance or there is none.
+     */
+    int64_t extractIndependentChains(const std::vector<Dependence>& dependences) {
+        int64_t chains = 0;
+        for (const Dependence& dependence : dependences) {
+            for (const DependenceVector& dependenceVector : dependence.dependenceVectors) {
+                const std::vector<Direction>& directions = dependenceVector.directions;
+                bool sameOuterIteration = std::all_of(directions.begin(), directions.end() - 1, [](Direction direction) {
+                    return direction == Direction::EQ || direction == Direction::ALL;
+                });
+                if (!sameOuterIteration || directions.back() == Direction::EQ)
+                    continue;
+                const Distance& distance = dependenceVector.distances.back();
+                if (!distance.isKnown || distance.value == 0 || distance.value == INT64_MIN)
+                    return 0;
+                chains = std::gcd(chains, std::abs(distance.value));
+            }
+        }
+        return chains;
+    }
+
+    /*
+     * Wavefronts: when every dependence the two innermost loops of a nest carry, with the loops around them in the same
+     * iteration, has known distances (d1, d2), the inner loop can be skewed by s, its iteration j becoming j + s * i, so
+     * that every distance becomes (d1, d2 + s * d1) with both components nonnegative. Rectangular tiles of the skewed
+     * iteration space then only depend on tiles above and to the left of them, and the tiles on an anti-diagonal can run
+     * in parallel. Return the smallest such s, or -1.
+     */
+    int64_t extractWavefrontSkew(const std::vector<Dependence>& dependences, int depth) {
+        if (depth < 2)
+            return -1;
+        int64_t skew = 0;
+        for (const Dependence& dependence : dependences) {
+            for (const DependenceVector& dependenceVector : dependence.dependenceVectors) {
+                const std::vector<Direction>& directions = dependenceVector.directions;
+                bool sameOuterIteration = std::all_of(directions.begin(), directions.end() - 2, [](Direction direction) {
+                    return direction == Direction::EQ || direction == Direction::ALL;
+                });
+                if (!sameOuterIteration)
+                    continue;
+                int64_t distances[2];
+                for (int i = 0; i < 2; ++i) {
+                    int level = depth - 2 + i;
+                    const Distance& distance = dependenceVector.distances[level];
+                    if (directions[level] == Direction::ALL || !distance.isKnown || distance.value == INT64_MIN)
+                        return -1;
+                    distances[i] = distance.value;
+                }
+                // Direction GT stands for the dependence from access2 to access1.
+                if (distances[0] < 0 || (distances[0] == 0 && distances[1] < 0)) {
+                    distances[0] = -distances[0];
+                    distances[1] = -distances[1];
+                }
+                if (distances[0] > 0 && distances[1] < 0)
+                    skew = std::max(skew, (-distances[1] - 1) / distances[0] + 1);
+            }
+        }
+        return skew;
+    }
+
+    char directionToChar(Direction direction) {
+        switch (direction) {
+            case Direction::LT: return '<';
+            case Direction::EQ: return '=';
+            case Direction::GT: return '>';
+            case Direction::ALL: return '*';
+        }
+        return '*';
+    }
+
+    void printDependence(const Dependence& dependence) {
+        report() << "Dependence between:\n";
+        printArrayAccess(*dependence.access1);
+        printArrayAccess(*dependence.access2);
+        for (const DependenceVector& dependenceVector : dependence.dependenceVectors) {
+            report() << "  Direction vector: (";
+            for (int i = 0; i < dependenceVector.directions.size(); ++i)
+                report() << (i ? ", " : "") << directionToChar(dependenceVector.directions[i]);
+            report() << ") Distance vector: (";
+            for (int i = 0; i < dependenceVector.distances.size(); ++i) {
+                report() << (i ? ", " : "");
+                if (dependenceVector.distances[i].isKnown)
+                    report() << dependenceVector.distances[i].value;
+                else
+                    report() << "unknown";
+            }
+            report() << ")\n";
+        }
+    }
+
+    /*
+     * The innermost loop of a nest in which every loop has a single sub-loop, or nullptr if the nest is not perfect.
+     */
+    Loop* getInnermostLoop(Loop &L) {
+        Loop *Innermost = &L;
+        while (!Innermost->getSubLoops().empty()) {
+            if (Innermost->getSubLoops().size() > 1)
+                return nullptr;
+            Innermost = Innermost->getSubLoops().front();
+        }
+        return Innermost;
+    }
+
+    bool hasMemoryAccessOutside(Loop &L, Loop *Inner) {
+        for (BasicBlock *BB : L.blocks()) {
+            if (Inner->contains(BB))
+                continue;
+            for (Instruction &I : *BB) {
+                if (isa<LoadInst>(I) || isa<StoreInst>(I))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+     * Writes whose own instances in two different iterations of the innermost loop may hit the same element. The
+     * pair tests only look at distinct accesses, but running such a loop in parallel would race on that element.
+     */
+    bool hasLoopCarriedOutputDependence(const ArrayAccessSet& arrayAccesses, const std::vector<Bounds>& bounds) {
+        if (bounds.empty() || !isDirectionFeasible(bounds.back(), Direction::LT))
+            return false;
+        std::vector<Direction> directions(bounds.size(), Direction::EQ);
+        directions.back() = Direction::LT;
+        for (const ArrayAccess& arrayAccess : arrayAccesses) {
+            if (!arrayAccess.type && !arrayAccess.isReduction && mayDependWithDirections(arrayAccess, arrayAccess, directions))
+                return true;
+        }
+        return false;
+    }
+
+    /*
+     * The dependence tests only see simple loads and stores. A call that reads memory may read an element that another
+     * iteration stores (a[i] = f(i), where f reads a[i - 1]), just as one that writes memory may write it, and atomic
+     * or volatile accesses, fences, atomicrmw and cmpxchg order or combine memory in ways the tests do not describe.
+     */
+    bool hasUnmodelledMemoryAccess(Loop &L) {
+        for (BasicBlock *BB : L.blocks()) {
+            for (Instruction &I : *BB) {
+                if (isa<DbgInfoIntrinsic>(I) || !I.mayReadOrWriteMemory())
+                    continue;
+                auto *Load = dyn_cast<LoadInst>(&I);
+                auto *Store = dyn_cast<StoreInst>(&I);
+                if (!(Load && Load->isSimple()) && !(Store && Store->isSimple()))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+     * What passes on other loops may change in L behind the back of its cached result: the headers of its loops, in
+     * preorder, and its memory instructions with their blocks.
+     */
+    void collectLoopShape(Loop &L, std::vector<Value*>& headers, std::vector<std::pair<Value*, Value*> >& memoryInstructions) {
+        for (Loop *Sub : L.getLoopsInPreorder())
+            headers.push_back(Sub->getHeader());
+        for (BasicBlock *BB : L.blocks()) {
+            for (Instruction &I : *BB) {
+                if (I.mayReadOrWriteMemory())
+                    memoryInstructions.push_back({&I, BB});
+            }
+        }
+    }
+
+    /*
+     * A stack array that the iterations of a loop only use as scratch space: every element an iteration reads has been
+     * written before in that iteration, so each thread can work on a copy of its own. If the array is read after the
+     * loop (isLiveOut), the copy of the thread that ran the last iteration is copied back. A scalar kept in an alloca
+     * (unoptimized code, temporaries whose address is taken) is an array of one element.
+     */
+    struct PrivateArray {
+        AllocaInst *alloca;
+        bool isLiveOut;
+    };
+
+    /*
+     * Collect the loads and stores of a stack array, through the GEPs and casts of its address. Return false if the
+     * address is used in any other way (passed to a call, stored, compared), since the array may then be accessed
+     * where the analysis does not see it.
+     */
+    bool collectStackArrayAccesses(AllocaInst *Alloca, std::vector<Instruction*>& accesses) {
+        std::vector<Instruction*> worklist = {Alloca};
+        while (!worklist.empty()) {
+            Instruction *Address = worklist.back();
+            worklist.pop_back();
+            for (User *U : Address->users()) {
+                auto *I = cast<Instruction>(U);
+                if (isa<GetElementPtrInst>(I) || isa<BitCastInst>(I) || isa<AddrSpaceCastInst>(I))
+                    worklist.push_back(I);
+                else if (auto *Load = dyn_cast<LoadInst>(I); Load && Load->isSimple())
+                    accesses.push_back(Load);
+                else if (auto *Store = dyn_cast<StoreInst>(I); Store && Store->isSimple() && Store->getValueOperand() != Address)
+                    accesses.push_back(Store);
+                else if (!I->isLifetimeStartOrEnd())
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    bool haveSameSubscripts(const ArrayAccess& access1, const ArrayAccess& access2) {
+        if (access1.arrayIndexAccesses.size() != access2.arrayIndexAccesses.size())
+            return false;
+        for (int index = 0; index < access1.arrayIndexAccesses.size(); ++index) {
+            const ArrayIndexAccess& indexAccess1 = access1.arrayIndexAccesses[index];
+            const ArrayIndexAccess& indexAccess2 = access2.arrayIndexAccesses[index];
+            if (!indexAccess1.isKnown || !indexAccess2.isKnown || indexAccess1.freeCoef != indexAccess2.freeCoef)
+                return false;
+            for (int i = 0; i < indexAccess1.linearCombination.size(); ++i) {
+                if (indexAccess1.linearCombination[i].coef != indexAccess2.linearCombination[i].coef)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+     * The stack arrays written in the innermost loop L whose every load in L reads an element that a store of the same
+     * type, with the same affine subscripts, has written before in the same iteration: the store dominates the load,
+     * so it ran on the way from the header to it. The values an iteration reads then never come from another iteration,
+     * and the dependences on the array are only the anti and output ones that a private copy per thread removes. The
+     * address of the array must not escape, so that nothing else accesses it. An array also read after the loop is only
+     * privatized if every iteration writes the same elements, with stores whose addresses are invariant in L and that
+     * run in every iteration: the last iteration then leaves the same values as the whole loop. Scalars written before
+     * they are read in every iteration, such as the temporaries of unoptimized code, are found the same way.
+     */
+    std::vector<PrivateArray> findPrivateArrays(Loop &L,
+                                                const std::unordered_map<const Instruction*, const ArrayAccess*>& instructionAccesses,
+                                                ScalarEvolution &SE, DominatorTree &DT) {
+        std::vector<AllocaInst*> allocas;
+        for (BasicBlock *BB : L.blocks()) {
+            for (Instruction &I : *BB) {
+                auto *Store = dyn_cast<StoreInst>(&I);
+                auto *Alloca = Store ? dyn_cast<AllocaInst>(instructionAccesses.at(Store)->baseAccess) : nullptr;
+                if (Alloca && Alloca->isStaticAlloca() && !Alloca->isArrayAllocation() &&
+                    (Alloca->getAllocatedType()->isArrayTy() || Alloca->getAllocatedType()->isSingleValueType()) &&
+                    !is_contained(allocas, Alloca))
+                    allocas.push_back(Alloca);
+            }
+        }
+
+        std::vector<PrivateArray> privateArrays;
+        for (AllocaInst *Alloca : allocas) {
+            std::vector<Instruction*> accesses;
+            if (!collectStackArrayAccesses(Alloca, accesses))
+                continue;
+            std::vector<LoadInst*> loads;
+            std::vector<StoreInst*> stores;
+            bool isLiveOut = false;
+            for (Instruction *I : accesses) {
+                if (!L.contains(I))
+                    isLiveOut = isLiveOut || isa<LoadInst>(I);
+                else if (auto *Load = dyn_cast<LoadInst>(I))
+                    loads.push_back(Load);
+                else
+                    stores.push_back(cast<StoreInst>(I));
+            }
+            // Addresses computed before the loop are rebuilt on the copy, which is only done for constant offsets.
+            auto hasPrivateAddress = [&](Instruction *I) {
+                for (Value *Address = getLoadStorePointerOperand(I); Address != Alloca;
+                     Address = cast<Instruction>(Address)->getOperand(0)) {
+                    auto *AddressInst = cast<Instruction>(Address);
+                    if (!L.contains(AddressInst) &&
+                        any_of(drop_begin(AddressInst->operands()), [](Value *Op) { return !isa<Constant>(Op); }))
+                        return false;
+                }
+                return true;
+            };
+            auto isCovered = [&](LoadInst *Load) {
+                return any_of(stores, [&](StoreInst *Store) {
+                    return Store->getValueOperand()->getType() == Load->getType() && DT.dominates(Store, Load) &&
+                           haveSameSubscripts(*instructionAccesses.at(Store), *instructionAccesses.at(Load));
+                });
+            };
+            if (!all_of(loads, hasPrivateAddress) || !all_of(stores, hasPrivateAddress) || !all_of(loads, isCovered))
+                continue;
+            if (isLiveOut && (!L.getLoopLatch() || !all_of(stores, [&](StoreInst *Store) {
+                    return DT.dominates(Store->getParent(), L.getLoopLatch()) &&
+                           SE.isLoopInvariant(SE.getSCEV(Store->getPointerOperand()), &L);
+                })))
+                continue;
+            privateArrays.push_back({Alloca, isLiveOut});
+        }
+        return privateArrays;
+    }
+
+    /*
+     * A runtime condition under which the accesses of a loop are proven safe: every symbolic upper bound of the nest is
+     * at most threshold.
+     */
+    struct BoundGuard {
+        std::vector<const SCEV*> upperBounds;
+        int64_t threshold;
+    };
+
+    /*
+     * Whether the innermost loop carries a dependence at a constant distance, with the loops around it in the same
+     * iteration. It is there whatever the trip counts, as soon as they exceed the distance.
+     */
+    bool hasConstantDistanceDependence(const std::vector<Dependence>& dependences) {
+        for (const Dependence& dependence : dependences) {
+            for (const DependenceVector& dependenceVector : dependence.dependenceVectors) {
+                const std::vector<Direction>& directions = dependenceVector.directions;
+                bool sameOuterIteration = std::all_of(directions.begin(), directions.end() - 1, [](Direction direction) {
+                    return direction == Direction::EQ || direction == Direction::ALL;
+                });
+                const Distance& distance = dependenceVector.distances.back();
+                if (sameOuterIteration && directions.back() != Direction::EQ && distance.isKnown && distance.value != 0)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+     * For a loop that the tests cannot prove safe as it is, look for the largest threshold (at least 1, i.e. two
+     * iterations) that makes them pass once the symbolic bounds are clamped to it. The tests only get harder as the
+     * bounds grow, so the threshold is found by bisection. Return false if there is no symbolic bound or no threshold.
+     * Every step re-runs the tests, so there is no search when a dependence at a constant distance is found: a guard
+     * could only allow loops too short to be worth running in parallel.
+     */
+    bool findBoundGuard(Loop &L, const std::vector<Bounds>& bounds, ScalarEvolution &SE, bool allowPointerBases,
+                        BoundGuard& guard, const std::vector<Reduction>& reductions = {}, AAResults *AA = nullptr) {
+        int64_t high = 0;
+        guard.upperBounds.clear();
+        for (const Bounds& bound : bounds) {
+            if (bound.symbolicUpperBound) {
+                guard.upperBounds.push_back(bound.symbolicUpperBound);
+                high = std::max(high, bound.isKnown ? bound.upperBound : maxSymbolicBound);
+            }
+        }
+        if (guard.upperBounds.empty())
+            return false;
+        ArrayAccessSet arrayAccesses;
+        if (collectArrayAccesses(L, bounds, SE, arrayAccesses, /* print = */ false, allowPointerBases, reductions,
+                                 /* instructionAccesses = */ nullptr, AA) &&
+            hasConstantDistanceDependence(computeDependences(arrayAccesses, bounds)))
+            return false;
+
+        auto isSafeWithThreshold = [&](int64_t threshold) {
+            std::vector<Bounds> clampedBounds = bounds;
+            for (Bounds& bound : clampedBounds) {
+                if (bound.symbolicUpperBound) {
+                    bound.upperBound = bound.isKnown ? std::min(bound.upperBound, threshold) : threshold;
+                    bound.isKnown = true;
+                }
+            }
+            ArrayAccessSet arrayAccesses;
+            return collectArrayAccesses(L, clampedBounds, SE, arrayAccesses, /* print = */ false, allowPointerBases, reductions,
+                                        /* instructionAccesses = */ nullptr, AA) &&
+                   isSafeParallelizable(arrayAccesses) && !hasLoopCarriedOutputDependence(arrayAccesses, clampedBounds);
+        };
+
+        int64_t low = 0;
+        while (low < high) {
+            int64_t middle = low + (high - low + 1) / 2;
+            if (isSafeWithThreshold(middle))
+                low = middle;
+            else
+                high = middle - 1;
+        }
+        guard.threshold = low;
+        return low >= 1;
+    }
+
+    void printBoundGuard(const BoundGuard& guard, raw_ostream& OS) {
+        for (int i = 0; i < guard.upperBounds.size(); ++i) {
+            if (i > 0)
+                OS << " && ";
+            OS << *guard.upperBounds[i] << " <= " << guard.threshold;
+        }
+    }
+
+    std::string getBoundGuardAsString(const BoundGuard& guard) {
+        std::string guardStr;
+        raw_string_ostream rso(guardStr);
+        printBoundGuard(guard, rso);
+        return rso.str();
+    }
+}
+
+struct LoopParallelismInfo::Impl {
+    // Innermost loops: the bounds of the loops around them, their reductions and accesses (with the access of every
+    // load and store), the test that proved each pair of accesses independent (nullptr for the pair the search stopped
+    // at), and the verdicts.
+    std::vector<Bounds> bounds;
+    std::vector<Reduction> reductions;
+    ArrayAccessSet arrayAccesses;
+    std::unordered_map<const Instruction*, const ArrayAccess*> instructionAccesses;
+    std::vector<std::tuple<const ArrayAccess*, const ArrayAccess*, const char*> > pairs;
+    // The stack arrays the loop is only parallel with a copy per thread of, and the accesses to the other bases, which
+    // the pairs then come from.
+    std::vector<PrivateArray> privateArrays;
+    ArrayAccessSet sharedAccesses;
+    bool knownRecurrences = false;
+    bool knownBases = false;
+    bool isIndependent = false;
+    bool isParallel = false;
+    // Whether the accesses are not safe as the loop is, and the largest trip counts under which they are. The search
+    // re-runs the tests many times, so it is left to getBoundGuard, on the first request.
+    bool needsGuard = false;
+    mutable bool guardSearched = false;
+    mutable bool hasGuard = false;
+    mutable BoundGuard guard;
+    // If they are not, the number of independent chains the iterations split into (see extractIndependentChains).
+    int64_t chains = 0;
+
+    // Outermost loops of a perfect nest (innermost is nullptr otherwise): the accesses of the innermost loop, over the
+    // bounds of the whole nest, and their dependences, if the bases are known.
+    Loop *innermost = nullptr;
+    std::vector<Bounds> nestBounds;
+    ArrayAccessSet nestAccesses;
+    bool knownNestBases = false;
+    std::vector<Dependence> dependences;
+
+    // The shape of L when it was analysed (see collectLoopShape). A loop pass only invalidates the results of the loop
+    // it ran on, so LICM hoisting an access out of the innermost loop of a nest drops the result of that loop but not
+    // the one of the root, and a pass on a parent loop may move accesses out of an innermost loop. The handles are
+    // nulled when the values are deleted.
+    std::vector<WeakVH> headers;
+    std::vector<std::pair<WeakVH, WeakVH> > memoryInstructions;
+};
+
+LoopParallelismInfo::LoopParallelismInfo(std::unique_ptr<Impl> impl) : impl(std::move(impl)) {}
+
+LoopParallelismInfo::LoopParallelismInfo(LoopParallelismInfo &&) = default;
+
+LoopParallelismInfo::~LoopParallelismInfo() = default;
+
+bool LoopParallelismInfo::isParallel() const {
+    return impl->isParallel;
+}
+
+int64_t LoopParallelismInfo::getIndependentChains() const {
+    return impl->chains > 1 ? impl->chains : 0;
+}
+
+int LoopParallelismInfo::getParallelLevel() const {
+    if (!impl->innermost || !impl->knownNestBases)
+        return -1;
+    std::vector<bool> carried = extractCarriedLevels(impl->dependences, impl->nestBounds.size());
+    auto parallelLevel = std::find(carried.begin(), carried.end(), false);
+    return parallelLevel != carried.end() ? std::distance(carried.begin(), parallelLevel) : -1;
+}
+
+std::vector<LoopParallelismInfo::AccessPair> LoopParallelismInfo::getAccessPairs() const {
+    std::vector<AccessPair> accessPairs;
+    for (auto [access1, access2, test] : impl->pairs)
+        accessPairs.push_back({access1->instruction, access2->instruction, test});
+    return accessPairs;
+}
+
+std::vector<LoopParallelismInfo::NestDependence> LoopParallelismInfo::getNestDependences() const {
+    std::vector<NestDependence> nestDependences;
+    for (const Dependence& dependence : impl->dependences)
+        nestDependences.push_back({dependence.access1->instruction, dependence.access2->instruction,
+                                   dependence.dependenceVectors});
+    return nestDependences;
+}
+
+/*
+ * The summary points to the instructions and SCEVs of the loop, so it only survives passes that preserve it. The loop
+ * analysis manager proxy also drops it along with ScalarEvolution, LoopInfo or the dominator tree. Passes on other loops
+ * of the nest are not seen here; getUpToDateResult catches the changes they make to L.
+ */
+bool LoopParallelismInfo::invalidate(Loop &L, const PreservedAnalyses &PA, LoopAnalysisManager::Invalidator &Inv) {
+    auto PAC = PA.getChecker<LoopParallelismAnalysis>();
+    return !PAC.preserved() && !PAC.preservedSet<AllAnalysesOn<Loop>>();
+}
+
+AnalysisKey LoopParallelismAnalysis::Key;
+
+LoopParallelismAnalysis::Result LoopParallelismAnalysis::run(Loop &L, LoopAnalysisManager &LAM,
+                                                             LoopStandardAnalysisResults &AR) {
+    auto info = std::make_unique<LoopParallelismInfo::Impl>();
+    ScalarEvolution &SE = AR.SE;
+
+    std::vector<Value*> headers;
+    std::vector<std::pair<Value*, Value*> > memoryInstructions;
+    collectLoopShape(L, headers, memoryInstructions);
+    info->headers.assign(headers.begin(), headers.end());
+    for (auto [I, BB] : memoryInstructions)
+        info->memoryInstructions.push_back({I, BB});
+
+    if (L.getSubLoops().empty()) {
+        info->bounds = extractParentLoopBounds(&L, SE, /* print = */ false);
+        info->knownRecurrences = findReductions(L, SE, AR.DT, info->reductions);
+        info->knownBases = collectArrayAccesses(L, info->bounds, SE, info->arrayAccesses, /* print = */ false,
+                                                /* allowPointerBases = */ false, info->reductions,
+                                                &info->instructionAccesses, &AR.AA);
+        if (info->knownBases && info->knownRecurrences) {
+            auto isSafeWith = [&](const ArrayAccessSet& arrayAccesses) {
+                info->pairs.clear();
+                info->isIndependent = isSafeParallelizable(arrayAccesses, [&](const ArrayAccess& access1,
+                                                                              const ArrayAccess& access2, const char* test) {
+                    info->pairs.push_back({&access1, &access2, test});
+                });
+                return info->isIndependent && !hasLoopCarriedOutputDependence(arrayAccesses, info->bounds);
+            };
+            bool isSafe = isSafeWith(info->arrayAccesses);
+            // Failing that, the scratch arrays of the iterations are left out, as every thread gets a copy of them.
+            if (!isSafe)
+                info->privateArrays = findPrivateArrays(L, info->instructionAccesses, SE, AR.DT);
+            if (!info->privateArrays.empty()) {
+                for (const ArrayAccess& arrayAccess : info->arrayAccesses) {
+                    if (none_of(info->privateArrays, [&](const PrivateArray& privateArray) {
+                            return privateArray.alloca == arrayAccess.baseAccess;
+                        }))
+                        info->sharedAccesses.push_back(arrayAccess);
+                }
+                isSafe = isSafeWith(info->sharedAccesses);
+                if (!isSafe) {
+                    info->privateArrays.clear();
+                    info->sharedAccesses.clear();
+                    isSafeWith(info->arrayAccesses);
+                }
+            }
+            info->isParallel = isSafe && !hasUnmodelledMemoryAccess(L);
+            if (!isSafe) {
+                info->needsGuard = true;
+                if (!hasUnmodelledMemoryAccess(L))
+                    info->chains = extractIndependentChains(computeDependences(info->arrayAccesses, info->bounds));
+            }
+        }
+    } else if (L.isOutermost()) {
+        Loop *Innermost = getInnermostLoop(L);
+        if (Innermost && !hasMemoryAccessOutside(L, Innermost)) {
+            info->innermost = Innermost;
+            info->nestBounds = extractParentLoopBounds(Innermost, SE, /* print = */ false);
+            info->knownNestBases = collectArrayAccesses(*Innermost, info->nestBounds, SE, info->nestAccesses,
+                                                        /* print = */ false, /* allowPointerBases = */ false,
+                                                        /* reductions = */ {}, /* instructionAccesses = */ nullptr, &AR.AA);
+            if (info->knownNestBases)
+                info->dependences = computeDependences(info->nestAccesses, info->nestBounds);
+        }
+    }
+    return LoopParallelismInfo(std::move(info));
+}
+
+const LoopParallelismInfo& LoopParallelismAnalysis::getUpToDateResult(Loop &L, LoopAnalysisManager &LAM,
+                                                                      LoopStandardAnalysisResults &AR) {
+    if (const LoopParallelismInfo *Cached = LAM.getCachedResult<LoopParallelismAnalysis>(L)) {
+        const LoopParallelismInfo::Impl& info = Cached->getImpl();
+        std::vector<Value*> headers;
+        std::vector<std::pair<Value*, Value*> > memoryInstructions;
+        collectLoopShape(L, headers, memoryInstructions);
+        bool isUpToDate =
+                std::equal(headers.begin(), headers.end(), info.headers.begin(), info.headers.end(),
+                           [](Value *Header, const WeakVH& Analysed) { return Header == Analysed; }) &&
+                std::equal(memoryInstructions.begin(), memoryInstructions.end(), info.memoryInstructions.begin(),
+                           info.memoryInstructions.end(), [](const auto& current, const auto& analysed) {
+                               return current.first == analysed.first && current.second == analysed.second;
+                           });
+        if (!isUpToDate) {
+            PreservedAnalyses PA = PreservedAnalyses::all();
+            PA.abandon<LoopParallelismAnalysis>();
+            LAM.invalidate(L, PA);
+        }
+    }
+    return LAM.getResult<LoopParallelismAnalysis>(L, AR);
+}
+
+namespace {
+    /*
+     * The bound guard of an innermost loop whose accesses are not safe as it is, searched for on the first call and
+     * kept in the summary. Return false if there is none.
+     */
+    bool getBoundGuard(Loop &L, const LoopParallelismInfo::Impl& info, ScalarEvolution &SE, AAResults &AA) {
+        if (!info.guardSearched && info.needsGuard)
+            info.hasGuard = findBoundGuard(L, info.bounds, SE, /* allowPointerBases = */ false, info.guard,
+                                           info.reductions, &AA);
+        info.guardSearched = true;
+        return info.hasGuard;
+    }
+
+
+    /*
+     * The loops that can be outlined: innermost loops in the form the README pipeline produces (not rotated, so the
+     * header is the only exiting block), whose header only holds the induction variable, with a constant step, the
+     * reduction phis and side effect free code. Nothing computed in the loop but the reductions may be used after it.
+     * Return the induction variable, or nullptr.
+     */
+    PHINode* getOutlinableInductionVariable(Loop &L, ScalarEvolution &SE, const std::vector<Reduction>& reductions) {
+        BasicBlock *Header = L.getHeader();
+        if (!L.getLoopPreheader() || !L.getLoopLatch() || L.getExitingBlock() != Header || !L.getUniqueExitBlock())
+            return nullptr;
+
+        auto isReductionPhi = [&](const Instruction *I) {
+            return any_of(reductions, [&](const Reduction& reduction) { return reduction.phi == I; });
+        };
+        PHINode *IndVar = nullptr;
+        for (PHINode &Phi : Header->phis()) {
+            if (isReductionPhi(&Phi))
+                continue;
+            if (IndVar)
+                return nullptr;
+            IndVar = &Phi;
+        }
+        if (!IndVar || (!IndVar->getType()->isIntegerTy(32) && !IndVar->getType()->isIntegerTy(64)))
+            return nullptr;
+        const auto *AddRec = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(IndVar));
+        if (!AddRec || AddRec->getLoop() != &L || !AddRec->isAffine() || !isa<SCEVConstant>(AddRec->getStepRecurrence(SE)))
+            return nullptr;
+        if (isa<SCEVCouldNotCompute>(SE.getExitCount(&L, Header)))
+            return nullptr;
+
+        for (BasicBlock *BB : L.blocks()) {
+            for (Instruction &I : *BB) {
+                if (BB == Header && I.mayHaveSideEffects())
+                    return nullptr;
+                for (User *U : I.users()) {
+                    if (!L.contains(cast<Instruction>(U)) && !isReductionPhi(&I))
+                        return nullptr;
+                }
+            }
+        }
+        return IndVar;
+    }
+
+    /*
+     * A level carries no dependence at all if every direction vector is EQ there: its iterations never touch an
+     * element touched by another of its iterations, whatever the loops around it do. Such a level can be interchanged
+     * with the loops around it, and runs in parallel wherever it is put.
+     */
+    std::vector<bool> extractDependenceFreeLevels(const std::vector<Dependence>& dependences, int depth) {
+        std::vector<bool> dependenceFree(depth, true);
+        for (const Dependence& dependence : dependences) {
+            for (const DependenceVector& dependenceVector : dependence.dependenceVectors) {
+                for (int level = 0; level < depth; ++level) {
+                    if (dependenceVector.directions[level] != Direction::EQ)
+                        dependenceFree[level] = false;
+                }
+            }
+        }
+        return dependenceFree;
+    }
+
+    /*
+     * Legality and profitability of parallelizing the perfect nest rooted at L as a whole, so that a single parallel
+     * region covers it instead of one per iteration of the loops around the innermost loop. The levels that carry no
+     * dependence at all, and whose bounds are invariant in the nest, can be interchanged outward: the whole nest is
+     * outlined and the iterations of such levels are split across the team, each thread running the nest with its own
+     * chunk of them. Adjacent levels are collapsed into one iteration space, and the run of levels with the most
+     * iterations (unknown trip counts count as large) is chosen, so that the chunks are balanced whatever the trip
+     * count of a single level. Failing that, the outermost level that carries no dependence with the loops around it
+     * kept serial is outlined by itself. Set Root to the loop to outline and IndVars to the induction variables of the
+     * levels whose iterations are split, and return false if only the innermost loop could be parallelized.
+     */
+    bool planNestParallelization(Loop &L, const LoopParallelismInfo::Impl& info, ScalarEvolution &SE, Loop *&Root,
+                                 std::vector<PHINode*>& IndVars) {
+        Loop *Innermost = info.innermost;
+        if (!Innermost || !info.knownNestBases || hasUnmodelledMemoryAccess(L))
+            return false;
+
+        const std::vector<Bounds>& bounds = info.nestBounds;
+        const std::vector<Dependence>& dependences = info.dependences;
+        std::vector<Loop*> loops;
+        for (Loop *Parent = Innermost; Parent != nullptr; Parent = Parent->getParentLoop())
+            loops.push_back(Parent);
+        std::reverse(loops.begin(), loops.end());
+        // The header of an outlined loop is replaced by the loop over the chunk, so the loops inside it have to be
+        // entered from preheaders of their own.
+        if (any_of(loops, [](const Loop *Level) { return !Level->isLoopSimplifyForm(); }))
+            return false;
+
+        std::vector<bool> dependenceFree = extractDependenceFreeLevels(dependences, bounds.size());
+        std::vector<bool> carried = extractCarriedLevels(dependences, bounds.size());
+
+        std::vector<PHINode*> levelIndVars(loops.size(), nullptr);
+        std::vector<int64_t> levelIterations(loops.size(), 0);
+        std::vector<APInt> levelMaxTripCounts(loops.size(), APInt(64, 0));
+        if (getOutlinableInductionVariable(L, SE, {})) {
+            SCEVExpander Expander(SE, L.getHeader()->getModule()->getDataLayout(), "omp");
+            Instruction *InsertPt = L.getLoopPreheader()->getTerminator();
+            for (int level = 0; level < loops.size(); ++level) {
+                PHINode *LevelIndVar = getOutlinableInductionVariable(*loops[level], SE, {});
+                if (!dependenceFree[level] || !LevelIndVar)
+                    continue;
+                const SCEV *Start = cast<SCEVAddRecExpr>(SE.getSCEV(LevelIndVar))->getStart();
+                const SCEV *TripCount = SE.getExitCount(loops[level], loops[level]->getHeader());
+                if (!SE.isLoopInvariant(Start, &L) || !SE.isLoopInvariant(TripCount, &L) ||
+                    !Expander.isSafeToExpandAt(Start, InsertPt) || !Expander.isSafeToExpandAt(TripCount, InsertPt))
+                    continue;
+                levelIndVars[level] = LevelIndVar;
+                levelIterations[level] = bounds[level].isKnown ? bounds[level].upperBound - bounds[level].lowerBound + 1
+                                                               : maxSymbolicBound;
+                Type *Int64Ty = Type::getInt64Ty(SE.getContext());
+                levelMaxTripCounts[level] = SE.getUnsignedRangeMax(SE.getTruncateOrZeroExtend(TripCount, Int64Ty));
+            }
+        }
+
+        // A single iteration is not worth a team, and a level only joins a run if it adds iterations. The collapsed
+        // iteration space is scheduled in unsigned 64 bits, so a level only joins a run if the product of the largest
+        // trip counts of its loops still fits.
+        int64_t bestIterations = 1;
+        IndVars.clear();
+        for (int begin = 0; begin < loops.size(); ++begin) {
+            int64_t iterations = 1;
+            APInt maxTripCount(64, 1);
+            for (int end = begin; end < loops.size() && levelIndVars[end]; ++end) {
+                bool overflows;
+                maxTripCount = maxTripCount.umul_ov(levelMaxTripCounts[end], overflows);
+                if (overflows)
+                    break;
+                iterations = std::min<int64_t>(iterations * levelIterations[end], int64_t(1) << 40);
+                if (iterations > bestIterations) {
+                    bestIterations = iterations;
+                    IndVars.assign(levelIndVars.begin() + begin, levelIndVars.begin() + end + 1);
+                }
+            }
+        }
+        if (!IndVars.empty()) {
+            Root = &L;
+            return true;
+        }
+
+        for (int level = 0; level + 1 < loops.size(); ++level) {
+            if (carried[level])
+                continue;
+            PHINode *IndVar = getOutlinableInductionVariable(*loops[level], SE, {});
+            if (!IndVar)
+                return false;
+            Root = loops[level];
+            IndVars = {IndVar};
+            return true;
+        }
+        return false;
+    }
+
+    /*
+     * Legality of running the two innermost loops of the perfect nest rooted at L as wavefronts of tiles (see
+     * extractWavefrontSkew), for nests where every loop carries a dependence, so that neither the whole nest nor a
+     * loop of it can be parallelized otherwise. Both loops have to be outlinable, the bounds of the inner one invariant
+     * in the outer one, and the skewed iteration space has to fit in 64 bits. Set Root to the outer loop of the two and
+     * Skew to the skew of the inner one.
+     */
+    bool planWavefront(Loop &L, const LoopParallelismInfo::Impl& info, ScalarEvolution &SE, Loop *&Root, int64_t& Skew) {
+        Loop *Innermost = info.innermost;
+        if (!WavefrontTile || !Innermost || Innermost == &L || !info.knownNestBases || hasUnmodelledMemoryAccess(L))
+            return false;
+
+        const std::vector<Bounds>& bounds = info.nestBounds;
+        int depth = bounds.size();
+        std::vector<bool> carried = extractCarriedLevels(info.dependences, depth);
+        if (std::find(carried.begin(), carried.end(), false) != carried.end())
+            return false;
+        Skew = extractWavefrontSkew(info.dependences, depth);
+        if (Skew == -1)
+            return false;
+
+        Loop *Outer = Innermost->getParentLoop();
+        PHINode *OuterIndVar = getOutlinableInductionVariable(*Outer, SE, {});
+        PHINode *InnerIndVar = getOutlinableInductionVariable(*Innermost, SE, {});
+        if (!OuterIndVar || !InnerIndVar)
+            return false;
+        SCEVExpander Expander(SE, L.getHeader()->getModule()->getDataLayout(), "omp");
+        Instruction *InsertPt = Outer->getLoopPreheader()->getTerminator();
+        for (auto [Level, LevelIndVar] : {std::pair(Outer, OuterIndVar), std::pair(Innermost, InnerIndVar)}) {
+            const SCEV *Start = cast<SCEVAddRecExpr>(SE.getSCEV(LevelIndVar))->getStart();
+            const SCEV *TripCount = SE.getExitCount(Level, Level->getHeader());
+            if (!SE.isLoopInvariant(Start, Outer) || !SE.isLoopInvariant(TripCount, Outer) ||
+                !Expander.isSafeToExpandAt(Start, InsertPt) || !Expander.isSafeToExpandAt(TripCount, InsertPt))
+                return false;
+        }
+
+        // The skewed inner index runs up to s * (n1 - 1) + n2, plus a tile. A trip count SCEV does not bound is still
+        // bounded by the width of the induction variable.
+        int64_t tripCounts[2];
+        for (int i = 0; i < 2; ++i) {
+            const Bounds& levelBounds = bounds[depth - 2 + i];
+            unsigned width = (i == 0 ? OuterIndVar : InnerIndVar)->getType()->getIntegerBitWidth();
+            if (!levelBounds.isKnown && width > 32)
+                return false;
+            tripCounts[i] = levelBounds.isKnown ? levelBounds.upperBound + 1 : int64_t(1) << width;
+        }
+        int64_t span = tripCounts[1] + WavefrontTile;
+        if (!checkedMulAdd(span, Skew, tripCounts[0]))
+            return false;
+        Root = Outer;
+        return true;
+    }
+
+    /*
+     * Values defined outside L (instructions and arguments) that the loop uses. They are handed to the outlined
+     * function through a context struct.
+     */
+    std::vector<Value*> extractLiveIns(Loop &L) {
+        std::vector<Value*> liveIns;
+        SmallPtrSet<Value*, 16> seen;
+        for (BasicBlock *BB : L.blocks()) {
+            for (Instruction &I : *BB) {
+                if (isa<DbgInfoIntrinsic>(I))
+                    continue;
+                for (Value *Op : I.operands()) {
+                    bool isLiveIn = isa<Argument>(Op) || (isa<Instruction>(Op) && !L.contains(cast<Instruction>(Op)));
+                    if (isLiveIn && seen.insert(Op).second)
+                        liveIns.push_back(Op);
+                }
+            }
+        }
+        return liveIns;
+    }
+
+    /*
+     * The ident_t the runtime calls of an outlined loop are made with.
+     */
+    Constant* getDefaultIdent(OpenMPIRBuilder &OMPBuilder) {
+        uint32_t SrcLocStrSize;
+        Constant *SrcLocStr = OMPBuilder.getOrCreateDefaultSrcLocStr(SrcLocStrSize);
+        return OMPBuilder.getOrCreateIdent(SrcLocStr, SrcLocStrSize);
+    }
+
+    /*
+     * Code cloned into an outlined function keeps debug info that refers to locals of the original function; drop it.
+     */
+    void dropDebugInfo(ArrayRef<BasicBlock*> blocks) {
+        for (BasicBlock *BB : blocks) {
+            for (Instruction &I : make_early_inc_range(*BB)) {
+                I.dropDbgRecords();
+                if (isa<DbgInfoIntrinsic>(I))
+                    I.eraseFromParent();
+            }
+        }
+    }
+
+    /*
+     * The context of an outlined function, allocated in the entry block of F.
+     */
+    AllocaInst* createContext(Function &F, StructType *ContextTy) {
+        IRBuilder<> AllocaBuilder(&*F.getEntryBlock().getFirstInsertionPt());
+        return AllocaBuilder.CreateAlloca(ContextTy, nullptr, "omp.context");
+    }
+
+    /*
+     * Run Outlined on a team of threads from the insertion point of Builder, passing Context to every thread.
+     */
+    void createForkCall(IRBuilder<> &Builder, OpenMPIRBuilder &OMPBuilder, Constant *Ident, Function *Outlined,
+                        Value *Context) {
+        Module &M = *Builder.GetInsertBlock()->getModule();
+        FunctionCallee ForkCall = OMPBuilder.getOrCreateRuntimeFunction(M, omp::RuntimeFunction::OMPRTL___kmpc_fork_call);
+        Builder.CreateCall(ForkCall, {Ident, Builder.getInt32(1), Outlined, Context});
+    }
+
+    /*
+     * The chunk of a thread in a static schedule: the indices [begin, end], and the flag the runtime sets in the thread
+     * that has the last index.
+     */
+    struct StaticChunk {
+        Value *begin;
+        Value *end;
+        AllocaInst *isLast;
+    };
+
+    /*
+     * Statically schedule the unsigned 64-bit indices [FirstIndex, LastIndex] across the team from the insertion point
+     * of Builder, with __kmpc_for_static_init_8u, and return the chunk of the calling thread. The variables the runtime
+     * writes are allocated in the entry block, so that a schedule run in a loop does not grow the stack.
+     */
+    StaticChunk createStaticSchedule(IRBuilder<> &Builder, OpenMPIRBuilder &OMPBuilder, Constant *Ident, Value *Tid,
+                                     Value *FirstIndex, Value *LastIndex) {
+        Function *F = Builder.GetInsertBlock()->getParent();
+        Module &M = *F->getParent();
+        Type *IVTy = Builder.getInt64Ty();
+        Constant *One = ConstantInt::get(IVTy, 1);
+        IRBuilder<> AllocaBuilder(&F->getEntryBlock(), F->getEntryBlock().begin());
+        AllocaInst *LastIter = AllocaBuilder.CreateAlloca(Builder.getInt32Ty(), nullptr, "omp.is_last");
+        AllocaInst *LowerBound = AllocaBuilder.CreateAlloca(IVTy, nullptr, "omp.lb");
+        AllocaInst *UpperBound = AllocaBuilder.CreateAlloca(IVTy, nullptr, "omp.ub");
+        AllocaInst *Stride = AllocaBuilder.CreateAlloca(IVTy, nullptr, "omp.stride");
+
+        Builder.CreateStore(Builder.getInt32(0), LastIter);
+        Builder.CreateStore(FirstIndex, LowerBound);
+        Builder.CreateStore(LastIndex, UpperBound);
+        Builder.CreateStore(One, Stride);
+        FunctionCallee StaticInit = OMPBuilder.getOrCreateRuntimeFunction(M, omp::RuntimeFunction::OMPRTL___kmpc_for_static_init_8u);
+        // Schedule 34 is kmp_sch_static: one contiguous chunk per thread.
+        Builder.CreateCall(StaticInit, {Ident, Tid, Builder.getInt32(34), LastIter, LowerBound, UpperBound, Stride, One, One});
+        Value *ChunkBegin = Builder.CreateLoad(IVTy, LowerBound, "omp.chunk.begin");
+        Value *ChunkEnd = Builder.CreateLoad(IVTy, UpperBound);
+        ChunkEnd = Builder.CreateSelect(Builder.CreateICmpUGT(ChunkEnd, LastIndex), LastIndex, ChunkEnd, "omp.chunk.end");
+        return {ChunkBegin, ChunkEnd, LastIter};
+    }
+
+    Constant* getReductionIdentity(RecurKind kind, Type *Ty) {
+        switch (kind) {
+            case RecurKind::Mul:
+                return ConstantInt::get(Ty, 1);
+            case RecurKind::And:
+            case RecurKind::UMin:
+                return Constant::getAllOnesValue(Ty);
+            case RecurKind::SMin:
+                return ConstantInt::get(Ty, APInt::getSignedMaxValue(Ty->getIntegerBitWidth()));
+            case RecurKind::SMax:
+                return ConstantInt::get(Ty, APInt::getSignedMinValue(Ty->getIntegerBitWidth()));
+            case RecurKind::FAdd:
+                return ConstantFP::getNegativeZero(Ty);
+            case RecurKind::FMul:
+                return ConstantFP::get(Ty, 1.0);
+            case RecurKind::FMin:
+                return ConstantFP::getInfinity(Ty, /* Negative = */ false);
+            case RecurKind::FMax:
+                return ConstantFP::getInfinity(Ty, /* Negative = */ true);
+            default:
+                return Constant::getNullValue(Ty);
+        }
+    }
+
+    Value* createReductionOp(IRBuilder<> &Builder, const Reduction& reduction, Value *Left, Value *Right) {
+        IRBuilder<>::FastMathFlagGuard Guard(Builder);
+        Builder.setFastMathFlags(reduction.FMF);
+        if (RecurrenceDescriptor::isMinMaxRecurrenceKind(reduction.kind))
+            return createMinMaxOp(Builder, reduction.kind, Left, Right);
+        return Builder.CreateBinOp(static_cast<Instruction::BinaryOps>(RecurrenceDescriptor::getOpcode(reduction.kind)),
+                                   Left, Right, "omp.red.op");
+    }
+
+    /*
+     * Make ClonedHeader, the clone of the header of Level, branch into the loop while Condition holds, whichever
+     * successor the loop is.
+     */
+    void setLoopCondition(Loop *Level, BasicBlock *ClonedHeader, Value *Condition) {
+        auto *Branch = cast<BranchInst>(ClonedHeader->getTerminator());
+        Value *OldCondition = Branch->getCondition();
+        if (!Level->contains(Level->getHeader()->getTerminator()->getSuccessor(0)))
+            Condition = BinaryOperator::CreateNot(Condition, "", Branch);
+        Branch->setCondition(Condition);
+        RecursivelyDeleteTriviallyDeadInstructions(OldCondition);
+    }
+
+    /*
+     * Split the unsigned 64-bit Iteration into digits in the mixed radix of radices, the trip counts of collapsed loops
+     * from the outermost one, at the insertion point of Builder.
+     */
+    std::vector<Value*> splitIntoDigits(IRBuilder<> &Builder, Value *Iteration, ArrayRef<Value*> radices) {
+        Type *IVTy = Iteration->getType();
+        std::vector<Value*> digits(radices.size());
+        Value *Rest = Iteration;
+        for (int j = radices.size() - 1; j >= 0; --j) {
+            // A trip count of zero leaves every chunk empty, but the division must not trap.
+            Value *Radix = Builder.CreateSelect(Builder.CreateICmpEQ(radices[j], ConstantInt::get(IVTy, 0)),
+                                                ConstantInt::get(IVTy, 1), radices[j]);
+            digits[j] = Builder.CreateURem(Rest, Radix, "omp.digit");
+            Rest = Builder.CreateUDiv(Rest, Radix);
+        }
+        return digits;
+    }
+
+    /*
+     * Count the digits of splitIntoDigits up by one, like an odometer, at the insertion point of Builder, which is in
+     * the latch of the loop whose header holds the phis of the digits.
+     */
+    void advanceDigits(IRBuilder<> &Builder, ArrayRef<PHINode*> digits, ArrayRef<Value*> radices) {
+        BasicBlock *Latch = Builder.GetInsertBlock();
+        Value *Carry = Builder.getTrue();
+        for (int j = digits.size() - 1; j >= 0; --j) {
+            Type *IVTy = digits[j]->getType();
+            Value *Next = Builder.CreateAdd(digits[j], Builder.CreateZExt(Carry, IVTy), "omp.index.next");
+            Value *Wraps = Builder.CreateICmpEQ(Next, radices[j]);
+            digits[j]->addIncoming(Builder.CreateSelect(Wraps, ConstantInt::get(IVTy, 0), Next), Latch);
+            Carry = Wraps;
+        }
+    }
+
+    /*
+     * The iteration after Iteration when the iterations are run by chains of Chains: NextIteration, Iteration + Chains,
+     * within the chain, and the first iteration of the next chain past its end. Chain, the phi of the chain in the
+     * header, is advanced along, from the latch the insertion point of Builder is in.
+     */
+    Value* advanceChain(IRBuilder<> &Builder, Value *Iteration, Value *NextIteration, PHINode *Chain, Value *TripCount,
+                        Constant *Chains) {
+        // The iterations left are compared with the distance, since the next iteration of the chain may wrap past the
+        // top of i64.
+        Value *NextChain = Builder.CreateAdd(Chain, ConstantInt::get(Chain->getType(), 1), "omp.chain.next");
+        Value *Left = Builder.CreateSub(TripCount, Iteration, "omp.chain.left");
+        Value *EndsChain = Builder.CreateICmpULE(Left, Chains, "omp.chain.end");
+        Chain->addIncoming(Builder.CreateSelect(EndsChain, NextChain, Chain), Builder.GetInsertBlock());
+        return Builder.CreateSelect(EndsChain, NextChain, NextIteration);
+    }
+
+    /*
+     * Give every thread its own copy of the private arrays at the insertion point of Builder, mapping the arrays and
+     * the addresses in them that are live into the loop to the copy in VMap. A copy that is live after the loop starts
+     * from the shared array, and the pair of the two is added to copiedOut, to be copied back.
+     */
+    void createPrivateCopies(IRBuilder<> &Builder, const std::vector<PrivateArray>& privateArrays,
+                             ArrayRef<Value*> liveIns, ValueToValueMapTy &VMap,
+                             std::vector<std::pair<Value*, AllocaInst*> >& copiedOut) {
+        const DataLayout &DL = Builder.GetInsertBlock()->getModule()->getDataLayout();
+        for (const PrivateArray& privateArray : privateArrays) {
+            AllocaInst *Alloca = privateArray.alloca;
+            Value *Shared = VMap[Alloca];
+            AllocaInst *Private = Builder.CreateAlloca(Alloca->getAllocatedType(), nullptr, Alloca->getName() + ".private");
+            Private->setAlignment(Alloca->getAlign());
+            if (privateArray.isLiveOut) {
+                Builder.CreateMemCpy(Private, Alloca->getAlign(), Shared, Alloca->getAlign(),
+                                     DL.getTypeAllocSize(Alloca->getAllocatedType()));
+                copiedOut.push_back({Shared, Private});
+            }
+            VMap[Alloca] = Private;
+            // Addresses in the array computed before the loop, with constant offsets, are computed again in the copy.
+            for (Value *LiveIn : liveIns) {
+                std::vector<Instruction*> chain;
+                Value *Base = LiveIn;
+                for (; isa<GetElementPtrInst>(Base) || isa<BitCastInst>(Base) || isa<AddrSpaceCastInst>(Base);
+                     Base = cast<Instruction>(Base)->getOperand(0))
+                    chain.push_back(cast<Instruction>(Base));
+                if (Base != Alloca || chain.empty())
+                    continue;
+                Value *Address = Private;
+                for (Instruction *I : reverse(chain)) {
+                    Instruction *Clone = I->clone();
+                    Clone->setOperand(0, Address);
+                    Address = Builder.Insert(Clone, I->getName());
+                }
+                VMap[LiveIn] = Address;
+            }
+        }
+    }
+
+    /*
+     * Copy the private arrays of createPrivateCopies back to the shared ones in the thread whose IsLast flag the
+     * runtime set, the one that ran the last iteration. Builder is left after the copy.
+     */
+    void copyOutPrivateArrays(IRBuilder<> &Builder, AllocaInst *IsLast,
+                              ArrayRef<std::pair<Value*, AllocaInst*> > copiedOut) {
+        Function *Outlined = Builder.GetInsertBlock()->getParent();
+        LLVMContext &Ctx = Outlined->getContext();
+        const DataLayout &DL = Outlined->getParent()->getDataLayout();
+        BasicBlock *CopyOut = BasicBlock::Create(Ctx, "omp.copy_out", Outlined);
+        BasicBlock *CopyOutExit = BasicBlock::Create(Ctx, "omp.copy_out.exit", Outlined);
+        Value *RanLast = Builder.CreateICmpNE(Builder.CreateLoad(Builder.getInt32Ty(), IsLast), Builder.getInt32(0),
+                                             "omp.last");
+        Builder.CreateCondBr(RanLast, CopyOut, CopyOutExit);
+        Builder.SetInsertPoint(CopyOut);
+        for (auto [Shared, Private] : copiedOut)
+            Builder.CreateMemCpy(Shared, Private->getAlign(), Private, Private->getAlign(),
+                                 DL.getTypeAllocSize(Private->getAllocatedType()));
+        Builder.CreateBr(CopyOutExit);
+        Builder.SetInsertPoint(CopyOutExit);
+    }
+
+    /*
+     * Combine the partial results of the reductions, the accumulators of every thread, in a tree at the insertion point
+     * of Builder, in the outlined function: each thread stores its accumulators in its slot of Partials, an array of
+     * PartialsTy with one slot per thread, and the team combines the slots between barriers, leaving the result in slot
+     * 0. Builder is left after the combination.
+     */
+    void combinePartials(IRBuilder<> &Builder, OpenMPIRBuilder &OMPBuilder, Constant *Ident, Value *Tid,
+                         const std::vector<Reduction>& reductions, ArrayRef<PHINode*> accumulators,
+                         StructType *PartialsTy, Value *Partials) {
+        BasicBlock *CombineEntry = Builder.GetInsertBlock();
+        Function *Outlined = CombineEntry->getParent();
+        Module &M = *Outlined->getParent();
+        LLVMContext &Ctx = M.getContext();
+        Type *Int32Ty = Builder.getInt32Ty();
+        // for (stride = 1; stride < threads; stride *= 2)
+        //     barrier; if (thread % (2 * stride) == 0 && thread + stride < threads)
+        //         slot[thread] op= slot[thread + stride]
+        BasicBlock *CombineHeader = BasicBlock::Create(Ctx, "omp.red.header", Outlined);
+        BasicBlock *CombineStep = BasicBlock::Create(Ctx, "omp.red.step", Outlined);
+        BasicBlock *Combine = BasicBlock::Create(Ctx, "omp.red.combine", Outlined);
+        BasicBlock *CombineLatch = BasicBlock::Create(Ctx, "omp.red.latch", Outlined);
+        BasicBlock *CombineExit = BasicBlock::Create(Ctx, "omp.red.exit", Outlined);
+
+        Value *Thread = Builder.CreateLoad(Int32Ty, Outlined->getArg(1), "omp.thread");
+        Value *Threads = Builder.CreateCall(OMPBuilder.getOrCreateRuntimeFunction(M, omp::RuntimeFunction::OMPRTL_omp_get_num_threads),
+                                            {}, "omp.threads");
+        Value *Slot = Builder.CreateInBoundsGEP(PartialsTy, Partials, Builder.CreateZExt(Thread, Builder.getInt64Ty()), "omp.slot");
+        for (int i = 0; i < reductions.size(); ++i)
+            Builder.CreateStore(accumulators[i], Builder.CreateStructGEP(PartialsTy, Slot, i));
+        Builder.CreateBr(CombineHeader);
+
+        Builder.SetInsertPoint(CombineHeader);
+        PHINode *CombineStride = Builder.CreatePHI(Int32Ty, 2, "omp.red.stride");
+        CombineStride->addIncoming(Builder.getInt32(1), CombineEntry);
+        Builder.CreateCondBr(Builder.CreateICmpULT(CombineStride, Threads), CombineStep, CombineExit);
+
+        Builder.SetInsertPoint(CombineStep);
+        Builder.CreateCall(OMPBuilder.getOrCreateRuntimeFunction(M, omp::RuntimeFunction::OMPRTL___kmpc_barrier), {Ident, Tid});
+        Value *NextStride = Builder.CreateShl(CombineStride, 1, "omp.red.stride.next");
+        Value *Partner = Builder.CreateAdd(Thread, CombineStride, "omp.red.partner");
+        Value *IsCombining = Builder.CreateAnd(Builder.CreateICmpEQ(Builder.CreateURem(Thread, NextStride), Builder.getInt32(0)),
+                                               Builder.CreateICmpULT(Partner, Threads));
+        Builder.CreateCondBr(IsCombining, Combine, CombineLatch);
+
+        Builder.SetInsertPoint(Combine);
+        Value *PartnerSlot = Builder.CreateInBoundsGEP(PartialsTy, Partials, Builder.CreateZExt(Partner, Builder.getInt64Ty()));
+        for (int i = 0; i < reductions.size(); ++i) {
+            Type *PartialTy = PartialsTy->getElementType(i);
+            Value *Field = Builder.CreateStructGEP(PartialsTy, Slot, i);
+            Value *Left = Builder.CreateLoad(PartialTy, Field);
+            Value *Right = Builder.CreateLoad(PartialTy, Builder.CreateStructGEP(PartialsTy, PartnerSlot, i));
+            Builder.CreateStore(createReductionOp(Builder, reductions[i], Left, Right), Field);
+        }
+        Builder.CreateBr(CombineLatch);
+
+        Builder.SetInsertPoint(CombineLatch);
+        CombineStride->addIncoming(NextStride, CombineLatch);
+        Builder.CreateBr(CombineHeader);
+
+        Builder.SetInsertPoint(CombineExit);
+    }
+
+    /*
+     * Outline the iterations of L into
+     *   void <function>.omp_outlined(i32* gtid, i32* btid, ctx*)
+     * which statically schedules [0, trip count) across the team with __kmpc_for_static_init, and replace the loop
+     * with a __kmpc_fork_call of it. The context struct carries the start and the trip count of every scheduled
+     * induction variable, the live-in values and, for the reductions, a buffer with one slot per thread.
+     * Every thread accumulates the reductions privately from their identity, stores its partial results in its slot and
+     * the team combines the slots in a tree, between barriers. The result in slot 0 is then combined with the initial
+     * value after the join.
+     * IndVars may also be the induction variables of loops nested in L (see planNestParallelization), whose iterations
+     * are then the ones scheduled: every thread runs the whole of L, with those loops restricted to its chunk. Several
+     * induction variables, of perfectly nested loops from the outermost one, are collapsed into one iteration space.
+     * With chains (see extractIndependentChains), the chains of L are scheduled instead of its iterations, and every
+     * thread runs the iterations of each of its chains in order.
+     * Every thread accesses its own copy of the private arrays (see findPrivateArrays). A copy that is live after the
+     * loop starts from the shared array, and the thread that ran the last iteration copies it back once the whole
+     * team has made its copy.
+     */
+    void outlineParallelLoop(Loop &L, ArrayRef<PHINode*> IndVars, const std::vector<Reduction>& reductions,
+                             OpenMPIRBuilder &OMPBuilder, ScalarEvolution &SE, LoopInfo &LI, DominatorTree &DT,
+                             int64_t chains = 0, const std::vector<PrivateArray>& privateArrays = {}) {
+        Function *F = L.getHeader()->getParent();
+        Module &M = *F->getParent();
+        LLVMContext &Ctx = M.getContext();
+        BasicBlock *Header = L.getHeader();
+        BasicBlock *Preheader = L.getLoopPreheader();
+        PHINode *IndVar = IndVars.front();
+        bool isCollapsed = IndVars.size() > 1;
+        // The scheduled iteration space is unsigned 64-bit: it holds the trip count of any 32 or 64-bit induction
+        // variable, and the product of the trip counts of collapsed loops, which planNestParallelization proved to fit.
+        Type *IVTy = Type::getInt64Ty(Ctx);
+        Type *Int32Ty = Type::getInt32Ty(Ctx);
+        Type *PtrTy = PointerType::getUnqual(Ctx);
+        Loop *Distributed = LI.getLoopFor(IndVar->getParent());
+        assert((Distributed == &L || reductions.empty()) && "Reductions are only outlined with their own loop");
+        assert((!chains || (Distributed == &L && !isCollapsed)) && "Chains are only scheduled in their own loop");
+        assert((privateArrays.empty() || (Distributed == &L && !chains)) && "Arrays are only private to parallel loops");
+
+        std::vector<Loop*> levelLoops;
+        std::vector<Type*> levelTypes;
+        std::vector<const SCEV*> levelStarts, levelTripCounts;
+        std::vector<Constant*> levelSteps;
+        for (PHINode *LevelIndVar : IndVars) {
+            Loop *Level = LI.getLoopFor(LevelIndVar->getParent());
+            const auto *AddRec = cast<SCEVAddRecExpr>(SE.getSCEV(LevelIndVar));
+            levelLoops.push_back(Level);
+            levelTypes.push_back(LevelIndVar->getType());
+            levelStarts.push_back(AddRec->getStart());
+            levelTripCounts.push_back(SE.getTruncateOrZeroExtend(SE.getExitCount(Level, Level->getHeader()), IVTy));
+            levelSteps.push_back(cast<SCEVConstant>(AddRec->getStepRecurrence(SE))->getValue());
+        }
+        Constant *Step = levelSteps.front();
+
+        std::vector<Value*> liveIns = extractLiveIns(L);
+        for (const PrivateArray& privateArray : privateArrays) {
+            if (!is_contained(liveIns, privateArray.alloca))
+                liveIns.push_back(privateArray.alloca);
+        }
+        std::vector<Type*> contextTypes;
+        for (Type *LevelTy : levelTypes) {
+            contextTypes.push_back(LevelTy);
+            contextTypes.push_back(IVTy);
+        }
+        int liveInsIndex = contextTypes.size();
+        for (Value *V : liveIns)
+            contextTypes.push_back(V->getType());
+        int partialsIndex = contextTypes.size();
+        std::vector<Type*> partialTypes;
+        for (const Reduction& reduction : reductions)
+            partialTypes.push_back(reduction.next->getType());
+        StructType *PartialsTy = StructType::get(Ctx, partialTypes);
+        if (!reductions.empty())
+            contextTypes.push_back(PtrTy);
+        StructType *ContextTy = StructType::get(Ctx, contextTypes);
+
+        Constant *Ident = getDefaultIdent(OMPBuilder);
+
+        // The outlined function.
+        FunctionType *OutlinedTy = FunctionType::get(Type::getVoidTy(Ctx), {PtrTy, PtrTy, PtrTy}, false);
+        Function *Outlined = Function::Create(OutlinedTy, GlobalValue::InternalLinkage, F->getName() + ".omp_outlined", M);
+        Outlined->addParamAttr(0, Attribute::NoAlias);
+        Outlined->addParamAttr(1, Attribute::NoAlias);
+        Argument *GlobalTid = Outlined->getArg(0);
+        Argument *Context = Outlined->getArg(2);
+
+        BasicBlock *Entry = BasicBlock::Create(Ctx, "omp.entry", Outlined);
+        BasicBlock *LoopExit = BasicBlock::Create(Ctx, "omp.loop.exit", Outlined);
+
+        IRBuilder<> Builder(Entry);
+        ValueToValueMapTy VMap;
+        std::vector<Value*> starts, radices;
+        for (int j = 0; j < IndVars.size(); ++j) {
+            starts.push_back(Builder.CreateLoad(levelTypes[j], Builder.CreateStructGEP(ContextTy, Context, 2 * j), "omp.start"));
+            radices.push_back(Builder.CreateLoad(IVTy, Builder.CreateStructGEP(ContextTy, Context, 2 * j + 1),
+                                                 "omp.trip_count"));
+        }
+        Value *Start = starts.front();
+        Value *Count = radices.front();
+        for (int j = 1; j < IndVars.size(); ++j)
+            Count = Builder.CreateMul(Count, radices[j], "omp.trip_count");
+        Value *TripCount = Count;
+        Constant *Chains = ConstantInt::get(IVTy, chains);
+        if (chains)
+            Count = Builder.CreateSelect(Builder.CreateICmpULT(Count, Chains), Count, Chains, "omp.chains");
+        for (int i = 0; i < liveIns.size(); ++i)
+            VMap[liveIns[i]] = Builder.CreateLoad(contextTypes[liveInsIndex + i],
+                                                  Builder.CreateStructGEP(ContextTy, Context, liveInsIndex + i), liveIns[i]->getName());
+        Value *Partials = nullptr;
+        if (!reductions.empty())
+            Partials = Builder.CreateLoad(PtrTy, Builder.CreateStructGEP(ContextTy, Context, partialsIndex), "omp.partials");
+
+        // An empty iteration space is scheduled as [1, 0], which the runtime leaves empty: count - 1 would wrap.
+        Value *IsEmpty = Builder.CreateICmpEQ(Count, ConstantInt::get(IVTy, 0), "omp.empty");
+        Value *LastIndex = Builder.CreateSelect(IsEmpty, ConstantInt::get(IVTy, 0),
+                                                Builder.CreateSub(Count, ConstantInt::get(IVTy, 1)), "omp.last_index");
+        Value *Tid = Builder.CreateLoad(Int32Ty, GlobalTid, "omp.gtid");
+        std::vector<std::pair<Value*, AllocaInst*> > copiedOut;
+        createPrivateCopies(Builder, privateArrays, liveIns, VMap, copiedOut);
+        // No thread may copy its array back before every other one has read the shared array.
+        if (!copiedOut.empty())
+            Builder.CreateCall(OMPBuilder.getOrCreateRuntimeFunction(M, omp::RuntimeFunction::OMPRTL___kmpc_barrier), {Ident, Tid});
+        StaticChunk Chunk = createStaticSchedule(Builder, OMPBuilder, Ident, Tid, Builder.CreateZExt(IsEmpty, IVTy),
+                                                 LastIndex);
+        Value *ChunkBegin = Chunk.begin;
+        Value *ChunkEnd = Chunk.end;
+
+        SmallVector<BasicBlock*, 8> clonedBlocks;
+        std::vector<PHINode*> accumulators;
+        if (Distributed == &L && !isCollapsed) {
+            BasicBlock *LoopHeader = BasicBlock::Create(Ctx, "omp.loop.header", Outlined, LoopExit);
+            BasicBlock *LoopBody = BasicBlock::Create(Ctx, "omp.loop.body", Outlined, LoopExit);
+            BasicBlock *LoopLatch = BasicBlock::Create(Ctx, "omp.loop.latch", Outlined, LoopExit);
+            Builder.CreateBr(LoopHeader);
+
+            Builder.SetInsertPoint(LoopHeader);
+            PHINode *Iteration = Builder.CreatePHI(IVTy, 2, "omp.iv");
+            Iteration->addIncoming(ChunkBegin, Entry);
+            // The chain of the iteration: the chunk of the thread is a range of chains, whose first iterations are
+            // their own indices.
+            PHINode *Chain = nullptr;
+            if (chains) {
+                Chain = Builder.CreatePHI(IVTy, 2, "omp.chain");
+                Chain->addIncoming(ChunkBegin, Entry);
+            }
+            for (const Reduction& reduction : reductions) {
+                Type *Ty = reduction.next->getType();
+                PHINode *Accumulator = Builder.CreatePHI(Ty, 2, "omp.red");
+                Accumulator->addIncoming(getReductionIdentity(reduction.kind, Ty), Entry);
+                if (reduction.phi)
+                    VMap[reduction.phi] = Accumulator;
+                accumulators.push_back(Accumulator);
+            }
+            Builder.CreateCondBr(Builder.CreateICmpULE(Chain ? Chain : Iteration, ChunkEnd), LoopBody, LoopExit);
+
+            // The original induction variable is start + iteration * step; the rest of the header is recomputed after it.
+            Builder.SetInsertPoint(LoopBody);
+            Value *Index = Builder.CreateTrunc(Iteration, levelTypes.front());
+            VMap[IndVar] = Builder.CreateAdd(Start, Builder.CreateMul(Index, Step), IndVar->getName());
+            for (Instruction &I : Header->instructionsWithoutDebug()) {
+                if (isa<PHINode>(I) || I.isTerminator())
+                    continue;
+                Instruction *Clone = I.clone();
+                Clone->setName(I.getName());
+                Builder.Insert(Clone);
+                VMap[&I] = Clone;
+            }
+            VMap[Header] = LoopLatch;
+
+            clonedBlocks.push_back(LoopBody);
+            for (BasicBlock *BB : L.blocks()) {
+                if (BB == Header)
+                    continue;
+                BasicBlock *Clone = CloneBasicBlock(BB, VMap, ".omp", Outlined);
+                Clone->moveBefore(LoopLatch);
+                VMap[BB] = Clone;
+                clonedBlocks.push_back(Clone);
+            }
+            BasicBlock *BodyEntry = L.contains(Header->getTerminator()->getSuccessor(0)) ? Header->getTerminator()->getSuccessor(0)
+                                                                                          : Header->getTerminator()->getSuccessor(1);
+            Builder.CreateBr(cast<BasicBlock>(VMap[BodyEntry]));
+            remapInstructionsInBlocks(clonedBlocks, VMap);
+            // The load of a memory reduction reads the accumulator instead, and the store is dropped.
+            for (int i = 0; i < reductions.size(); ++i) {
+                if (reductions[i].store) {
+                    auto *LoadClone = cast<Instruction>(VMap[reductions[i].load]);
+                    LoadClone->replaceAllUsesWith(accumulators[i]);
+                    LoadClone->eraseFromParent();
+                    cast<Instruction>(VMap[reductions[i].store])->eraseFromParent();
+                }
+                accumulators[i]->addIncoming(VMap[reductions[i].next], LoopLatch);
+            }
+
+            Builder.SetInsertPoint(LoopLatch);
+            Value *NextIteration = Builder.CreateAdd(Iteration, ConstantInt::get(IVTy, chains ? chains : 1), "omp.iv.next");
+            if (chains)
+                NextIteration = advanceChain(Builder, Iteration, NextIteration, Chain, TripCount, Chains);
+            Iteration->addIncoming(NextIteration, LoopLatch);
+            Builder.CreateBr(LoopHeader);
+        } else {
+            // The nest is cloned as it is. The iteration of the distributed loop runs over the chunk of the thread, and
+            // the induction variables of the scheduled loops become start + index * step. When several loops are
+            // collapsed, their indices are the digits of the iteration in the mixed radix of their trip counts, divided
+            // out once per chunk and then counted up like an odometer; the loops inside the distributed one run their
+            // body once per iteration.
+            VMap[Preheader] = Entry;
+            VMap[L.getUniqueExitBlock()] = LoopExit;
+            for (BasicBlock *BB : L.blocks()) {
+                BasicBlock *Clone = CloneBasicBlock(BB, VMap, ".omp", Outlined);
+                Clone->moveBefore(LoopExit);
+                VMap[BB] = Clone;
+                clonedBlocks.push_back(Clone);
+            }
+            Instruction *EntryBranch = Builder.CreateBr(cast<BasicBlock>(VMap[Header]));
+            remapInstructionsInBlocks(clonedBlocks, VMap);
+
+            std::vector<Value*> digits;
+            if (isCollapsed) {
+                Builder.SetInsertPoint(EntryBranch);
+                digits = splitIntoDigits(Builder, ChunkBegin, radices);
+            }
+
+            auto getClone = [&](BasicBlock *BB) { return cast<BasicBlock>(VMap[BB]); };
+
+            BasicBlock *DistributedHeader = getClone(Distributed->getHeader());
+            BasicBlock *DistributedPreheader = getClone(Distributed->getLoopPreheader());
+            BasicBlock *DistributedLatch = getClone(Distributed->getLoopLatch());
+            Builder.SetInsertPoint(DistributedHeader, DistributedHeader->begin());
+            PHINode *Iteration = Builder.CreatePHI(IVTy, 2, "omp.iv");
+            Iteration->addIncoming(ChunkBegin, DistributedPreheader);
+            std::vector<PHINode*> indices = {Iteration};
+            if (isCollapsed) {
+                indices.clear();
+                for (int j = 0; j < IndVars.size(); ++j) {
+                    PHINode *Index = Builder.CreatePHI(IVTy, 2, "omp.index");
+                    Index->addIncoming(digits[j], DistributedPreheader);
+                    indices.push_back(Index);
+                }
+            }
+
+            Builder.SetInsertPoint(DistributedHeader, DistributedHeader->getFirstInsertionPt());
+            std::vector<Value*> oldNexts;
+            for (int j = 0; j < IndVars.size(); ++j) {
+                Value *Index = Builder.CreateZExtOrTrunc(indices[j], levelTypes[j]);
+                Value *LevelIndVar = Builder.CreateAdd(starts[j], Builder.CreateMul(Index, levelSteps[j]), IndVars[j]->getName());
+                auto *ClonedIndVar = cast<PHINode>(VMap[IndVars[j]]);
+                oldNexts.push_back(ClonedIndVar->getIncomingValueForBlock(getClone(levelLoops[j]->getLoopLatch())));
+                ClonedIndVar->replaceAllUsesWith(LevelIndVar);
+                ClonedIndVar->eraseFromParent();
+            }
+
+            Builder.SetInsertPoint(DistributedHeader->getTerminator());
+            setLoopCondition(Distributed, DistributedHeader, Builder.CreateICmpULE(Iteration, ChunkEnd, "omp.in_chunk"));
+            for (int j = 1; j < IndVars.size(); ++j) {
+                BasicBlock *LevelHeader = getClone(levelLoops[j]->getHeader());
+                Builder.SetInsertPoint(LevelHeader, LevelHeader->begin());
+                PHINode *Once = Builder.CreatePHI(Builder.getInt1Ty(), 2, "omp.once");
+                Once->addIncoming(Builder.getTrue(), getClone(levelLoops[j]->getLoopPreheader()));
+                Once->addIncoming(Builder.getFalse(), getClone(levelLoops[j]->getLoopLatch()));
+                setLoopCondition(levelLoops[j], LevelHeader, Once);
+            }
+
+            Builder.SetInsertPoint(DistributedLatch->getTerminator());
+            Iteration->addIncoming(Builder.CreateAdd(Iteration, ConstantInt::get(IVTy, 1), "omp.iv.next"), DistributedLatch);
+            if (isCollapsed)
+                advanceDigits(Builder, indices, radices);
+            for (Value *OldNext : oldNexts)
+                RecursivelyDeleteTriviallyDeadInstructions(OldNext);
+        }
+        dropDebugInfo(clonedBlocks);
+
+        Builder.SetInsertPoint(LoopExit);
+        Builder.CreateCall(OMPBuilder.getOrCreateRuntimeFunction(M, omp::RuntimeFunction::OMPRTL___kmpc_for_static_fini), {Ident, Tid});
+        if (!copiedOut.empty())
+            copyOutPrivateArrays(Builder, Chunk.isLast, copiedOut);
+        if (!reductions.empty())
+            combinePartials(Builder, OMPBuilder, Ident, Tid, reductions, accumulators, PartialsTy, Partials);
+        Builder.CreateRetVoid();
+
+        // Fork the team from the preheader, then drop the original loop.
+        AllocaInst *ContextAlloca = createContext(*F, ContextTy);
+
+        SCEVExpander Expander(SE, M.getDataLayout(), "omp");
+        Instruction *InsertPt = Preheader->getTerminator();
+        for (int j = 0; j < IndVars.size(); ++j) {
+            Value *StartValue = Expander.expandCodeFor(levelStarts[j], levelTypes[j], InsertPt);
+            Value *TripCountValue = Expander.expandCodeFor(levelTripCounts[j], IVTy, InsertPt);
+            Builder.SetInsertPoint(InsertPt);
+            Builder.CreateStore(StartValue, Builder.CreateStructGEP(ContextTy, ContextAlloca, 2 * j));
+            Builder.CreateStore(TripCountValue, Builder.CreateStructGEP(ContextTy, ContextAlloca, 2 * j + 1));
+        }
+        Builder.SetInsertPoint(InsertPt);
+        for (int i = 0; i < liveIns.size(); ++i)
+            Builder.CreateStore(liveIns[i], Builder.CreateStructGEP(ContextTy, ContextAlloca, liveInsIndex + i));
+        Value *StackPointer = nullptr;
+        Value *CallerPartials = nullptr;
+        if (!reductions.empty()) {
+            // The team has at most omp_get_max_threads() threads.
+            Value *MaxThreads = Builder.CreateCall(OMPBuilder.getOrCreateRuntimeFunction(M, omp::RuntimeFunction::OMPRTL_omp_get_max_threads),
+                                                   {}, "omp.max_threads");
+            StackPointer = Builder.CreateStackSave("omp.stack");
+            CallerPartials = Builder.CreateAlloca(PartialsTy, MaxThreads, "omp.partials");
+            Builder.CreateStore(CallerPartials, Builder.CreateStructGEP(ContextTy, ContextAlloca, partialsIndex));
+        }
+        createForkCall(Builder, OMPBuilder, Ident, Outlined, ContextAlloca);
+
+        for (int i = 0; i < reductions.size(); ++i) {
+            const Reduction& reduction = reductions[i];
+            Value *Total = Builder.CreateLoad(partialTypes[i], Builder.CreateStructGEP(PartialsTy, CallerPartials, i), "omp.red.total");
+            if (reduction.phi) {
+                Value *Result = createReductionOp(Builder, reduction, reduction.phi->getIncomingValueForBlock(Preheader), Total);
+                reduction.phi->replaceUsesWithIf(Result, [&](Use &U) { return !L.contains(cast<Instruction>(U.getUser())); });
+            } else {
+                Value *Ptr = reduction.store->getPointerOperand();
+                Ptr = Expander.expandCodeFor(SE.getSCEV(Ptr), Ptr->getType(), InsertPt);
+                Builder.SetInsertPoint(InsertPt);
+                Value *Initial = Builder.CreateLoad(partialTypes[i], Ptr, "omp.red.initial");
+                Builder.CreateStore(createReductionOp(Builder, reduction, Initial, Total), Ptr);
+            }
+        }
+        if (StackPointer)
+            Builder.CreateStackRestore(StackPointer);
+
+        deleteDeadLoop(&L, &DT, &SE, &LI);
+    }
+
+    /*
+     * Run the nest of Outer and its only sub-loop as wavefronts (see planWavefront) in
+     *   void <function>.omp_wavefront(i32* gtid, i32* btid, ctx*)
+     * The indices (i, j) of the two loops are mapped to (i, j + skew * i), and that space is cut into tiles of
+     * tile x tile iterations. Every thread walks the anti-diagonals of tiles in order; the tiles of a diagonal are
+     * statically scheduled across the team with __kmpc_for_static_init, and a barrier separates the diagonals. A tile
+     * runs a clone of the nest, with the induction variables recomputed from the indices and the loops restricted to
+     * the tile. The context struct carries the start and trip count of both loops and the live-in values.
+     */
+    void outlineWavefront(Loop &Outer, int64_t skew, int64_t tile, OpenMPIRBuilder &OMPBuilder, ScalarEvolution &SE,
+                          LoopInfo &LI, DominatorTree &DT) {
+        Function *F = Outer.getHeader()->getParent();
+        Module &M = *F->getParent();
+        LLVMContext &Ctx = M.getContext();
+        BasicBlock *Preheader = Outer.getLoopPreheader();
+        Loop *Inner = Outer.getSubLoops().front();
+        Type *IVTy = Type::getInt64Ty(Ctx);
+        Type *Int32Ty = Type::getInt32Ty(Ctx);
+        Type *PtrTy = PointerType::getUnqual(Ctx);
+
+        Loop *levelLoops[2] = {&Outer, Inner};
+        PHINode *levelIndVars[2];
+        Type *levelTypes[2];
+        const SCEV *levelStarts[2], *levelTripCounts[2];
+        Constant *levelSteps[2];
+        for (int j = 0; j < 2; ++j) {
+            levelIndVars[j] = getOutlinableInductionVariable(*levelLoops[j], SE, {});
+            const auto *AddRec = cast<SCEVAddRecExpr>(SE.getSCEV(levelIndVars[j]));
+            levelTypes[j] = levelIndVars[j]->getType();
+            levelStarts[j] = AddRec->getStart();
+            levelTripCounts[j] = SE.getTruncateOrZeroExtend(SE.getExitCount(levelLoops[j], levelLoops[j]->getHeader()),
+                                                            levelTypes[j]);
+            levelSteps[j] = cast<SCEVConstant>(AddRec->getStepRecurrence(SE))->getValue();
+        }
+
+        std::vector<Value*> liveIns = extractLiveIns(Outer);
+        std::vector<Type*> contextTypes = {levelTypes[0], levelTypes[0], levelTypes[1], levelTypes[1]};
+        int liveInsIndex = contextTypes.size();
+        for (Value *V : liveIns)
+            contextTypes.push_back(V->getType());
+        StructType *ContextTy = StructType::get(Ctx, contextTypes);
+
+        Constant *Ident = getDefaultIdent(OMPBuilder);
+
+        FunctionType *OutlinedTy = FunctionType::get(Type::getVoidTy(Ctx), {PtrTy, PtrTy, PtrTy}, false);
+        Function *Outlined = Function::Create(OutlinedTy, GlobalValue::InternalLinkage, F->getName() + ".omp_wavefront", M);
+        Outlined->addParamAttr(0, Attribute::NoAlias);
+        Outlined->addParamAttr(1, Attribute::NoAlias);
+        Argument *Context = Outlined->getArg(2);
+
+        BasicBlock *Entry = BasicBlock::Create(Ctx, "omp.entry", Outlined);
+        BasicBlock *WaveHeader = BasicBlock::Create(Ctx, "omp.wave.header", Outlined);
+        BasicBlock *WaveBody = BasicBlock::Create(Ctx, "omp.wave.body", Outlined);
+        BasicBlock *TileHeader = BasicBlock::Create(Ctx, "omp.tile.header", Outlined);
+        BasicBlock *TileBody = BasicBlock::Create(Ctx, "omp.tile.body", Outlined);
+        BasicBlock *TileLatch = BasicBlock::Create(Ctx, "omp.tile.latch", Outlined);
+        BasicBlock *WaveLatch = BasicBlock::Create(Ctx, "omp.wave.latch", Outlined);
+        BasicBlock *WavesExit = BasicBlock::Create(Ctx, "omp.waves.exit", Outlined);
+
+        IRBuilder<> Builder(Entry);
+        ValueToValueMapTy VMap;
+        Value *starts[2], *counts[2];
+        for (int j = 0; j < 2; ++j) {
+            starts[j] = Builder.CreateLoad(levelTypes[j], Builder.CreateStructGEP(ContextTy, Context, 2 * j), "omp.start");
+            Value *LevelCount = Builder.CreateLoad(levelTypes[j], Builder.CreateStructGEP(ContextTy, Context, 2 * j + 1),
+                                                   "omp.trip_count");
+            counts[j] = Builder.CreateZExt(LevelCount, IVTy);
+        }
+        for (int i = 0; i < liveIns.size(); ++i)
+            VMap[liveIns[i]] = Builder.CreateLoad(contextTypes[liveInsIndex + i],
+                                                  Builder.CreateStructGEP(ContextTy, Context, liveInsIndex + i), liveIns[i]->getName());
+
+        // tiles = ceil(n1 / tile) rows of ceil((skew * (n1 - 1) + n2) / tile) tiles, and rows + columns - 1 diagonals.
+        Constant *Zero = ConstantInt::get(IVTy, 0), *One = ConstantInt::get(IVTy, 1);
+        Constant *Tile = ConstantInt::get(IVTy, tile), *Skew = ConstantInt::get(IVTy, skew);
+        Value *Rows = Builder.CreateUDiv(Builder.CreateAdd(counts[0], ConstantInt::get(IVTy, tile - 1)), Tile, "omp.rows");
+        Value *Span = Builder.CreateAdd(Builder.CreateMul(Builder.CreateSub(counts[0], One), Skew), counts[1], "omp.span");
+        Value *Columns = Builder.CreateUDiv(Builder.CreateAdd(Span, ConstantInt::get(IVTy, tile - 1)), Tile, "omp.columns");
+        Value *IsEmpty = Builder.CreateOr(Builder.CreateICmpEQ(counts[0], Zero), Builder.CreateICmpEQ(counts[1], Zero));
+        Value *Waves = Builder.CreateSelect(IsEmpty, Zero, Builder.CreateSub(Builder.CreateAdd(Rows, Columns), One), "omp.waves");
+        Value *Tid = Builder.CreateLoad(Int32Ty, Outlined->getArg(0), "omp.gtid");
+        Builder.CreateBr(WaveHeader);
+
+        Builder.SetInsertPoint(WaveHeader);
+        PHINode *Wave = Builder.CreatePHI(IVTy, 2, "omp.wave");
+        Wave->addIncoming(Zero, Entry);
+        Builder.CreateCondBr(Builder.CreateICmpULT(Wave, Waves), WaveBody, WavesExit);
+
+        // The rows of the tiles on the diagonal, [max(0, wave - columns + 1), min(wave, rows - 1)].
+        Builder.SetInsertPoint(WaveBody);
+        Value *FirstRow = Builder.CreateSub(Wave, Builder.CreateSub(Columns, One));
+        FirstRow = Builder.CreateSelect(Builder.CreateICmpSGT(FirstRow, Zero), FirstRow, Zero, "omp.first_row");
+        Value *LastRow = Builder.CreateSub(Rows, One);
+        LastRow = Builder.CreateSelect(Builder.CreateICmpSLT(Wave, LastRow), Wave, LastRow, "omp.last_row");
+        Value *LastIndex = Builder.CreateSub(LastRow, FirstRow, "omp.last_index");
+        StaticChunk Chunk = createStaticSchedule(Builder, OMPBuilder, Ident, Tid, Zero, LastIndex);
+        Builder.CreateBr(TileHeader);
+
+        Builder.SetInsertPoint(TileHeader);
+        PHINode *TileIndex = Builder.CreatePHI(IVTy, 2, "omp.tile");
+        TileIndex->addIncoming(Chunk.begin, WaveBody);
+        Builder.CreateCondBr(Builder.CreateICmpULE(TileIndex, Chunk.end), TileBody, WaveLatch);
+
+        // The tile covers [row * tile, min(n1, row * tile + tile)) x [column * tile, column * tile + tile).
+        Builder.SetInsertPoint(TileBody);
+        Value *Row = Builder.CreateAdd(FirstRow, TileIndex, "omp.row");
+        Value *Column = Builder.CreateSub(Wave, Row, "omp.column");
+        Value *RowBegin = Builder.CreateMul(Row, Tile, "omp.row.begin");
+        Value *RowEnd = Builder.CreateAdd(RowBegin, Tile);
+        RowEnd = Builder.CreateSelect(Builder.CreateICmpULT(RowEnd, counts[0]), RowEnd, counts[0], "omp.row.end");
+        Value *ColumnBegin = Builder.CreateMul(Column, Tile, "omp.column.begin");
+        Value *ColumnEnd = Builder.CreateAdd(ColumnBegin, Tile, "omp.column.end");
+
+        VMap[Preheader] = TileBody;
+        VMap[Outer.getUniqueExitBlock()] = TileLatch;
+        SmallVector<BasicBlock*, 16> clonedBlocks;
+        for (BasicBlock *BB : Outer.blocks()) {
+            BasicBlock *Clone = CloneBasicBlock(BB, VMap, ".omp", Outlined);
+            Clone->moveBefore(TileLatch);
+            VMap[BB] = Clone;
+            clonedBlocks.push_back(Clone);
+        }
+        Builder.CreateBr(cast<BasicBlock>(VMap[Outer.getHeader()]));
+        remapInstructionsInBlocks(clonedBlocks, VMap);
+        auto getClone = [&](BasicBlock *BB) { return cast<BasicBlock>(VMap[BB]); };
+
+        // The index of each loop runs over the tile; the inner one is skewed, and only the part of the tile inside
+        // [skew * i, skew * i + n2) is run.
+        Value *indices[2];
+        for (int j = 0; j < 2; ++j) {
+            BasicBlock *LevelHeader = getClone(levelLoops[j]->getHeader());
+            BasicBlock *LevelPreheader = getClone(levelLoops[j]->getLoopPreheader());
+            BasicBlock *LevelLatch = getClone(levelLoops[j]->getLoopLatch());
+            Value *Begin = RowBegin, *End = RowEnd;
+            if (j == 1) {
+                Builder.SetInsertPoint(LevelPreheader->getTerminator());
+                Value *Offset = Builder.CreateMul(indices[0], Skew, "omp.skew");
+                Value *Limit = Builder.CreateAdd(Offset, counts[1]);
+                Begin = Builder.CreateSelect(Builder.CreateICmpUGT(ColumnBegin, Offset), ColumnBegin, Offset, "omp.column.first");
+                End = Builder.CreateSelect(Builder.CreateICmpULT(ColumnEnd, Limit), ColumnEnd, Limit, "omp.column.last");
+            }
+            Builder.SetInsertPoint(LevelHeader, LevelHeader->begin());
+            PHINode *Index = Builder.CreatePHI(IVTy, 2, j == 0 ? "omp.row.index" : "omp.column.index");
+            Index->addIncoming(Begin, LevelPreheader);
+            indices[j] = Index;
+
+            Builder.SetInsertPoint(LevelHeader, LevelHeader->getFirstInsertionPt());
+            Value *Iteration = j == 0 ? Index : Builder.CreateSub(Index, Builder.CreateMul(indices[0], Skew));
+            Iteration = Builder.CreateTrunc(Iteration, levelTypes[j]);
+            Value *LevelIndVar = Builder.CreateAdd(starts[j], Builder.CreateMul(Iteration, levelSteps[j]),
+                                                   levelIndVars[j]->getName());
+            auto *ClonedIndVar = cast<PHINode>(VMap[levelIndVars[j]]);
+            Value *OldNext = ClonedIndVar->getIncomingValueForBlock(LevelLatch);
+            ClonedIndVar->replaceAllUsesWith(LevelIndVar);
+            ClonedIndVar->eraseFromParent();
+
+            Builder.SetInsertPoint(LevelHeader->getTerminator());
+            setLoopCondition(levelLoops[j], LevelHeader, Builder.CreateICmpULT(Index, End, "omp.in_tile"));
+            Builder.SetInsertPoint(LevelLatch->getTerminator());
+            Index->addIncoming(Builder.CreateAdd(Index, One, "omp.index.next"), LevelLatch);
+            RecursivelyDeleteTriviallyDeadInstructions(OldNext);
+        }
+        dropDebugInfo(clonedBlocks);
+
+        Builder.SetInsertPoint(TileLatch);
+        TileIndex->addIncoming(Builder.CreateAdd(TileIndex, One, "omp.tile.next"), TileLatch);
+        Builder.CreateBr(TileHeader);
+
+        // The tiles of the next diagonal depend on the ones of this diagonal.
+        Builder.SetInsertPoint(WaveLatch);
+        Builder.CreateCall(OMPBuilder.getOrCreateRuntimeFunction(M, omp::RuntimeFunction::OMPRTL___kmpc_for_static_fini), {Ident, Tid});
+        Builder.CreateCall(OMPBuilder.getOrCreateRuntimeFunction(M, omp::RuntimeFunction::OMPRTL___kmpc_barrier), {Ident, Tid});
+        Wave->addIncoming(Builder.CreateAdd(Wave, One, "omp.wave.next"), WaveLatch);
+        Builder.CreateBr(WaveHeader);
+
+        Builder.SetInsertPoint(WavesExit);
+        Builder.CreateRetVoid();
+
+        // Fork the team from the preheader, then drop the original nest.
+        AllocaInst *ContextAlloca = createContext(*F, ContextTy);
+
+        SCEVExpander Expander(SE, M.getDataLayout(), "omp");
+        Instruction *InsertPt = Preheader->getTerminator();
+        for (int j = 0; j < 2; ++j) {
+            Value *StartValue = Expander.expandCodeFor(levelStarts[j], levelTypes[j], InsertPt);
+            Value *TripCountValue = Expander.expandCodeFor(levelTripCounts[j], levelTypes[j], InsertPt);
+            Builder.SetInsertPoint(InsertPt);
+            Builder.CreateStore(StartValue, Builder.CreateStructGEP(ContextTy, ContextAlloca, 2 * j));
+            Builder.CreateStore(TripCountValue, Builder.CreateStructGEP(ContextTy, ContextAlloca, 2 * j + 1));
+        }
+        Builder.SetInsertPoint(InsertPt);
+        for (int i = 0; i < liveIns.size(); ++i)
+            Builder.CreateStore(liveIns[i], Builder.CreateStructGEP(ContextTy, ContextAlloca, liveInsIndex + i));
+        createForkCall(Builder, OMPBuilder, Ident, Outlined, ContextAlloca);
+
+        deleteDeadLoop(&Outer, &DT, &SE, &LI);
+    }
+
+    /*
+     * Functions outlined for a team are already run in parallel, and the loops left in them must stay serial.
+     */
+    bool isOutlinedParallelRegion(Function &F) {
+        return any_of(F.users(), [](User *U) {
+            auto *Call = dyn_cast<CallBase>(U);
+            return Call && Call->getCalledFunction() && Call->getCalledFunction()->getName() == "__kmpc_fork_call";
+        });
+    }
+
+    /*
+     * The memory a loop nest reads and writes, by base pointer (see getBasePointer). A nullptr base stands for memory
+     * that may be any other: the base of an access that is not reached from its pointer through GEPs alone, or that is
+     * not an identified object (e.g. a pointer parameter, which may point into the other bases).
+     */
+    struct AccessSummary {
+        SmallPtrSet<Value*, 8> reads;
+        SmallPtrSet<Value*, 8> writes;
+    };
+
+    /*
+     * Summarize the accesses of the nest rooted at L. Return false if the nest has a call that touches memory, or an
+     * access that is not a simple load or store, whose effects the summary cannot describe.
+     */
+    bool summarizeNestAccesses(Loop &L, ScalarEvolution &SE, AccessSummary& summary) {
+        for (BasicBlock *BB : L.blocks()) {
+            for (Instruction &I : *BB) {
+                if (isa<DbgInfoIntrinsic>(I) || !I.mayReadOrWriteMemory())
+                    continue;
+                Value *Ptr = getLoadStorePointerOperand(&I);
+                if (!Ptr || (isa<LoadInst>(I) && !cast<LoadInst>(I).isSimple()) ||
+                    (isa<StoreInst>(I) && !cast<StoreInst>(I).isSimple()))
+                    return false;
+                Value *base = getBasePointer(Ptr, SE);
+                if (!isIdentifiedObject(base) || getUnderlyingObject(Ptr, /* MaxLookup = */ 0) != base)
+                    base = nullptr;
+                if (isa<StoreInst>(I))
+                    summary.writes.insert(base);
+                else
+                    summary.reads.insert(base);
+            }
+        }
+        return true;
+    }
+
+    /*
+     * Two nests may run concurrently unless one of them writes a base the other one reads or writes.
+     */
+    bool mayConflict(const AccessSummary& summary1, const AccessSummary& summary2) {
+        auto overlaps = [](const SmallPtrSet<Value*, 8>& writes, const SmallPtrSet<Value*, 8>& accesses) {
+            if (writes.empty() || accesses.empty())
+                return false;
+            if (writes.count(nullptr) || accesses.count(nullptr))
+                return true;
+            return any_of(writes, [&](Value *base) { return accesses.count(base) != 0; });
+        };
+        return overlaps(summary1.writes, summary2.reads) || overlaps(summary1.writes, summary2.writes) ||
+               overlaps(summary2.writes, summary1.reads);
+    }
+
+    /*
+     * A top-level nest that can be run as a task: in loop simplify form, with a unique exit, no value used after it and
+     * a computable trip count at every level, since a nest that does not terminate would hide the effects of the nests
+     * after it.
+     */
+    bool isTaskCandidate(Loop &L, ScalarEvolution &SE) {
+        if (!L.getLoopPreheader() || !L.getUniqueExitBlock() || !L.hasDedicatedExits())
+            return false;
+        for (Loop *Sub : L.getLoopsInPreorder()) {
+            if (isa<SCEVCouldNotCompute>(SE.getBackedgeTakenCount(Sub)))
+                return false;
+        }
+        for (BasicBlock *BB : L.blocks()) {
+            for (Instruction &I : *BB) {
+                for (User *U : I.users()) {
+                    if (!L.contains(cast<Instruction>(U)))
+                        return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /*
+     * The top-level loop run right after L, or nullptr. The blocks from the exit of L to the preheader of that loop,
+     * which are appended to between, have to form a straight line whose instructions can be hoisted above L: they
+     * neither touch memory nor have other side effects.
+     */
+    Loop* getNextSiblingLoop(Loop &L, LoopInfo &LI, std::vector<BasicBlock*>& between) {
+        BasicBlock *BB = L.getUniqueExitBlock();
+        size_t first = between.size();
+        while (BB && !LI.getLoopFor(BB)) {
+            if (between.size() > first && BB->getSinglePredecessor() != between.back())
+                return nullptr;
+            for (Instruction &I : *BB) {
+                if (I.isTerminator() || isa<DbgInfoIntrinsic>(I))
+                    continue;
+                if (isa<PHINode>(I) || I.mayReadOrWriteMemory() || !isSafeToSpeculativelyExecute(&I))
+                    return nullptr;
+            }
+            between.push_back(BB);
+            auto *Branch = dyn_cast<BranchInst>(BB->getTerminator());
+            if (!Branch || Branch->isConditional())
+                return nullptr;
+            BB = Branch->getSuccessor(0);
+            Loop *Next = LI.getLoopFor(BB);
+            if (Next)
+                return Next->getHeader() == BB && Next->getLoopPreheader() == between.back() ? Next : nullptr;
+        }
+        return nullptr;
+    }
+
+    /*
+     * Run the nests, which follow each other in the function and are independent, as the sections of one parallel
+     * region:
+     *   void <function>.omp_tasks(i32* gtid, i32* btid, ctx*)
+     * statically schedules the section indices [0, nests) across the team with __kmpc_for_static_init and runs the
+     * clone of the nest of each of its indices; the join of __kmpc_fork_call waits for all of them. The code between
+     * the nests is hoisted above the first one, where the team is forked, and the nests are dropped.
+     */
+    void outlineParallelSections(ArrayRef<Loop*> nests, ArrayRef<BasicBlock*> between, OpenMPIRBuilder &OMPBuilder,
+                                 ScalarEvolution &SE, LoopInfo &LI, DominatorTree &DT) {
+        Function *F = nests.front()->getHeader()->getParent();
+        Module &M = *F->getParent();
+        LLVMContext &Ctx = M.getContext();
+        BasicBlock *Preheader = nests.front()->getLoopPreheader();
+        Type *Int32Ty = Type::getInt32Ty(Ctx);
+        Type *PtrTy = PointerType::getUnqual(Ctx);
+
+        for (BasicBlock *BB : between) {
+            for (Instruction &I : make_early_inc_range(*BB)) {
+                if (!I.isTerminator() && !isa<DbgInfoIntrinsic>(I))
+                    I.moveBefore(Preheader->getTerminator());
+            }
+        }
+
+        std::vector<Value*> liveIns;
+        SmallPtrSet<Value*, 16> seen;
+        for (Loop *Nest : nests) {
+            for (Value *V : extractLiveIns(*Nest)) {
+                if (seen.insert(V).second)
+                    liveIns.push_back(V);
+            }
+        }
+        std::vector<Type*> contextTypes;
+        for (Value *V : liveIns)
+            contextTypes.push_back(V->getType());
+        StructType *ContextTy = StructType::get(Ctx, contextTypes);
+
+        Constant *Ident = getDefaultIdent(OMPBuilder);
+
+        FunctionType *OutlinedTy = FunctionType::get(Type::getVoidTy(Ctx), {PtrTy, PtrTy, PtrTy}, false);
+        Function *Outlined = Function::Create(OutlinedTy, GlobalValue::InternalLinkage, F->getName() + ".omp_tasks", M);
+        Outlined->addParamAttr(0, Attribute::NoAlias);
+        Outlined->addParamAttr(1, Attribute::NoAlias);
+        Argument *Context = Outlined->getArg(2);
+
+        BasicBlock *Entry = BasicBlock::Create(Ctx, "omp.entry", Outlined);
+        BasicBlock *SectionHeader = BasicBlock::Create(Ctx, "omp.section.header", Outlined);
+        BasicBlock *SectionSwitch = BasicBlock::Create(Ctx, "omp.section.switch", Outlined);
+        BasicBlock *SectionLatch = BasicBlock::Create(Ctx, "omp.section.latch", Outlined);
+        BasicBlock *SectionsExit = BasicBlock::Create(Ctx, "omp.sections.exit", Outlined);
+
+        IRBuilder<> Builder(Entry);
+        ValueToValueMapTy VMap;
+        for (int i = 0; i < liveIns.size(); ++i)
+            VMap[liveIns[i]] = Builder.CreateLoad(contextTypes[i], Builder.CreateStructGEP(ContextTy, Context, i),
+                                                  liveIns[i]->getName());
+
+        Value *Tid = Builder.CreateLoad(Int32Ty, Outlined->getArg(0), "omp.gtid");
+        StaticChunk Chunk = createStaticSchedule(Builder, OMPBuilder, Ident, Tid, Builder.getInt64(0),
+                                                 Builder.getInt64(nests.size() - 1));
+        Builder.CreateBr(SectionHeader);
+
+        Builder.SetInsertPoint(SectionHeader);
+        PHINode *Section = Builder.CreatePHI(Builder.getInt64Ty(), 2, "omp.section");
+        Section->addIncoming(Chunk.begin, Entry);
+        Builder.CreateCondBr(Builder.CreateICmpULE(Section, Chunk.end), SectionSwitch, SectionsExit);
+
+        Builder.SetInsertPoint(SectionSwitch);
+        SwitchInst *Switch = Builder.CreateSwitch(Section, SectionLatch, nests.size());
+        SmallVector<BasicBlock*, 32> clonedBlocks;
+        for (int i = 0; i < nests.size(); ++i) {
+            Loop *Nest = nests[i];
+            BasicBlock *SectionEntry = BasicBlock::Create(Ctx, "omp.section." + Twine(i), Outlined, SectionLatch);
+            Switch->addCase(Builder.getInt64(i), SectionEntry);
+            // The exit of a nest may be the preheader of the next one, so every nest is remapped on its own.
+            VMap[Nest->getLoopPreheader()] = SectionEntry;
+            VMap[Nest->getUniqueExitBlock()] = SectionLatch;
+            SmallVector<BasicBlock*, 16> nestBlocks;
+            for (BasicBlock *BB : Nest->blocks()) {
+                BasicBlock *Clone = CloneBasicBlock(BB, VMap, ".omp", Outlined);
+                Clone->moveBefore(SectionLatch);
+                VMap[BB] = Clone;
+                nestBlocks.push_back(Clone);
+            }
+            remapInstructionsInBlocks(nestBlocks, VMap);
+            clonedBlocks.append(nestBlocks.begin(), nestBlocks.end());
+            BranchInst::Create(cast<BasicBlock>(VMap[Nest->getHeader()]), SectionEntry);
+        }
+        dropDebugInfo(clonedBlocks);
+
+        Builder.SetInsertPoint(SectionLatch);
+        Section->addIncoming(Builder.CreateAdd(Section, Builder.getInt64(1), "omp.section.next"), SectionLatch);
+        Builder.CreateBr(SectionHeader);
+
+        Builder.SetInsertPoint(SectionsExit);
+        Builder.CreateCall(OMPBuilder.getOrCreateRuntimeFunction(M, omp::RuntimeFunction::OMPRTL___kmpc_for_static_fini), {Ident, Tid});
+        Builder.CreateRetVoid();
+
+        // Drop the nests, so that the code runs straight from the first preheader to the exit of the last nest, and
+        // fork the team from the first preheader.
+        for (Loop *Nest : nests)
+            deleteDeadLoop(Nest, &DT, &SE, &LI);
+
+        AllocaInst *ContextAlloca = createContext(*F, ContextTy);
+        Builder.SetInsertPoint(Preheader->getTerminator());
+        for (int i = 0; i < liveIns.size(); ++i)
+            Builder.CreateStore(liveIns[i], Builder.CreateStructGEP(ContextTy, ContextAlloca, i));
+        createForkCall(Builder, OMPBuilder, Ident, Outlined, ContextAlloca);
+    }
+
+    /*
+     * Put every load and store of L in a fresh access group and list the group in the llvm.loop.parallel_accesses
+     * property of the loop ID, optionally asking for vectorization as well. The annotation claims that no memory
+     * instruction of the group depends on another iteration, which the analysis only knows of simple loads and stores:
+     * return false, leaving L alone, if it holds any other instruction that may access memory, such as a call.
+     */
+    bool addParallelAccessesMetadata(Loop &L, bool enableVectorize) {
+        if (hasUnmodelledMemoryAccess(L))
+            return false;
+
+        LLVMContext &Ctx = L.getHeader()->getContext();
+        MDNode *AccessGroup = MDNode::getDistinct(Ctx, {});
+        for (BasicBlock *BB : L.blocks()) {
+            for (Instruction &I : *BB) {
+                if (!I.mayReadOrWriteMemory())
+                    continue;
+                MDNode *AccessGroups = uniteAccessGroups(I.getMetadata(LLVMContext::MD_access_group), AccessGroup);
+                I.setMetadata(LLVMContext::MD_access_group, AccessGroups);
+            }
+        }
+
+        SmallVector<MDNode*, 2> properties;
+        properties.push_back(MDNode::get(Ctx, {MDString::get(Ctx, "llvm.loop.parallel_accesses"), AccessGroup}));
+        if (enableVectorize) {
+            properties.push_back(MDNode::get(Ctx, {MDString::get(Ctx, "llvm.loop.vectorize.enable"),
+                                                   ConstantAsMetadata::get(ConstantInt::getTrue(Ctx))}));
+        }
+        L.setLoopID(makePostTransformationMetadata(Ctx, L.getLoopID(), {"llvm.loop.vectorize.enable"}, properties));
+        return true;
+    }
+
+    /*
+     * Number of the last iteration of L (counting from 0) as a SCEV, for the two loop forms the pass sees: not rotated
+     * (the header exits, after the last iteration) and rotated (the latch exits, after the last iteration). A loop of a
+     * single block is rotated.
+     */
+    const SCEV* getLastIteration(Loop &L, ScalarEvolution &SE) {
+        BasicBlock *Exiting = L.getExitingBlock();
+        if (!Exiting)
+            return nullptr;
+        const SCEV *ExitCount = SE.getExitCount(&L, Exiting);
+        if (isa<SCEVCouldNotCompute>(ExitCount))
+            return nullptr;
+        if (Exiting != L.getHeader() && Exiting != L.getLoopLatch())
+            return nullptr;
+        return SE.getAddExpr(ExitCount, SE.getConstant(ExitCount->getType(), lastIterationOffset(&L), true));
+    }
+
+    struct AccessRange {
+        const SCEV *start;
+        const SCEV *end;
+    };
+
+    /*
+     * Bytes [start, end) that the accesses through Ptr touch while L runs, from the start and the last value of the
+     * pointer's add recurrence. Return false if the pointer is not affine in L with a constant step.
+     */
+    bool extractAccessRange(Value *Ptr, Type *AccessTy, Loop &L, const SCEV *LastIteration, ScalarEvolution &SE,
+                            AccessRange& range) {
+        const SCEV *PtrSCEV = SE.getSCEV(Ptr);
+        const SCEV *ElementSize = SE.getConstant(SE.getEffectiveSCEVType(PtrSCEV->getType()),
+                                                 L.getHeader()->getModule()->getDataLayout().getTypeStoreSize(AccessTy));
+        if (SE.isLoopInvariant(PtrSCEV, &L)) {
+            range = {PtrSCEV, SE.getAddExpr(PtrSCEV, ElementSize)};
+            return true;
+        }
+        const auto *AddRec = dyn_cast<SCEVAddRecExpr>(PtrSCEV);
+        if (!AddRec || AddRec->getLoop() != &L || !AddRec->isAffine())
+            return false;
+        const auto *Step = dyn_cast<SCEVConstant>(AddRec->getStepRecurrence(SE));
+        if (!Step)
+            return false;
+        const SCEV *First = AddRec->getStart();
+        const SCEV *Last = AddRec->evaluateAtIteration(SE.getTruncateOrZeroExtend(LastIteration, Step->getType()), SE);
+        if (Step->getAPInt().isNegative())
+            std::swap(First, Last);
+        range = {First, SE.getAddExpr(Last, ElementSize)};
+        return true;
+    }
+
+    /*
+     * For a loop whose accesses are only safe when its bases do not overlap: the range of every base paired with another
+     * one, and the pairs to check. A pair needs a check if alias analysis cannot tell the bases apart (as it does for
+     * globals, stack arrays and restrict parameters) and one of them is written in the loop. A guard on the bounds, if
+     * any, is checked too.
+     */
+    struct VersioningPlan {
+        std::unordered_map<Value*, AccessRange> ranges;
+        std::vector<std::pair<Value*, Value*> > checks;
+        BoundGuard guard;
+    };
+
+    bool areDistinctBases(Value *base1, Value *base2, AAResults &AA) {
+        return AA.isNoAlias(MemoryLocation::getBeforeOrAfter(base1), MemoryLocation::getBeforeOrAfter(base2));
+    }
+
+    bool planLoopVersioning(Loop &L, const ArrayAccessSet& arrayAccesses, ScalarEvolution &SE, AAResults &AA,
+                            VersioningPlan& plan) {
+        std::vector<Value*> bases;
+        SmallPtrSet<Value*, 8> writtenBases;
+        for (const ArrayAccess& arrayAccess : arrayAccesses) {
+            if (std::find(bases.begin(), bases.end(), arrayAccess.baseAccess) == bases.end())
+                bases.push_back(arrayAccess.baseAccess);
+            if (!arrayAccess.type)
+                writtenBases.insert(arrayAccess.baseAccess);
+        }
+        for (int i = 0; i < bases.size(); ++i) {
+            for (int j = i + 1; j < bases.size(); ++j) {
+                if ((writtenBases.count(bases[i]) || writtenBases.count(bases[j])) &&
+                    !areDistinctBases(bases[i], bases[j], AA))
+                    plan.checks.push_back({bases[i], bases[j]});
+            }
+        }
+        if (plan.checks.empty() && plan.guard.upperBounds.empty())
+            return true;
+        if (!L.getLoopPreheader() || !L.getExitBlock())
+            return false;
+        SCEVExpander Expander(SE, L.getHeader()->getModule()->getDataLayout(), "lver");
+        for (const SCEV *UpperBound : plan.guard.upperBounds) {
+            if (!Expander.isSafeToExpandAt(UpperBound, L.getLoopPreheader()->getTerminator()))
+                return false;
+        }
+        if (plan.checks.empty())
+            return true;
+
+        const SCEV *LastIteration = getLastIteration(L, SE);
+        if (!LastIteration)
+            return false;
+        for (BasicBlock *BB : L.blocks()) {
+            for (Instruction &I : *BB) {
+                Value *Ptr = getLoadStorePointerOperand(&I);
+                if (!Ptr)
+                    continue;
+                AccessRange range;
+                if (!extractAccessRange(Ptr, getLoadStoreType(&I), L, LastIteration, SE, range))
+                    return false;
+                auto [it, inserted] = plan.ranges.insert({getBasePointer(Ptr, SE), range});
+                if (!inserted) {
+                    if (range.start->getType() != it->second.start->getType())
+                        return false;
+                    it->second = {SE.getUMinExpr(it->second.start, range.start), SE.getUMaxExpr(it->second.end, range.end)};
+                }
+            }
+        }
+        return true;
+    }
+
+    /*
+     * Version L on one overlap test per pair of bases and the bound guard, evaluated in the preheader: L becomes the
+     * fast path, taken when all pairs are disjoint and the guard holds, and a serial clone of it the fallback. Both
+     * loops exit to the original exit block.
+     */
+    void versionLoop(Loop &L, const VersioningPlan& plan, ScalarEvolution &SE, LoopInfo &LI, DominatorTree &DT) {
+        BasicBlock *RuntimeCheckBB = L.getLoopPreheader();
+        BasicBlock *ExitBB = L.getExitBlock();
+        Instruction *InsertPt = RuntimeCheckBB->getTerminator();
+
+        SCEVExpander Expander(SE, RuntimeCheckBB->getModule()->getDataLayout(), "lver");
+        IRBuilder<> Builder(InsertPt);
+        Value *Overlap = nullptr;
+        for (auto [base1, base2] : plan.checks) {
+            const AccessRange& range1 = plan.ranges.at(base1);
+            const AccessRange& range2 = plan.ranges.at(base2);
+            Type *PtrTy = range1.start->getType();
+            if (range2.start->getType() != PtrTy)
+                PtrTy = SE.getEffectiveSCEVType(PtrTy);
+            Value *Start1 = Expander.expandCodeFor(range1.start, PtrTy, InsertPt);
+            Value *End1 = Expander.expandCodeFor(range1.end, PtrTy, InsertPt);
+            Value *Start2 = Expander.expandCodeFor(range2.start, PtrTy, InsertPt);
+            Value *End2 = Expander.expandCodeFor(range2.end, PtrTy, InsertPt);
+            Builder.SetInsertPoint(InsertPt);
+            Value *Conflict = Builder.CreateAnd(Builder.CreateICmpULT(Start1, End2), Builder.CreateICmpULT(Start2, End1), "lver.conflict");
+            Overlap = Overlap ? Builder.CreateOr(Overlap, Conflict, "lver.overlap") : Conflict;
+        }
+        for (const SCEV *UpperBound : plan.guard.upperBounds) {
+            Value *Bound = Expander.expandCodeFor(UpperBound, UpperBound->getType(), InsertPt);
+            Builder.SetInsertPoint(InsertPt);
+            Value *Exceeded = Builder.CreateICmpSGT(Bound, ConstantInt::get(Bound->getType(), plan.guard.threshold), "lver.guard");
+            Overlap = Overlap ? Builder.CreateOr(Overlap, Exceeded, "lver.overlap") : Exceeded;
+        }
+        RuntimeCheckBB->setName(L.getHeader()->getName() + ".lver.check");
+
+        std::vector<Instruction*> liveOuts;
+        for (BasicBlock *BB : L.blocks()) {
+            for (Instruction &I : *BB) {
+                if (any_of(I.users(), [&](User *U) { return !L.contains(cast<Instruction>(U)); }))
+                    liveOuts.push_back(&I);
+            }
+        }
+
+        BasicBlock *PH = SplitBlock(RuntimeCheckBB, RuntimeCheckBB->getTerminator(), &DT, &LI, nullptr,
+                                    L.getHeader()->getName() + ".ph");
+        ValueToValueMapTy VMap;
+        SmallVector<BasicBlock*, 8> fallbackBlocks;
+        Loop *Fallback = cloneLoopWithPreheader(PH, RuntimeCheckBB, &L, VMap, ".lver.orig", &LI, &DT, fallbackBlocks);
+        remapInstructionsInBlocks(fallbackBlocks, VMap);
+
+        Instruction *OrigTerm = RuntimeCheckBB->getTerminator();
+        BranchInst::Create(Fallback->getLoopPreheader(), PH, Overlap, OrigTerm);
+        OrigTerm->eraseFromParent();
+        DT.changeImmediateDominator(ExitBB, RuntimeCheckBB);
+
+        // The exit block now joins both loops: its phis get the cloned incoming values, and the other values used after
+        // the loop are merged in new phis.
+        SmallVector<BasicBlock*, 4> exitingBlocks;
+        L.getExitingBlocks(exitingBlocks);
+        for (PHINode &Phi : ExitBB->phis()) {
+            for (BasicBlock *Exiting : exitingBlocks) {
+                int index = Phi.getBasicBlockIndex(Exiting);
+                if (index == -1)
+                    continue;
+                Value *Incoming = Phi.getIncomingValue(index);
+                Phi.addIncoming(VMap.count(Incoming) ? static_cast<Value*>(VMap[Incoming]) : Incoming, cast<BasicBlock>(VMap[Exiting]));
+            }
+        }
+        for (Instruction *I : liveOuts) {
+            PHINode *Phi = PHINode::Create(I->getType(), 2 * exitingBlocks.size(), I->getName() + ".lver",
+                                           ExitBB->getFirstNonPHI());
+            I->replaceUsesWithIf(Phi, [&](Use &U) {
+                auto *UserI = cast<Instruction>(U.getUser());
+                return UserI != Phi && !L.contains(UserI) && !Fallback->contains(UserI) &&
+                       !(isa<PHINode>(UserI) && UserI->getParent() == ExitBB);
+            });
+            for (BasicBlock *Exiting : exitingBlocks) {
+                Phi->addIncoming(I, Exiting);
+                Phi->addIncoming(VMap[I], cast<BasicBlock>(VMap[Exiting]));
+            }
+        }
+
+        formDedicatedExitBlocks(Fallback, &DT, &LI, nullptr, /* PreserveLCSSA = */ false);
+        formDedicatedExitBlocks(&L, &DT, &LI, nullptr, /* PreserveLCSSA = */ false);
+    }
+
+    /*
+     * The loops a serial innermost loop is distributed into, in the order they run: the stores of every loop, in
+     * program order, and whether the loop can run in parallel.
+     */
+    struct DistributionPlan {
+        std::vector<std::vector<StoreInst*> > loops;
+        std::vector<bool> parallel;
+    };
+
+    /*
+     * Loop distribution: the statements of the body are its stores, each with the instructions of the loop its value
+     * and address are computed from, and the branch conditions, which every copy of the loop keeps. The accesses of a
+     * statement are its store and the loads among these instructions. A dependence between the accesses of two
+     * statements orders them: with direction LT or GT from the earlier iteration to the later one (a carried
+     * dependence), and with EQ from the earlier instruction in the body to the later one. The strongly connected
+     * components of the graph are the recurrences, which have to stay in one loop. A component of a single statement
+     * that carries no dependence on itself can run in parallel, even if it depends on other components, since these run
+     * in loops of their own before it. The components are put in topological order, as close to program order as
+     * possible, and neighbours are fused as long as the loop keeps its kind: serial ones always, parallel ones if no
+     * dependence between them is carried. Return false if the loop is parallel already, or if distributing it yields no
+     * parallel loop.
+     */
+    bool planLoopDistribution(Loop &L, const LoopParallelismInfo::Impl& info, ScalarEvolution &SE, LoopInfo &LI,
+                              DistributionPlan& plan) {
+        if (!L.getSubLoops().empty() || info.isParallel || L.isAnnotatedParallel() || !info.knownBases ||
+            !info.knownRecurrences || !info.reductions.empty())
+            return false;
+        BasicBlock *Header = L.getHeader();
+        if (!L.getLoopPreheader() || L.getExitingBlock() != Header || !L.getUniqueExitBlock())
+            return false;
+        for (PHINode &Phi : Header->phis()) {
+            const auto *AddRec = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(&Phi));
+            if (!AddRec || AddRec->getLoop() != &L || !AddRec->isAffine())
+                return false;
+        }
+
+        LoopBlocksRPO RPOT(&L);
+        RPOT.perform(&LI);
+        std::unordered_map<const Instruction*, int> position;
+        std::vector<StoreInst*> stores;
+        std::vector<Instruction*> conditions;
+        for (BasicBlock *BB : RPOT) {
+            for (Instruction &I : *BB) {
+                if (isa<DbgInfoIntrinsic>(I))
+                    continue;
+                int index = position.size();
+                position[&I] = index;
+                for (User *U : I.users()) {
+                    if (!L.contains(cast<Instruction>(U)))
+                        return false;
+                }
+                if (auto *Store = dyn_cast<StoreInst>(&I)) {
+                    if (!Store->isSimple())
+                        return false;
+                    stores.push_back(Store);
+                } else if (auto *Load = dyn_cast<LoadInst>(&I)) {
+                    if (!Load->isSimple())
+                        return false;
+                } else if (I.mayReadOrWriteMemory() || I.mayHaveSideEffects()) {
+                    return false;
+                } else if (auto *Branch = dyn_cast<BranchInst>(&I); Branch && Branch->isConditional()) {
+                    if (auto *Condition = dyn_cast<Instruction>(Branch->getCondition()))
+                        conditions.push_back(Condition);
+                }
+            }
+        }
+        int n = stores.size();
+        if (n < 2 || n > 64)
+            return false;
+
+        // The statements of every load and store.
+        std::unordered_map<const Instruction*, std::vector<int> > statementsOf;
+        for (int s = 0; s < n; ++s) {
+            std::vector<Instruction*> worklist(conditions.begin(), conditions.end());
+            worklist.push_back(stores[s]);
+            SmallPtrSet<Instruction*, 32> visited;
+            while (!worklist.empty()) {
+                Instruction *I = worklist.back();
+                worklist.pop_back();
+                if (!L.contains(I) || (isa<PHINode>(I) && I->getParent() == Header) || !visited.insert(I).second)
+                    continue;
+                if (isa<LoadInst>(I) || isa<StoreInst>(I))
+                    statementsOf[I].push_back(s);
+                for (Value *Op : I->operands()) {
+                    if (auto *OpI = dyn_cast<Instruction>(Op))
+                        worklist.push_back(OpI);
+                }
+            }
+        }
+        std::unordered_map<const ArrayAccess*, std::vector<const Instruction*> > instructionsOf;
+        for (const auto& [I, access] : info.instructionAccesses) {
+            if (statementsOf.count(I))
+                instructionsOf[access].push_back(I);
+        }
+
+        std::vector<std::vector<bool> > reaches(n, std::vector<bool>(n, false)), carries(n, std::vector<bool>(n, false));
+        std::vector<bool> recurrent(n, false);
+        auto addEdge = [&](int from, int to, bool carried) {
+            if (from == to) {
+                recurrent[from] = recurrent[from] || carried;
+                return;
+            }
+            reaches[from][to] = true;
+            if (carried)
+                carries[from][to] = carries[to][from] = true;
+        };
+        for (const Dependence& dependence : computeDependences(info.arrayAccesses, info.bounds)) {
+            for (const DependenceVector& dependenceVector : dependence.dependenceVectors) {
+                const std::vector<Direction>& directions = dependenceVector.directions;
+                if (!std::all_of(directions.begin(), directions.end() - 1, [](Direction direction) {
+                        return direction == Direction::EQ || direction == Direction::ALL;
+                    }))
+                    continue;
+                Direction direction = directions.back();
+                for (const Instruction *I1 : instructionsOf[dependence.access1]) {
+                    for (const Instruction *I2 : instructionsOf[dependence.access2]) {
+                        for (int s1 : statementsOf[I1]) {
+                            for (int s2 : statementsOf[I2]) {
+                                if (direction == Direction::LT || direction == Direction::ALL)
+                                    addEdge(s1, s2, true);
+                                if (direction == Direction::GT || direction == Direction::ALL)
+                                    addEdge(s2, s1, true);
+                                if ((direction == Direction::EQ || direction == Direction::ALL) && I1 != I2) {
+                                    if (position[I1] < position[I2])
+                                        addEdge(s1, s2, false);
+                                    else
+                                        addEdge(s2, s1, false);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        // Stores with the same subscripts share one access, whose dependence on itself in the same iteration is not
+        // listed: the statements of every two of its stores are ordered by their position in the body.
+        for (const auto& [access, instructions] : instructionsOf) {
+            if (access->type)
+                continue;
+            for (const Instruction *I1 : instructions) {
+                for (const Instruction *I2 : instructions) {
+                    if (position[I1] >= position[I2])
+                        continue;
+                    for (int s1 : statementsOf[I1]) {
+                        for (int s2 : statementsOf[I2])
+                            addEdge(s1, s2, false);
+                    }
+                }
+            }
+        }
+
+        // Transitive closure, then the components and their order.
+        std::vector<std::vector<bool> > edges = reaches;
+        for (int k = 0; k < n; ++k) {
+            for (int i = 0; i < n; ++i) {
+                if (!reaches[i][k])
+                    continue;
+                for (int j = 0; j < n; ++j)
+                    reaches[i][j] = reaches[i][j] || reaches[k][j];
+            }
+        }
+        std::vector<int> component(n, -1);
+        std::vector<std::vector<int> > components;
+        for (int i = 0; i < n; ++i) {
+            if (component[i] != -1)
+                continue;
+            component[i] = components.size();
+            components.push_back({i});
+            for (int j = i + 1; j < n; ++j) {
+                if (reaches[i][j] && reaches[j][i]) {
+                    component[j] = component[i];
+                    components.back().push_back(j);
+                }
+            }
+        }
+        std::vector<int> predecessors(components.size(), 0);
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                if (edges[i][j] && component[i] != component[j])
+                    ++predecessors[component[j]];
+            }
+        }
+
+        plan.loops.clear();
+        plan.parallel.clear();
+        std::vector<bool> emitted(components.size(), false);
+        std::vector<int> current;
+        for (int step = 0; step < components.size(); ++step) {
+            // The ready component whose first statement comes first; components are numbered by their first statement.
+            int next = 0;
+            while (emitted[next] || predecessors[next] > 0)
+                ++next;
+            emitted[next] = true;
+            for (int i : components[next]) {
+                for (int j = 0; j < n; ++j) {
+                    if (edges[i][j] && component[j] != next)
+                        --predecessors[component[j]];
+                }
+            }
+
+            const std::vector<int>& statements = components[next];
+            bool isParallel = statements.size() == 1 && !recurrent[statements.front()];
+            bool fuses = !plan.loops.empty() && plan.parallel.back() == isParallel;
+            if (fuses && isParallel) {
+                fuses = none_of(current.begin(), current.end(), [&](int i) { return carries[i][statements.front()]; });
+            }
+            if (!fuses) {
+                current.clear();
+                plan.loops.emplace_back();
+                plan.parallel.push_back(isParallel);
+            }
+            current.insert(current.end(), statements.begin(), statements.end());
+            for (int i : statements)
+                plan.loops.back().push_back(stores[i]);
+        }
+        for (std::vector<StoreInst*>& loopStores : plan.loops) {
+            std::sort(loopStores.begin(), loopStores.end(),
+                      [&](StoreInst *S1, StoreInst *S2) { return position[S1] < position[S2]; });
+        }
+        return plan.loops.size() > 1 && std::find(plan.parallel.begin(), plan.parallel.end(), true) != plan.parallel.end();
+    }
+
+    /*
+     * Distribute L as planned: every loop of the plan but the last one is a copy of L, run before it from a preheader of
+     * its own, and keeps only its stores and what they are computed from.
+     */
+    void distributeLoop(Loop &L, const DistributionPlan& plan, ScalarEvolution &SE, LoopInfo &LI, DominatorTree &DT) {
+        // The copies are cloned with the preheader, which is made empty and given a single predecessor first.
+        BasicBlock *Preheader = L.getLoopPreheader();
+        if (!Preheader->getSinglePredecessor() || &Preheader->front() != Preheader->getTerminator())
+            Preheader = SplitBlock(Preheader, Preheader->getTerminator(), &DT, &LI);
+        BasicBlock *ExitBlock = L.getUniqueExitBlock();
+        SE.forgetLoop(&L);
+
+        // Drop from a loop the stores of the other loops, and what only they were computed from.
+        auto keepOnly = [&](int loop, ValueToValueMapTy *VMap) {
+            for (int j = 0; j < plan.loops.size(); ++j) {
+                if (j == loop)
+                    continue;
+                for (StoreInst *Store : plan.loops[j]) {
+                    auto *Copy = VMap ? cast<StoreInst>((*VMap)[Store]) : Store;
+                    Value *Stored = Copy->getValueOperand(), *Ptr = Copy->getPointerOperand();
+                    Copy->eraseFromParent();
+                    RecursivelyDeleteTriviallyDeadInstructions(Stored);
+                    RecursivelyDeleteTriviallyDeadInstructions(Ptr);
+                }
+            }
+        };
+
+        BasicBlock *Top = Preheader;
+        for (int i = plan.loops.size() - 2; i >= 0; --i) {
+            BasicBlock *Pred = Top->getSinglePredecessor();
+            ValueToValueMapTy VMap;
+            SmallVector<BasicBlock*, 8> clonedBlocks;
+            Loop *Clone = cloneLoopWithPreheader(Top, Pred, &L, VMap, ".ldist" + Twine(i), &LI, &DT, clonedBlocks);
+            VMap[ExitBlock] = Top;
+            remapInstructionsInBlocks(clonedBlocks, VMap);
+            Pred->getTerminator()->replaceUsesOfWith(Top, Clone->getLoopPreheader());
+            DT.changeImmediateDominator(Top, cast<BasicBlock>(VMap[L.getHeader()]));
+            keepOnly(i, &VMap);
+            Top = Clone->getLoopPreheader();
+        }
+        keepOnly(plan.loops.size() - 1, nullptr);
+    }
+
+    /*
+     * Report the dependences of a whole loop nest rooted at L. Only nests where all memory accesses are in the innermost
+     * loop of a single chain of loops are handled.
+     */
+    void reportLoopNest(Loop &L, const LoopParallelismInfo& result, OptimizationRemarkEmitter &ORE) {
+        const LoopParallelismInfo::Impl& info = result.getImpl();
+        if (DumpAnalysis)
+            report() << "Analysing loop nest: " << L.getLocStr() << "\n";
+
+        if (!info.innermost) {
+            ORE.emit([&]() {
+                return OptimizationRemarkMissed(DEBUG_TYPE, "NestNotPerfect", L.getStartLoc(), L.getHeader())
+                       << "loop nest is not perfectly nested";
+            });
+            if (DumpAnalysis) {
+                report() << "Loop nest is not perfectly nested, skipping" << "\n";
+                report() << "==============================\n";
+            }
+            return;
+        }
+
+        if (DumpAnalysis) {
+            for (const Dependence& dependence : info.dependences)
+                printDependence(dependence);
+        }
+
+        int level = result.getParallelLevel();
+        int depth = info.nestBounds.size();
+        int64_t skew = level == -1 && info.knownNestBases ? extractWavefrontSkew(info.dependences, depth) : -1;
+        if (level != -1) {
+            ORE.emit([&]() {
+                return OptimizationRemark(DEBUG_TYPE, "NestParallelizable", L.getStartLoc(), L.getHeader())
+                       << "loop at depth " << ore::NV("Depth", level) << " of the nest is safe to be parallelized";
+            });
+        } else if (skew != -1) {
+            ORE.emit([&]() {
+                return OptimizationRemarkAnalysis(DEBUG_TYPE, "NestParallelizableWavefronts", L.getStartLoc(), L.getHeader())
+                       << "the two innermost loops of the nest can run as wavefronts, with the loop at depth "
+                       << ore::NV("Depth", depth - 1) << " skewed by " << ore::NV("Skew", skew);
+            });
+        } else {
+            ORE.emit([&]() {
+                return OptimizationRemarkMissed(DEBUG_TYPE, "NestNotParallelizable", L.getStartLoc(), L.getHeader())
+                       << "no loop in the nest is safe to be parallelized";
+            });
+        }
+        if (DumpAnalysis) {
+            if (level != -1)
+                report() << "Outermost loop safe to be parallelized: var_" << level << "\n";
+            else if (skew != -1)
+                report() << "Loop nest is safe to be parallelized as wavefronts of var_" << depth - 2 << " and var_"
+                         << depth - 1 << ", with var_" << depth - 1 << " skewed by " << skew << "\n";
+            else
+                report() << "No loop in the nest is safe to be parallelized" << "\n";
+            report() << "==============================\n";
+        }
+    }
+
+    /*
+     * The analyses a loop analysis is computed from, for the function passes that query LoopParallelismAnalysis
+     * through the loop analysis manager.
+     */
+    LoopStandardAnalysisResults getLoopStandardAnalysisResults(Function &F, FunctionAnalysisManager &FAM) {
+        return {FAM.getResult<AAManager>(F), FAM.getResult<AssumptionAnalysis>(F), FAM.getResult<DominatorTreeAnalysis>(F),
+                FAM.getResult<LoopAnalysis>(F), FAM.getResult<ScalarEvolutionAnalysis>(F),
+                FAM.getResult<TargetLibraryAnalysis>(F), FAM.getResult<TargetIRAnalysis>(F), nullptr, nullptr, nullptr};
+    }
+
+    /*
+     * Printing mode: reports the verdicts of LoopParallelismAnalysis as remarks, and as text with the dump option.
+     */
+    struct LoopParallelization : PassInfoMixin<LoopParallelization> {
+        PreservedAnalyses run(Loop &L, LoopAnalysisManager &LAM,
+                              LoopStandardAnalysisResults &AR, LPMUpdater &U) {
+            // Loop passes have no access to the function analyses, so the emitter is built here, as LICM does.
+            OptimizationRemarkEmitter ORE(L.getHeader()->getParent());
+
+            if (!L.getSubLoops().empty()) {
+                if (L.isOutermost())
+                    reportLoopNest(L, LoopParallelismAnalysis::getUpToDateResult(L, LAM, AR), ORE);
+                return PreservedAnalyses::all();
+            }
+
+            if (DumpAnalysis)
+                report()<< "Analysing loop: " << L.getLocStr() << "\n";
+
+            const LoopParallelismInfo::Impl& info = LoopParallelismAnalysis::getUpToDateResult(L, LAM, AR).getImpl();
+            if (DumpAnalysis) {
+                for (const ArrayAccess& arrayAccess : info.arrayAccesses)
+                    printArrayAccess(arrayAccess);
+            }
+            bool skip_loop = !info.knownBases || !info.knownRecurrences;
+            for (const Reduction& reduction : info.reductions) {
+                ORE.emit([&]() {
+                    Instruction *I = reduction.phi ? static_cast<Instruction*>(reduction.phi) : reduction.store;
+                    return OptimizationRemarkAnalysis(DEBUG_TYPE, "Reduction", I)
+                           << ore::NV("Kind", getReductionName(reduction.kind)) << " reduction";
+                });
+                if (DumpAnalysis)
+                    printReduction(reduction);
+            }
+            for (const PrivateArray& privateArray : info.privateArrays) {
+                ORE.emit([&]() {
+                    return OptimizationRemarkAnalysis(DEBUG_TYPE, "PrivateArray", privateArray.alloca)
+                           << ore::NV("Base", privateArray.alloca) << " is private to every iteration"
+                           << (privateArray.isLiveOut ? ", and copied out after the last one" : "");
+                });
+                if (DumpAnalysis)
+                    report() << (privateArray.alloca->getAllocatedType()->isArrayTy() ? "Private array: " : "Private scalar: ")
+                             << privateArray.alloca->getName()
+                             << (privateArray.isLiveOut ? " (copied out)" : "") << "\n";
+            }
+
+            const ArrayAccess *dependent1 = nullptr, *dependent2 = nullptr;
+            for (auto [access1, access2, test] : info.pairs) {
+                if (!test) {
+                    dependent1 = access1;
+                    dependent2 = access2;
+                    continue;
+                }
+                ORE.emit([&]() {
+                    return OptimizationRemarkAnalysis(DEBUG_TYPE, "IndependentAccesses", access1->instruction)
+                           << "accesses " << ore::NV("Access", access1->instruction) << " and "
+                           << ore::NV("OtherAccess", access2->instruction) << " to " << ore::NV("Base", access1->baseAccess)
+                           << " are independent by the " << ore::NV("Test", test) << " test";
+                });
+            }
+            // The verdict of the transforms: independent accesses are not enough if a store hits the same element in
+            // two iterations or a call accesses memory.
+            bool isParallelizable = !skip_loop && info.isParallel;
+
+            if (isParallelizable) {
+                ORE.emit([&]() {
+                    return OptimizationRemark(DEBUG_TYPE, "Parallelizable", L.getStartLoc(), L.getHeader())
+                           << "loop is safe to be parallelized";
+                });
+                if (DumpAnalysis)
+                    report() << "Loop is safe to be parallelized" << "\n";
+            }
+            // The guard is only searched for if it is reported.
+            else if (!skip_loop && (DumpAnalysis || ORE.allowExtraAnalysis(DEBUG_TYPE)) &&
+                     getBoundGuard(L, info, AR.SE, AR.AA)) {
+                ORE.emit([&]() {
+                    return OptimizationRemarkAnalysis(DEBUG_TYPE, "ParallelizableIf", L.getStartLoc(), L.getHeader())
+                           << "loop is safe to be parallelized if " << ore::NV("Guard", getBoundGuardAsString(info.guard));
+                });
+                if (DumpAnalysis) {
+                    report() << "Loop is safe to be parallelized if: ";
+                    printBoundGuard(info.guard, report());
+                    report() << "\n";
+                }
+            }
+            else if (!skip_loop && info.chains > 1) {
+                ORE.emit([&]() {
+                    return OptimizationRemarkAnalysis(DEBUG_TYPE, "ParallelizableChains", L.getStartLoc(), L.getHeader())
+                           << "loop can run as " << ore::NV("Chains", info.chains)
+                           << " independent chains of iterations, the distances of its dependences being multiples of it";
+                });
+                if (DumpAnalysis)
+                    report() << "Loop is safe to be parallelized as " << info.chains << " chains of iterations" << "\n";
+            }
+            else
+            {
+                ORE.emit([&]() {
+                    OptimizationRemarkMissed Remark(DEBUG_TYPE, "NotParallelizable", L.getStartLoc(), L.getHeader());
+                    Remark << "loop is not safe to be parallelized: ";
+                    if (!info.knownBases)
+                        Remark << "memory is accessed through a pointer whose target is unknown";
+                    else if (!info.knownRecurrences)
+                        Remark << "a value is carried across iterations that is neither an induction nor a reduction";
+                    else if (dependent1)
+                        Remark << ore::NV("Access", dependent1->instruction) << " and "
+                               << ore::NV("OtherAccess", dependent2->instruction) << " to "
+                               << ore::NV("Base", dependent1->baseAccess) << " may depend on each other";
+                    else if (hasUnmodelledMemoryAccess(L))
+                        Remark << "a call, atomic or volatile access in the loop may access memory";
+                    else
+                        Remark << "a store may write the same element in two iterations";
+                    return Remark;
+                });
+                if (DumpAnalysis)
+                    report() << "Loop is not safe to be parallelized" << "\n";
+            }
+
+            if (DumpAnalysis)
+                report() << "==============================\n";
+            return PreservedAnalyses::all();
+        }
+
+        static bool isRequired() { return true; }
+    };
+
+    /*
+     * Annotation mode: the loops proven safe are marked parallel for LoopVectorize and LoopAccessAnalysis, which then
+     * trust the annotation instead of emitting their own dependence and alias checks.
+     */
+    struct LoopParallelizationMetadata : PassInfoMixin<LoopParallelizationMetadata> {
+        bool enableVectorize;
+
+        explicit LoopParallelizationMetadata(bool enableVectorize = false) : enableVectorize(enableVectorize) {}
+
+        PreservedAnalyses run(Loop &L, LoopAnalysisManager &LAM,
+                              LoopStandardAnalysisResults &AR, LPMUpdater &U) {
+            // The load and store of a memory reduction are not independent, so they cannot be put in the access group,
+            // and neither can the accesses to an array that is only private to every thread.
+            const LoopParallelismInfo::Impl& info = LoopParallelismAnalysis::getUpToDateResult(L, LAM, AR).getImpl();
+            if (info.isParallel && !hasMemoryReduction(info.reductions) && info.privateArrays.empty() &&
+                addParallelAccessesMetadata(L, enableVectorize)) {
+                OptimizationRemarkEmitter ORE(L.getHeader()->getParent());
+                ORE.emit([&]() {
+                    return OptimizationRemark(DEBUG_TYPE, "Annotated", L.getStartLoc(), L.getHeader())
+                           << "loop annotated with llvm.loop.parallel_accesses";
+                });
+            }
+            return PreservedAnalyses::all();
+        }
+
+        static bool isRequired() { return true; }
+    };
+
+    /*
+     * Versioning mode: innermost loops that are safe provided their pointer bases do not overlap are versioned on a
+     * runtime overlap check. The fast path is annotated as parallel, which the OpenMP transform also accepts.
+     */
+    struct LoopParallelizationVersioning : PassInfoMixin<LoopParallelizationVersioning> {
+        PreservedAnalyses run(Function &F, FunctionAnalysisManager &FAM) {
+            LoopInfo &LI = FAM.getResult<LoopAnalysis>(F);
+            ScalarEvolution &SE = FAM.getResult<ScalarEvolutionAnalysis>(F);
+            DominatorTree &DT = FAM.getResult<DominatorTreeAnalysis>(F);
+            LoopAnalysisManager &LAM = FAM.getResult<LoopAnalysisManagerFunctionProxy>(F).getManager();
+            LoopStandardAnalysisResults AR = getLoopStandardAnalysisResults(F, FAM);
+
+            std::vector<std::pair<Loop*, VersioningPlan> > candidates;
+            for (Loop *L : LI.getLoopsInPreorder()) {
+                // The fast path is only worth a clone if it can be annotated, which a memory instruction the tests do
+                // not model prevents (see addParallelAccessesMetadata).
+                if (!L->getSubLoops().empty() || L->isAnnotatedParallel() || hasUnmodelledMemoryAccess(*L))
+                    continue;
+                const LoopParallelismInfo::Impl& info = LoopParallelismAnalysis::getUpToDateResult(*L, LAM, AR).getImpl();
+                // The fast path is only annotated, which cannot express a memory reduction.
+                if (info.isParallel || !info.knownRecurrences || hasMemoryReduction(info.reductions))
+                    continue;
+                // Without pointer bases, the guard is the one of the analysis; otherwise the accesses are collected
+                // again, assuming that the pointers do not overlap.
+                VersioningPlan plan;
+                ArrayAccessSet pointerAccesses;
+                const ArrayAccessSet *arrayAccesses = &info.arrayAccesses;
+                if (info.knownBases) {
+                    if (!getBoundGuard(*L, info, SE, AR.AA))
+                        continue;
+                    plan.guard = info.guard;
+                } else {
+                    if (!collectArrayAccesses(*L, info.bounds, SE, pointerAccesses, /* print = */ false,
+                                              /* allowPointerBases = */ true))
+                        continue;
+                    if ((!isSafeParallelizable(pointerAccesses) || hasLoopCarriedOutputDependence(pointerAccesses, info.bounds)) &&
+                        !findBoundGuard(*L, info.bounds, SE, /* allowPointerBases = */ true, plan.guard))
+                        continue;
+                    arrayAccesses = &pointerAccesses;
+                }
+                if (planLoopVersioning(*L, *arrayAccesses, SE, AR.AA, plan))
+                    candidates.push_back({L, std::move(plan)});
+            }
+            if (candidates.empty())
+                return PreservedAnalyses::all();
+
+            OptimizationRemarkEmitter &ORE = FAM.getResult<OptimizationRemarkEmitterAnalysis>(F);
+            for (auto& [L, plan] : candidates) {
+                if (plan.checks.empty() && plan.guard.upperBounds.empty()) {
+                    ORE.emit([&]() {
+                        return OptimizationRemark(DEBUG_TYPE, "Annotated", L->getStartLoc(), L->getHeader())
+                               << "loop annotated with llvm.loop.parallel_accesses";
+                    });
+                    if (DumpAnalysis)
+                        report() << "Loop is safe to be parallelized: " << L->getLocStr() << "\n";
+                } else {
+                    ORE.emit([&]() {
+                        OptimizationRemark Remark(DEBUG_TYPE, "Versioned", L->getStartLoc(), L->getHeader());
+                        Remark << "loop versioned on " << ore::NV("OverlapChecks", static_cast<unsigned>(plan.checks.size()))
+                               << " overlap checks";
+                        if (!plan.guard.upperBounds.empty())
+                            Remark << " and guard " << ore::NV("Guard", getBoundGuardAsString(plan.guard));
+                        return Remark;
+                    });
+                    if (DumpAnalysis) {
+                        report() << "Versioning loop on " << plan.checks.size() << " overlap checks";
+                        if (!plan.guard.upperBounds.empty()) {
+                            report() << " and guard ";
+                            printBoundGuard(plan.guard, report());
+                        }
+                        report() << ": " << L->getLocStr() << "\n";
+                    }
+                    versionLoop(*L, plan, SE, LI, DT);
+                }
+                bool annotated = addParallelAccessesMetadata(*L, /* enableVectorize = */ false);
+                assert(annotated && "Loops with memory instructions the tests do not model are not versioned");
+                (void)annotated;
+            }
+
+            PreservedAnalyses PA;
+            PA.preserve<LoopAnalysis>();
+            PA.preserve<DominatorTreeAnalysis>();
+            return PA;
+        }
+
+        static bool isRequired() { return true; }
+    };
+
+    /*
+     * Distribution mode: innermost loops that are serial as a whole are split into loops that run one after the other
+     * (see planLoopDistribution), so that the statements outside the recurrences can run in parallel. The OpenMP and
+     * metadata passes then handle the parallel loops, so this pass is meant to run before them.
+     */
+    struct LoopParallelizationDistribution : PassInfoMixin<LoopParallelizationDistribution> {
+        PreservedAnalyses run(Function &F, FunctionAnalysisManager &FAM) {
+            LoopInfo &LI = FAM.getResult<LoopAnalysis>(F);
+            ScalarEvolution &SE = FAM.getResult<ScalarEvolutionAnalysis>(F);
+            DominatorTree &DT = FAM.getResult<DominatorTreeAnalysis>(F);
+            if (isOutlinedParallelRegion(F))
+                return PreservedAnalyses::all();
+            LoopAnalysisManager &LAM = FAM.getResult<LoopAnalysisManagerFunctionProxy>(F).getManager();
+            LoopStandardAnalysisResults AR = getLoopStandardAnalysisResults(F, FAM);
+
+            std::vector<std::pair<Loop*, DistributionPlan> > candidates;
+            for (Loop *L : LI.getLoopsInPreorder()) {
+                DistributionPlan plan;
+                if (L->getSubLoops().empty() &&
+                    planLoopDistribution(*L, LoopParallelismAnalysis::getUpToDateResult(*L, LAM, AR).getImpl(), SE, LI, plan))
+                    candidates.push_back({L, std::move(plan)});
+            }
+            if (candidates.empty())
+                return PreservedAnalyses::all();
+
+            OptimizationRemarkEmitter &ORE = FAM.getResult<OptimizationRemarkEmitterAnalysis>(F);
+            for (auto& [L, plan] : candidates) {
+                unsigned parallel = std::count(plan.parallel.begin(), plan.parallel.end(), true);
+                ORE.emit([&]() {
+                    return OptimizationRemark(DEBUG_TYPE, "Distributed", L->getStartLoc(), L->getHeader())
+                           << "loop distributed into " << ore::NV("Loops", static_cast<unsigned>(plan.loops.size()))
+                           << " loops, " << ore::NV("ParallelLoops", parallel) << " of them safe to be parallelized";
+                });
+                if (DumpAnalysis) {
+                    report() << "Distributing loop: " << L->getLocStr() << " into";
+                    for (int i = 0; i < plan.loops.size(); ++i)
+                        report() << " " << (plan.parallel[i] ? "parallel" : "serial") << "(" << plan.loops[i].size() << ")";
+                    report() << "\n";
+                }
+                distributeLoop(*L, plan, SE, LI, DT);
+            }
+
+            PreservedAnalyses PA;
+            PA.preserve<LoopAnalysis>();
+            PA.preserve<DominatorTreeAnalysis>();
+            return PA;
+        }
+
+        static bool isRequired() { return true; }
+    };
+
+    /*
+     * Task mode: runs of top-level loop nests that follow each other and touch no base another one of them writes are
+     * run concurrently, as the sections of one parallel region. Nests in which the OpenMP transform finds a parallel
+     * loop are left to it, so this pass is meant to run before loop-parallelization-openmp.
+     */
+    struct LoopParallelizationTasks : PassInfoMixin<LoopParallelizationTasks> {
+        PreservedAnalyses run(Function &F, FunctionAnalysisManager &FAM) {
+            LoopInfo &LI = FAM.getResult<LoopAnalysis>(F);
+            ScalarEvolution &SE = FAM.getResult<ScalarEvolutionAnalysis>(F);
+            DominatorTree &DT = FAM.getResult<DominatorTreeAnalysis>(F);
+            if (isOutlinedParallelRegion(F) || LI.getTopLevelLoops().size() < 2)
+                return PreservedAnalyses::all();
+            LoopAnalysisManager &LAM = FAM.getResult<LoopAnalysisManagerFunctionProxy>(F).getManager();
+            LoopStandardAnalysisResults AR = getLoopStandardAnalysisResults(F, FAM);
+
+            std::unordered_map<Loop*, AccessSummary> summaries;
+            for (Loop *L : LI.getTopLevelLoops()) {
+                if (!isTaskCandidate(*L, SE))
+                    continue;
+                Loop *Root;
+                std::vector<PHINode*> IndVars;
+                const LoopParallelismInfo::Impl& info = LoopParallelismAnalysis::getUpToDateResult(*L, LAM, AR).getImpl();
+                int64_t skew;
+                if (planNestParallelization(*L, info, SE, Root, IndVars) || planWavefront(*L, info, SE, Root, skew))
+                    continue;
+                bool hasParallelLoop = any_of(L->getLoopsInPreorder(), [&](Loop *Sub) {
+                    const LoopParallelismInfo& result = LoopParallelismAnalysis::getUpToDateResult(*Sub, LAM, AR);
+                    return Sub->isAnnotatedParallel() || result.isParallel() || result.getIndependentChains();
+                });
+                AccessSummary summary;
+                if (!hasParallelLoop && summarizeNestAccesses(*L, SE, summary))
+                    summaries[L] = std::move(summary);
+            }
+
+            // Follow the chains of sibling nests from their first candidate, and cut them where a nest conflicts with
+            // one already in the group.
+            SmallPtrSet<Loop*, 8> followers;
+            for (auto& [L, summary] : summaries) {
+                std::vector<BasicBlock*> between;
+                if (Loop *Next = getNextSiblingLoop(*L, LI, between))
+                    followers.insert(Next);
+            }
+            std::vector<std::pair<std::vector<Loop*>, std::vector<BasicBlock*> > > groups;
+            for (Loop *L : LI.getTopLevelLoops()) {
+                if (!summaries.count(L) || followers.count(L))
+                    continue;
+                std::vector<Loop*> nests = {L};
+                std::vector<BasicBlock*> between;
+                while (true) {
+                    size_t size = between.size();
+                    Loop *Next = getNextSiblingLoop(*nests.back(), LI, between);
+                    bool fits = Next && summaries.count(Next) && none_of(nests, [&](Loop *Nest) {
+                        return mayConflict(summaries[Nest], summaries[Next]);
+                    });
+                    if (!fits) {
+                        between.resize(size);
+                        if (nests.size() > 1)
+                            groups.push_back({std::move(nests), std::move(between)});
+                        nests = {};
+                        between.clear();
+                        if (!Next || !summaries.count(Next))
+                            break;
+                    }
+                    nests.push_back(Next);
+                }
+            }
+            if (groups.empty())
+                return PreservedAnalyses::all();
+
+            OptimizationRemarkEmitter &ORE = FAM.getResult<OptimizationRemarkEmitterAnalysis>(F);
+            OpenMPIRBuilder OMPBuilder(*F.getParent());
+            OMPBuilder.initialize();
+            for (auto& [nests, between] : groups) {
+                Loop *First = nests.front();
+                ORE.emit([&]() {
+                    return OptimizationRemark(DEBUG_TYPE, "ParallelizedTasks", First->getStartLoc(), First->getHeader())
+                           << ore::NV("Nests", static_cast<unsigned>(nests.size()))
+                           << " independent loop nests run as concurrent OpenMP sections";
+                });
+                if (DumpAnalysis) {
+                    report() << "Running " << nests.size() << " loop nests as tasks:";
+                    for (Loop *Nest : nests)
+                        report() << " " << Nest->getLocStr();
+                    report() << "\n";
+                }
+                outlineParallelSections(nests, between, OMPBuilder, SE, LI, DT);
+            }
+            OMPBuilder.finalize();
+
+            PreservedAnalyses PA;
+            PA.preserve<LoopAnalysis>();
+            PA.preserve<DominatorTreeAnalysis>();
+            PA.preserve<ScalarEvolutionAnalysis>();
+            return PA;
+        }
+
+        static bool isRequired() { return true; }
+    };
+
+    /*
+     * Transform mode: every innermost loop the tests prove safe, or that is annotated as parallel (e.g. the fast path
+     * of a versioned loop), is outlined and run by an OpenMP team. Perfect nests are parallelized as a whole where
+     * planNestParallelization finds a coarser level than the innermost loop.
+     */
+    struct LoopParallelizationOpenMP : PassInfoMixin<LoopParallelizationOpenMP> {
+        PreservedAnalyses run(Function &F, FunctionAnalysisManager &FAM) {
+            LoopInfo &LI = FAM.getResult<LoopAnalysis>(F);
+            ScalarEvolution &SE = FAM.getResult<ScalarEvolutionAnalysis>(F);
+            DominatorTree &DT = FAM.getResult<DominatorTreeAnalysis>(F);
+
+            std::vector<std::tuple<Loop*, std::vector<PHINode*>, std::vector<Reduction>, int64_t, std::vector<PrivateArray> > >
+                    candidates;
+            std::vector<std::pair<Loop*, int64_t> > wavefronts;
+            if (isOutlinedParallelRegion(F))
+                return PreservedAnalyses::all();
+            LoopAnalysisManager &LAM = FAM.getResult<LoopAnalysisManagerFunctionProxy>(F).getManager();
+            LoopStandardAnalysisResults AR = getLoopStandardAnalysisResults(F, FAM);
+            for (Loop *L : LI.getLoopsInPreorder()) {
+                if (any_of(candidates, [&](const auto& candidate) { return std::get<0>(candidate)->contains(L); }) ||
+                    any_of(wavefronts, [&](const auto& wavefront) { return wavefront.first->contains(L); }))
+                    continue;
+                const LoopParallelismInfo::Impl& info = LoopParallelismAnalysis::getUpToDateResult(*L, LAM, AR).getImpl();
+                Loop *Root;
+                std::vector<PHINode*> IndVars;
+                if (L->isOutermost() && planNestParallelization(*L, info, SE, Root, IndVars)) {
+                    candidates.push_back({Root, std::move(IndVars), {}, 0, {}});
+                    continue;
+                }
+                int64_t skew;
+                if (L->isOutermost() && planWavefront(*L, info, SE, Root, skew)) {
+                    wavefronts.push_back({Root, skew});
+                    continue;
+                }
+                // A loop that is neither proven nor annotated parallel may still run its independent chains in parallel.
+                int64_t chains = 0;
+                if (!info.isParallel) {
+                    bool isAnnotated = L->getSubLoops().empty() && L->isAnnotatedParallel();
+                    if (!isAnnotated && info.chains > 1)
+                        chains = info.chains;
+                    if ((!isAnnotated && !chains) || !info.knownRecurrences || hasMemoryReduction(info.reductions))
+                        continue;
+                }
+                PHINode *IndVar = getOutlinableInductionVariable(*L, SE, info.reductions);
+                if (IndVar && chains <= APInt::getSignedMaxValue(IndVar->getType()->getIntegerBitWidth()).getSExtValue())
+                    candidates.push_back({L, {IndVar}, info.reductions, chains,
+                                          info.isParallel ? info.privateArrays : std::vector<PrivateArray>()});
+            }
+            if (candidates.empty() && wavefronts.empty())
+                return PreservedAnalyses::all();
+
+            OptimizationRemarkEmitter &ORE = FAM.getResult<OptimizationRemarkEmitterAnalysis>(F);
+            OpenMPIRBuilder OMPBuilder(*F.getParent());
+            OMPBuilder.initialize();
+            for (auto [L, skew] : wavefronts) {
+                unsigned depth = L->getLoopDepth();
+                ORE.emit([&]() {
+                    return OptimizationRemark(DEBUG_TYPE, "ParallelizedWavefronts", L->getStartLoc(), L->getHeader())
+                           << "loop nest parallelized with OpenMP as wavefronts of " << ore::NV("Tile", WavefrontTile.getValue())
+                           << "x" << ore::NV("Tile", WavefrontTile.getValue()) << " tiles, with the loop at depth "
+                           << ore::NV("Depth", depth) << " skewed by " << ore::NV("Skew", skew);
+                });
+                if (DumpAnalysis)
+                    report() << "Parallelizing loop nest as wavefronts: " << L->getLocStr() << " on var_" << depth - 1
+                             << " and var_" << depth << ", skew " << skew << ", tile " << WavefrontTile << "\n";
+                outlineWavefront(*L, skew, WavefrontTile, OMPBuilder, SE, LI, DT);
+            }
+            for (auto& [L, IndVars, reductions, chains, privateArrays] : candidates) {
+                unsigned distributedDepth = LI.getLoopDepth(IndVars.front()->getParent()) - 1;
+                unsigned collapsed = IndVars.size();
+                if (collapsed > 1) {
+                    ORE.emit([&]() {
+                        return OptimizationRemark(DEBUG_TYPE, "ParallelizedNest", L->getStartLoc(), L->getHeader())
+                               << "loop nest parallelized with OpenMP, with the " << ore::NV("Collapsed", collapsed)
+                               << " loops from depth " << ore::NV("Depth", distributedDepth) << " collapsed";
+                    });
+                    if (DumpAnalysis)
+                        report() << "Parallelizing loop nest: " << L->getLocStr() << " on var_" << distributedDepth
+                                 << "..var_" << distributedDepth + collapsed - 1 << "\n";
+                } else if (L->getHeader() != IndVars.front()->getParent()) {
+                    ORE.emit([&]() {
+                        return OptimizationRemark(DEBUG_TYPE, "ParallelizedNest", L->getStartLoc(), L->getHeader())
+                               << "loop nest parallelized with OpenMP, with the loop at depth "
+                               << ore::NV("Depth", distributedDepth) << " interchanged outward";
+                    });
+                    if (DumpAnalysis)
+                        report() << "Parallelizing loop nest: " << L->getLocStr() << " on var_" << distributedDepth << "\n";
+                } else if (chains) {
+                    ORE.emit([&]() {
+                        return OptimizationRemark(DEBUG_TYPE, "ParallelizedChains", L->getStartLoc(), L->getHeader())
+                               << "loop at depth " << ore::NV("Depth", distributedDepth) << " parallelized with OpenMP as "
+                               << ore::NV("Chains", chains) << " chains of iterations, with "
+                               << ore::NV("Reductions", static_cast<unsigned>(reductions.size())) << " reductions";
+                    });
+                    if (DumpAnalysis)
+                        report() << "Parallelizing loop as " << chains << " chains: " << L->getLocStr() << "\n";
+                } else {
+                    ORE.emit([&]() {
+                        return OptimizationRemark(DEBUG_TYPE, "Parallelized", L->getStartLoc(), L->getHeader())
+                               << "loop at depth " << ore::NV("Depth", distributedDepth) << " parallelized with OpenMP, with "
+                               << ore::NV("Reductions", static_cast<unsigned>(reductions.size())) << " reductions";
+                    });
+                    if (DumpAnalysis)
+                        report() << "Parallelizing loop: " << L->getLocStr() << "\n";
+                }
+                outlineParallelLoop(*L, IndVars, reductions, OMPBuilder, SE, LI, DT, chains, privateArrays);
+            }
+            OMPBuilder.finalize();
+
+            PreservedAnalyses PA;
+            PA.preserve<LoopAnalysis>();
+            PA.preserve<DominatorTreeAnalysis>();
+            PA.preserve<ScalarEvolutionAnalysis>();
+            return PA;
+        }
+
+        static bool isRequired() { return true; }
+    };
+}
+
+// Boilerplate registration code.
+llvm::PassPluginLibraryInfo getParallelizePassInfo() {
+    const auto callback = [](PassBuilder &PB) {
+        PB.registerAnalysisRegistrationCallback([](LoopAnalysisManager &LAM) {
+            LAM.registerPass([] { return LoopParallelismAnalysis(); });
+        });
+        PB.registerPipelineParsingCallback(
+                [&](StringRef name, LoopPassManager &LPM,
+                    ArrayRef<PassBuilder::PipelineElement>) {
+                    if (name == "loop-parallelization") {
+                        LPM.addPass(LoopParallelization());
+                        return true;
+                    }
+                    if (name == "loop-parallelization-metadata") {
+                        LPM.addPass(LoopParallelizationMetadata());
+                        return true;
+                    }
+                    if (name == "loop-parallelization-metadata<vectorize>") {
+                        LPM.addPass(LoopParallelizationMetadata(/* enableVectorize = */ true));
+                        return true;
+                    }
+                    if (name == "require<loop-parallelism>") {
+                        LPM.addPass(RequireAnalysisPass<LoopParallelismAnalysis, Loop, LoopAnalysisManager,
+                                                        LoopStandardAnalysisResults&, LPMUpdater&>());
+                        return true;
+                    }
+                    if (name == "invalidate<loop-parallelism>") {
+                        LPM.addPass(InvalidateAnalysisPass<LoopParallelismAnalysis>());
+                        return true;
+                    }
+                    return false;
+                });
+        PB.registerPipelineParsingCallback(
+                [&](StringRef name, FunctionPassManager &FPM,
+                    ArrayRef<PassBuilder::PipelineElement>) {
+                    if (name == "loop-parallelization-versioning") {
+                        FPM.addPass(LoopParallelizationVersioning());
+                        return true;
+                    }
+                    if (name == "loop-parallelization-openmp") {
+                        FPM.addPass(LoopParallelizationOpenMP());
+                        return true;
+                    }
+                    if (name == "loop-parallelization-tasks") {
+                        FPM.addPass(LoopParallelizationTasks());
+                        return true;
+                    }
+                    if (name == "loop-parallelization-distribution") {
+                        FPM.addPass(LoopParallelizationDistribution());
                         return true;
                     }
                     return false;
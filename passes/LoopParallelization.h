@@ -0,0 +1,137 @@
+#ifndef LOOP_PARALLELIZATION_H
+#define LOOP_PARALLELIZATION_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Analysis/LoopAnalysisManager.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassPlugin.h"
+#include "llvm/Support/raw_ostream.h"
+#include <memory>
+#include <vector>
+
+/*
+ * Stream the passes write their report to: errs(), unless a stream was set for the calling thread. This lets a driver
+ * that runs modules in parallel collect the report of every module separately.
+ */
+llvm::raw_ostream& loopParallelizationReport();
+void setLoopParallelizationReport(llvm::raw_ostream *OS);
+
+/*
+ * Default of the -loop-parallelization-dump option, for drivers that print the text report unless their command line
+ * turns it off. Call it before cl::ParseCommandLineOptions.
+ */
+void setLoopParallelizationDumpDefault(bool Dump);
+
+/*
+ * What the dependence analysis knows about one loop: for an innermost loop, its array accesses, reductions, the test that
+ * proved every pair of accesses independent and the verdicts; for the outermost loop of a perfect nest, the direction
+ * and distance vectors of the nest. It is cached in the LoopAnalysisManager, so the printing pass, the transforms and
+ * other passes share a single analysis of each loop.
+ */
+class LoopParallelismInfo {
+public:
+    struct Impl;
+
+    enum class Direction { LT, EQ, GT, ALL };
+
+    struct Distance {
+        bool isKnown;
+        int64_t value;
+    };
+
+    /*
+     * One direction vector (outermost loop first) under which access1 in iteration I and access2 in iteration I'
+     * may touch the same element. Direction LT at level k means I[k] < I'[k], and the distance is I'[k] - I[k].
+     */
+    struct DependenceVector {
+        std::vector<Direction> directions;
+        std::vector<Distance> distances;
+    };
+
+    /*
+     * The analysis tells loads and stores apart by base and subscripts only, so an access stands for every load or
+     * store of the loop with its base and subscripts, and is named by the first of them.
+     */
+    struct AccessPair {
+        const llvm::Instruction *access1;
+        const llvm::Instruction *access2;
+        // The test that proved the accesses independent, or nullptr if they may depend on each other.
+        const char *test;
+    };
+
+    struct NestDependence {
+        const llvm::Instruction *access1;
+        const llvm::Instruction *access2;
+        llvm::ArrayRef<DependenceVector> dependenceVectors;
+    };
+
+    explicit LoopParallelismInfo(std::unique_ptr<Impl> impl);
+    LoopParallelismInfo(LoopParallelismInfo &&);
+    ~LoopParallelismInfo();
+
+    /*
+     * An innermost loop whose iterations can run in parallel: the accesses are independent, no store hits the same
+     * element in two iterations, every value carried across iterations is a reduction and no call writes memory. The
+     * stack arrays that every iteration writes before it reads them may need a copy per thread for that.
+     */
+    bool isParallel() const;
+
+    /*
+     * For an innermost loop that is not parallel, the number g > 1 of chains its iterations split into when every
+     * dependence it carries has a distance that is a multiple of g, or 0. The iterations i, i + g, i + 2g, ... of a chain
+     * run in order, and different chains can run in parallel.
+     */
+    int64_t getIndependentChains() const;
+
+    /*
+     * For the outermost loop of a perfect nest, the depth of the outermost loop that carries no dependence, or -1.
+     */
+    int getParallelLevel() const;
+
+    /*
+     * For an innermost loop, the pairs of accesses the tests were run on, in order, up to the first one they could not
+     * prove independent. The pairs of a loop that is parallel with private arrays leave out the private arrays.
+     */
+    std::vector<AccessPair> getAccessPairs() const;
+
+    /*
+     * For the outermost loop of a perfect nest whose bases are known, the pairs of accesses of the innermost loop, over
+     * the iterations of the whole nest, that may touch the same element, with their direction and distance vectors.
+     */
+    std::vector<NestDependence> getNestDependences() const;
+
+    const Impl &getImpl() const { return *impl; }
+
+    bool invalidate(llvm::Loop &L, const llvm::PreservedAnalyses &PA, llvm::LoopAnalysisManager::Invalidator &Inv);
+
+private:
+    std::unique_ptr<Impl> impl;
+};
+
+class LoopParallelismAnalysis : public llvm::AnalysisInfoMixin<LoopParallelismAnalysis> {
+    friend llvm::AnalysisInfoMixin<LoopParallelismAnalysis>;
+    static llvm::AnalysisKey Key;
+
+public:
+    using Result = LoopParallelismInfo;
+
+    Result run(llvm::Loop &L, llvm::LoopAnalysisManager &LAM, llvm::LoopStandardAnalysisResults &AR);
+
+    /*
+     * The result for L, analysed again if its loops or memory instructions changed since it was cached. A loop pass
+     * only invalidates the results of the loop it ran on, while the result of L also covers the loops inside it, and
+     * passes on the loops around L may move instructions out of it. The passes of the plugin query the analysis this
+     * way, and so should other passes.
+     */
+    static const Result &getUpToDateResult(llvm::Loop &L, llvm::LoopAnalysisManager &LAM,
+                                           llvm::LoopStandardAnalysisResults &AR);
+};
+
+/*
+ * Registers the loop-parallelization passes and LoopParallelismAnalysis with a PassBuilder, for the plugin and for
+ * drivers linking the passes in.
+ */
+llvm::PassPluginLibraryInfo getParallelizePassInfo();
+
+#endif // LOOP_PARALLELIZATION_H
@@ -0,0 +1,122 @@
+; RUN: %opt -disable-output -passes='loop(loop-parallelization)' -loop-parallelization-dump %s 2>&1 | %FileCheck %s
+;
+; Every loop copies b[i] to a[i], which is only parallel if a and b do not overlap. Alias analysis proves it for the
+; noalias (restrict) parameters of @restrict and for the scoped noalias metadata of @scoped, and cannot for the plain
+; pointers of @plain. In @scoped_in_loop the scopes are declared in the loop, so they only separate the accesses of one
+; iteration and are dropped.
+
+; CHECK-LABEL: Analysing loop: loc
+; CHECK-NEXT: Load in: ptr %b
+; CHECK: Store in: ptr %a
+; CHECK: Loop is safe to be parallelized
+
+; CHECK-LABEL: Analysing loop: loc
+; CHECK-NEXT: Load in: ptr %b
+; CHECK: Store in: ptr %a
+; CHECK: Loop is not safe to be parallelized
+
+; CHECK-LABEL: Analysing loop: loc
+; CHECK-NEXT: Load in: ptr %b
+; CHECK: Store in: ptr %a
+; CHECK: Loop is safe to be parallelized
+
+; CHECK-LABEL: Analysing loop: loc
+; CHECK-NEXT: Load in: ptr %b
+; CHECK: Store in: ptr %a
+; CHECK: Loop is not safe to be parallelized
+
+define void @restrict(ptr noalias %a, ptr noalias %b) {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 100
+  br i1 %cond, label %body, label %exit
+
+body:
+  %pb = getelementptr inbounds i32, ptr %b, i64 %i
+  %v = load i32, ptr %pb
+  %pa = getelementptr inbounds i32, ptr %a, i64 %i
+  store i32 %v, ptr %pa
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+define void @plain(ptr %a, ptr %b) {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 100
+  br i1 %cond, label %body, label %exit
+
+body:
+  %pb = getelementptr inbounds i32, ptr %b, i64 %i
+  %v = load i32, ptr %pb
+  %pa = getelementptr inbounds i32, ptr %a, i64 %i
+  store i32 %v, ptr %pa
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+define void @scoped(ptr %a, ptr %b) {
+entry:
+  call void @llvm.experimental.noalias.scope.decl(metadata !0)
+  call void @llvm.experimental.noalias.scope.decl(metadata !3)
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 100
+  br i1 %cond, label %body, label %exit
+
+body:
+  %pb = getelementptr inbounds i32, ptr %b, i64 %i
+  %v = load i32, ptr %pb, !alias.scope !3, !noalias !0
+  %pa = getelementptr inbounds i32, ptr %a, i64 %i
+  store i32 %v, ptr %pa, !alias.scope !0, !noalias !3
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+define void @scoped_in_loop(ptr %a, ptr %b) {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 100
+  br i1 %cond, label %body, label %exit
+
+body:
+  call void @llvm.experimental.noalias.scope.decl(metadata !0)
+  call void @llvm.experimental.noalias.scope.decl(metadata !3)
+  %pb = getelementptr inbounds i32, ptr %b, i64 %i
+  %v = load i32, ptr %pb, !alias.scope !3, !noalias !0
+  %pa = getelementptr inbounds i32, ptr %a, i64 %i
+  store i32 %v, ptr %pa, !alias.scope !0, !noalias !3
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+declare void @llvm.experimental.noalias.scope.decl(metadata)
+
+!0 = !{!1}
+!1 = distinct !{!1, !2, !"copy: a"}
+!2 = distinct !{!2, !"copy"}
+!3 = !{!4}
+!4 = distinct !{!4, !2, !"copy: b"}
@@ -0,0 +1,93 @@
+; RUN: %opt -disable-output -debug-pass-manager -passes='loop(require<loop-parallelism>,loop-parallelization-metadata,invalidate<loop-parallelism>,loop-parallelization)' %s 2>&1 | %FileCheck %s --check-prefix=PM
+; RUN: %opt -S -passes='loop(require<loop-parallelism>,loop-parallelization-metadata,invalidate<loop-parallelism>,loop-parallelization)' -loop-parallelization-dump %s 2> %t.dump | %FileCheck %s
+; RUN: %FileCheck %s --check-prefix=DUMP < %t.dump
+; RUN: %opt -disable-output -passes='loop(require<loop-parallelism>),loop-mssa(licm,loop-parallelization)' -loop-parallelization-dump %s 2>&1 | %FileCheck %s --check-prefix=STALE
+;
+; LoopParallelismAnalysis is computed once per loop and shared by the passes of a loop pipeline: require<> computes it,
+; the metadata pass uses the cached result, and after invalidate<> the printing pass computes it again, with the same
+; verdicts. The result of the root of a nest covers the loops inside it. LICM on the inner loop of @rows hoists the
+; load of c[i] into the body of the outer loop, which only invalidates the result of the inner loop, and LICM on the
+; outer loop changes nothing: the printing pass must still see that the nest is no longer perfect.
+
+; PM: Running analysis: LoopParallelismAnalysis on
+; PM-NOT: Running analysis: LoopParallelismAnalysis
+; PM: Running pass: {{.*}}LoopParallelizationMetadata on
+; PM-NOT: Running analysis: LoopParallelismAnalysis
+; PM: Invalidating analysis: LoopParallelismAnalysis on
+; PM-NOT: Running analysis: LoopParallelismAnalysis
+; PM: Running pass: {{.*}}LoopParallelization on
+; PM-NEXT: Running analysis: LoopParallelismAnalysis on
+
+; CHECK-LABEL: define void @copy()
+; CHECK: store i64 %add, ptr %pa, {{.*}}!llvm.access.group
+; CHECK: br label %header, !llvm.loop ![[LOOP:[0-9]+]]
+; CHECK-DAG: ![[LOOP]] = distinct !{![[LOOP]], ![[PARALLEL:[0-9]+]]}
+; CHECK-DAG: ![[PARALLEL]] = !{!"llvm.loop.parallel_accesses", !{{[0-9]+}}}
+
+; DUMP-LABEL: Analysing loop:
+; DUMP: Loop is safe to be parallelized
+
+; STALE-LABEL: Analysing loop nest:
+; STALE-NEXT: Loop nest is not perfectly nested, skipping
+
+@a = global [100 x [100 x i64]] zeroinitializer
+@b = global [100 x i64] zeroinitializer
+@c = global [100 x i64] zeroinitializer
+
+; c[i] = b[i] + 1
+define void @copy() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 100
+  br i1 %cond, label %body, label %exit
+
+body:
+  %pb = getelementptr inbounds [100 x i64], ptr @b, i64 0, i64 %i
+  %vb = load i64, ptr %pb
+  %add = add nsw i64 %vb, 1
+  %pa = getelementptr inbounds [100 x i64], ptr @c, i64 0, i64 %i
+  store i64 %add, ptr %pa
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+; a[i][j] = c[i] + j
+define void @rows() {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %outer.cond = icmp slt i64 %i, 100
+  br i1 %outer.cond, label %outer.body, label %exit
+
+outer.body:
+  br label %inner.header
+
+inner.header:
+  %j = phi i64 [ 0, %outer.body ], [ %j.next, %inner.body ]
+  %pc = getelementptr inbounds [100 x i64], ptr @c, i64 0, i64 %i
+  %vc = load i64, ptr %pc
+  %inner.cond = icmp slt i64 %j, 100
+  br i1 %inner.cond, label %inner.body, label %outer.latch
+
+inner.body:
+  %add = add nsw i64 %vc, %j
+  %pa = getelementptr inbounds [100 x [100 x i64]], ptr @a, i64 0, i64 %i, i64 %j
+  store i64 %add, ptr %pa
+  %j.next = add nsw i64 %j, 1
+  br label %inner.header
+
+outer.latch:
+  %i.next = add nsw i64 %i, 1
+  br label %outer.header
+
+exit:
+  ret void
+}
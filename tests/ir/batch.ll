@@ -0,0 +1,81 @@
+; RUN: %loop-par-batch -j 2 %s %S/invariant.ll -o %t.report 2> %t.log
+; RUN: %FileCheck %s < %t.report
+; RUN: %FileCheck %s --check-prefix=LOG < %t.log
+; RUN: ! %loop-par-batch -j 2 %s %t.missing.ll -o %t.failed 2> %t.err
+; RUN: %FileCheck %s --check-prefix=FAILED < %t.failed
+; RUN: %FileCheck %s --check-prefix=ERR < %t.err
+;
+; loop-par-batch analyses its inputs on a thread pool, prints the verdicts by default and writes the reports in the
+; order of the inputs, this module first. An input that cannot be parsed gets the error as its report and makes the
+; driver fail, after the other inputs are analysed.
+
+; CHECK: ## {{.*}}batch.ll
+; CHECK: Loop is safe to be parallelized
+; CHECK: Loop is not safe to be parallelized
+; CHECK: ## {{.*}}invariant.ll
+; CHECK: Loop is safe to be parallelized
+; CHECK: Loop is not safe to be parallelized
+; CHECK: Loop is not safe to be parallelized
+; CHECK-NOT: ##
+
+; LOG: Analysed 2 of 2 modules
+
+; FAILED: ## {{.*}}batch.ll
+; FAILED: Loop is safe to be parallelized
+; FAILED: ## {{.*}}missing.ll
+; FAILED-NEXT: loop-par-batch: {{.*}}error:
+
+; ERR: loop-par-batch: {{.*}}missing.ll failed
+; ERR: Analysed 1 of 2 modules
+
+@a = global [1000 x i64] zeroinitializer
+@b = global [1000 x i64] zeroinitializer
+
+; a[i] = b[i] + 1
+define void @copy() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 1000
+  br i1 %cond, label %body, label %exit
+
+body:
+  %pb = getelementptr inbounds [1000 x i64], ptr @b, i64 0, i64 %i
+  %vb = load i64, ptr %pb
+  %add = add nsw i64 %vb, 1
+  %pa = getelementptr inbounds [1000 x i64], ptr @a, i64 0, i64 %i
+  store i64 %add, ptr %pa
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+; b[i] = b[i - 1] + a[i]
+define void @prefix() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 1, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 1000
+  br i1 %cond, label %body, label %exit
+
+body:
+  %im1 = add nsw i64 %i, -1
+  %pp = getelementptr inbounds [1000 x i64], ptr @b, i64 0, i64 %im1
+  %vp = load i64, ptr %pp
+  %pa = getelementptr inbounds [1000 x i64], ptr @a, i64 0, i64 %i
+  %va = load i64, ptr %pa
+  %add = add nsw i64 %vp, %va
+  %pb = getelementptr inbounds [1000 x i64], ptr @b, i64 0, i64 %i
+  store i64 %add, ptr %pb
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
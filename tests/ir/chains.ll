@@ -0,0 +1,270 @@
+; RUN: %opt -disable-output -passes=loop-parallelization-openmp -loop-parallelization-wavefront-tile=0 -loop-parallelization-dump %s 2>&1 | %FileCheck %s --check-prefix=PLAN
+; RUN: %opt -S -passes=loop-parallelization-openmp -loop-parallelization-wavefront-tile=0 %s | %FileCheck %s
+; RUN: %lli %s | %FileCheck %s --check-prefix=OUT
+; RUN: %opt -passes=loop-parallelization-openmp -loop-parallelization-wavefront-tile=0 %s -o %t.bc
+; RUN: %lli %t.bc | %FileCheck %s --check-prefix=OUT
+;
+; Loops whose dependences all have constant distances run as independent chains of iterations, as many as the gcd of
+; the distances: a[i] = 3 * a[i - 4] + b[i] as 4 chains, the recurrence on g at distances 4 and 6 (with a reduction)
+; as 2, and the inner loop of @k_2d, at distance 3, as 3, since wavefronts are disabled. A chain per iteration is
+; enough when there are fewer iterations than chains, as in the second call of @k_d4. The recurrence at distance 1
+; stays serial. The chains of @k_d4_u32, whose induction variable is an unsigned i32, are scheduled in i64 as well.
+
+; PLAN: Parallelizing loop as 4 chains: loc
+; PLAN-NEXT: Parallelizing loop as 2 chains: loc
+; PLAN-NEXT: Parallelizing loop as 3 chains: loc
+; PLAN: Parallelizing loop as 4 chains: loc
+
+; CHECK-LABEL: define void @k_d4(
+; CHECK: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @k_d4.omp_outlined,
+; CHECK-LABEL: define i64 @k_64red(
+; CHECK: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @k_64red.omp_outlined,
+; CHECK-LABEL: define void @k_d1(
+; CHECK-NOT: __kmpc_fork_call
+; CHECK-LABEL: define void @k_2d(
+; CHECK: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @k_2d.omp_outlined,
+; CHECK-LABEL: define void @k_d4_u32(
+; CHECK: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @k_d4_u32.omp_outlined,
+; CHECK-LABEL: define internal void @k_d4.omp_outlined(
+; CHECK: %omp.chains = select i1 %{{[0-9]+}}, i64 %omp.trip_count, i64 4
+; CHECK: %omp.empty = icmp eq i64 %omp.chains, 0
+; CHECK: %omp.last_index = select i1 %omp.empty, i64 0, i64 %{{[0-9]+}}
+; CHECK: %omp.chain = phi i64 [ %omp.chunk.begin, %omp.entry ]
+; CHECK: %omp.iv.next = add i64 %omp.iv, 4
+; CHECK: %omp.chain.next = add i64 %omp.chain, 1
+; CHECK: %omp.chain.left = sub i64 %omp.trip_count, %omp.iv
+; CHECK: %omp.chain.end = icmp ule i64 %omp.chain.left, 4
+; CHECK-LABEL: define internal void @k_64red.omp_outlined(
+; CHECK: %omp.chains = select i1 %{{[0-9]+}}, i64 %omp.trip_count, i64 2
+; CHECK-LABEL: define internal void @k_2d.omp_outlined(
+; CHECK: %omp.chains = select i1 %{{[0-9]+}}, i64 %omp.trip_count, i64 3
+; CHECK-LABEL: define internal void @k_d4_u32.omp_outlined(
+; CHECK: %omp.chains = select i1 %{{[0-9]+}}, i64 %omp.trip_count, i64 4
+; CHECK: call void @__kmpc_for_static_init_8u(
+; CHECK: trunc i64 %omp.iv to i32
+; CHECK: %omp.chain.end = icmp ule i64 %omp.chain.left, 4
+
+; OUT: -6444077580758175237
+; OUT-NEXT: -1235370570037042363
+; OUT-NEXT: -5080728501105268578
+; OUT-NEXT: 78114580208750
+; OUT-NEXT: 4649967684491508092
+; OUT-NEXT: -1559797787692902650
+
+@a = global [5000 x i64] zeroinitializer
+@b = global [5000 x i64] zeroinitializer
+@g = global [5000 x i64] zeroinitializer
+@h = global [5000 x i64] zeroinitializer
+@c = global [64 x [300 x i64]] zeroinitializer
+@d = global [5000 x i64] zeroinitializer
+@fmt = private constant [5 x i8] c"%ld\0A\00"
+
+declare i32 @printf(ptr, ...)
+
+define void @k_d4(i64 %n) {
+entry:
+  br label %h
+
+h:
+  %i = phi i64 [ 4, %entry ], [ %i.n, %b ]
+  %c = icmp slt i64 %i, %n
+  br i1 %c, label %b, label %e
+
+b:
+  %im = sub nsw i64 %i, 4
+  %p0 = getelementptr inbounds [5000 x i64], ptr @a, i64 0, i64 %im
+  %v0 = load i64, ptr %p0
+  %pb = getelementptr inbounds [5000 x i64], ptr @b, i64 0, i64 %i
+  %vb = load i64, ptr %pb
+  %t = mul nsw i64 %v0, 3
+  %r = add nsw i64 %t, %vb
+  %p1 = getelementptr inbounds [5000 x i64], ptr @a, i64 0, i64 %i
+  store i64 %r, ptr %p1
+  %i.n = add nsw i64 %i, 1
+  br label %h
+
+e:
+  ret void
+}
+
+define i64 @k_64red(i64 %n) {
+entry:
+  br label %h
+
+h:
+  %i = phi i64 [ 6, %entry ], [ %i.n, %b ]
+  %s = phi i64 [ 0, %entry ], [ %s.n, %b ]
+  %c = icmp slt i64 %i, %n
+  br i1 %c, label %b, label %e
+
+b:
+  %i6 = sub nsw i64 %i, 6
+  %i4 = sub nsw i64 %i, 4
+  %p6 = getelementptr inbounds [5000 x i64], ptr @g, i64 0, i64 %i6
+  %v6 = load i64, ptr %p6
+  %p4 = getelementptr inbounds [5000 x i64], ptr @g, i64 0, i64 %i4
+  %v4 = load i64, ptr %p4
+  %t = mul nsw i64 %v6, 5
+  %r = xor i64 %t, %v4
+  %r2 = add nsw i64 %r, %i
+  %p1 = getelementptr inbounds [5000 x i64], ptr @g, i64 0, i64 %i
+  store i64 %r2, ptr %p1
+  %s.n = add i64 %s, %r2
+  %i.n = add nsw i64 %i, 1
+  br label %h
+
+e:
+  ret i64 %s
+}
+
+define void @k_d1(i64 %n) {
+entry:
+  br label %h
+
+h:
+  %i = phi i64 [ 1, %entry ], [ %i.n, %b ]
+  %c = icmp slt i64 %i, %n
+  br i1 %c, label %b, label %e
+
+b:
+  %im = sub nsw i64 %i, 1
+  %p0 = getelementptr inbounds [5000 x i64], ptr @h, i64 0, i64 %im
+  %v0 = load i64, ptr %p0
+  %r = add nsw i64 %v0, %i
+  %p1 = getelementptr inbounds [5000 x i64], ptr @h, i64 0, i64 %i
+  store i64 %r, ptr %p1
+  %i.n = add nsw i64 %i, 1
+  br label %h
+
+e:
+  ret void
+}
+
+define void @k_2d() {
+entry:
+  br label %h0
+
+h0:
+  %i = phi i64 [ 1, %entry ], [ %i.n, %l0 ]
+  %c0 = icmp slt i64 %i, 64
+  br i1 %c0, label %ph, label %e0
+
+ph:
+  br label %h1
+
+h1:
+  %j = phi i64 [ 3, %ph ], [ %j.n, %b1 ]
+  %c1 = icmp slt i64 %j, 300
+  br i1 %c1, label %b1, label %l0
+
+b1:
+  %jm = sub nsw i64 %j, 3
+  %im = sub nsw i64 %i, 1
+  %p0 = getelementptr inbounds [64 x [300 x i64]], ptr @c, i64 0, i64 %i, i64 %jm
+  %v0 = load i64, ptr %p0
+  %p2 = getelementptr inbounds [64 x [300 x i64]], ptr @c, i64 0, i64 %im, i64 %j
+  %v2 = load i64, ptr %p2
+  %t = mul nsw i64 %v0, 7
+  %r0 = add nsw i64 %t, %v2
+  %r = add nsw i64 %r0, %j
+  %p1 = getelementptr inbounds [64 x [300 x i64]], ptr @c, i64 0, i64 %i, i64 %j
+  store i64 %r, ptr %p1
+  %j.n = add nsw i64 %j, 1
+  br label %h1
+
+l0:
+  %i.n = add nsw i64 %i, 1
+  br label %h0
+
+e0:
+  ret void
+}
+
+define void @k_d4_u32(i32 %n) {
+entry:
+  br label %h
+
+h:
+  %i = phi i32 [ 4, %entry ], [ %i.n, %b ]
+  %c = icmp ult i32 %i, %n
+  br i1 %c, label %b, label %e
+
+b:
+  %im = sub nuw i32 %i, 4
+  %p0 = getelementptr inbounds [5000 x i64], ptr @d, i32 0, i32 %im
+  %v0 = load i64, ptr %p0
+  %pb = getelementptr inbounds [5000 x i64], ptr @b, i32 0, i32 %i
+  %vb = load i64, ptr %pb
+  %t = mul nsw i64 %v0, 3
+  %r = add nsw i64 %t, %vb
+  %p1 = getelementptr inbounds [5000 x i64], ptr @d, i32 0, i32 %i
+  store i64 %r, ptr %p1
+  %i.n = add nuw i32 %i, 1
+  br label %h
+
+e:
+  ret void
+}
+
+define i64 @sum(ptr %p, i64 %n) {
+entry:
+  br label %h
+
+h:
+  %x = phi i64 [ 0, %entry ], [ %x.n, %b ]
+  %s = phi i64 [ 0, %entry ], [ %s.n, %b ]
+  %c = icmp slt i64 %x, %n
+  br i1 %c, label %b, label %e
+
+b:
+  %q = getelementptr inbounds i64, ptr %p, i64 %x
+  %w = load i64, ptr %q
+  %m = mul i64 %w, %x
+  %s.n = add i64 %s, %m
+  %x.n = add i64 %x, 1
+  br label %h
+
+e:
+  ret i64 %s
+}
+
+define i32 @main() {
+entry:
+  br label %ih
+
+ih:
+  %k = phi i64 [ 0, %entry ], [ %k.n, %ib ]
+  %kc = icmp slt i64 %k, 5000
+  br i1 %kc, label %ib, label %run
+
+ib:
+  %pa = getelementptr inbounds [5000 x i64], ptr @a, i64 0, i64 %k
+  store i64 %k, ptr %pa
+  %pb = getelementptr inbounds [5000 x i64], ptr @b, i64 0, i64 %k
+  %kk = mul i64 %k, 13
+  store i64 %kk, ptr %pb
+  %pg = getelementptr inbounds [5000 x i64], ptr @g, i64 0, i64 %k
+  store i64 %kk, ptr %pg
+  %k.n = add i64 %k, 1
+  br label %ih
+
+run:
+  call void @k_d4(i64 4999)
+  %red = call i64 @k_64red(i64 5000)
+  call void @k_d1(i64 5000)
+  call void @k_2d()
+  call void @k_d4(i64 6)
+  call void @k_d4_u32(i32 5000)
+  %s1 = call i64 @sum(ptr @a, i64 5000)
+  %s2 = call i64 @sum(ptr @g, i64 5000)
+  %s3 = call i64 @sum(ptr @h, i64 5000)
+  %s4 = call i64 @sum(ptr @c, i64 19200)
+  %s5 = call i64 @sum(ptr @d, i64 5000)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s1)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %red)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s2)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s3)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s4)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s5)
+  ret i32 0
+}
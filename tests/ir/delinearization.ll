@@ -0,0 +1,191 @@
+; RUN: %opt -disable-output -passes='loop(loop-parallelization)' -loop-parallelization-dump %s 2>&1 | %FileCheck %s
+;
+; @f is a flat array indexed as a matrix, f[i * n + j], with rows of 64 elements in @flat and @flat_next and of n in
+; @param and @param_next. The subscript is split into a row i and a column j when j provably stays within [0, n):
+; then the rows are independent and the outer loops are parallel. The column j + 1 of @flat_next and @param_next
+; reaches n, so these stay one subscript, 64 * i + j + 1, which the tests cannot tell from the store, or unknown when n
+; is a parameter, and both loops are serial.
+
+; CHECK-LABEL: Analysing loop: loc
+; CHECK-NEXT: Load in: @f
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 99 ] * 1 + var_1[ 0, 63 ] * 0
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 99 ] * 0 + var_1[ 0, 63 ] * 1
+; CHECK-NEXT: Store in: @f
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 99 ] * 1 + var_1[ 0, 63 ] * 0
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 99 ] * 0 + var_1[ 0, 63 ] * 1
+; CHECK-NEXT: Loop is safe to be parallelized
+; CHECK: Outermost loop safe to be parallelized: var_0
+
+; CHECK-LABEL: Analysing loop: loc
+; CHECK-NEXT: Load in: @f
+; CHECK-NEXT: Array index access: 1 + var_0[ 0, 98 ] * 64 + var_1[ 0, 63 ] * 1
+; CHECK-NEXT: Store in: @f
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 98 ] * 64 + var_1[ 0, 63 ] * 1
+; CHECK-NEXT: Loop is not safe to be parallelized
+; CHECK: No loop in the nest is safe to be parallelized
+
+; CHECK-LABEL: Analysing loop: loc
+; CHECK-NEXT: Load in: @f
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 99 ] * 1 + var_1[ {{.*}} ] * 0
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 99 ] * 0 + var_1[ {{.*}} ] * 1
+; CHECK-NEXT: Store in: @f
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 99 ] * 1 + var_1[ {{.*}} ] * 0
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 99 ] * 0 + var_1[ {{.*}} ] * 1
+; CHECK-NEXT: Loop is safe to be parallelized
+; CHECK: Outermost loop safe to be parallelized: var_0
+
+; CHECK-LABEL: Analysing loop: loc
+; CHECK-NEXT: Load in: @f
+; CHECK-NEXT: Array index access: UnknownExpr
+; CHECK-NEXT: Store in: @f
+; CHECK-NEXT: Array index access: UnknownExpr
+; CHECK-NEXT: Loop is not safe to be parallelized
+; CHECK: No loop in the nest is safe to be parallelized
+
+@f = global [6400 x i32] zeroinitializer
+
+; f[i * 64 + j] += 1
+define void @flat() {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %outer.cond = icmp slt i64 %i, 100
+  br i1 %outer.cond, label %outer.body, label %exit
+
+outer.body:
+  %row = mul nsw i64 %i, 64
+  br label %inner.header
+
+inner.header:
+  %j = phi i64 [ 0, %outer.body ], [ %j.next, %inner.body ]
+  %inner.cond = icmp slt i64 %j, 64
+  br i1 %inner.cond, label %inner.body, label %outer.latch
+
+inner.body:
+  %idx = add nsw i64 %row, %j
+  %p = getelementptr inbounds [6400 x i32], ptr @f, i64 0, i64 %idx
+  %v = load i32, ptr %p
+  %add = add nsw i32 %v, 1
+  store i32 %add, ptr %p
+  %j.next = add nsw i64 %j, 1
+  br label %inner.header
+
+outer.latch:
+  %i.next = add nsw i64 %i, 1
+  br label %outer.header
+
+exit:
+  ret void
+}
+
+; f[i * 64 + j] = f[i * 64 + j + 1]
+define void @flat_next() {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %outer.cond = icmp slt i64 %i, 99
+  br i1 %outer.cond, label %outer.body, label %exit
+
+outer.body:
+  %row = mul nsw i64 %i, 64
+  br label %inner.header
+
+inner.header:
+  %j = phi i64 [ 0, %outer.body ], [ %j.next, %inner.body ]
+  %inner.cond = icmp slt i64 %j, 64
+  br i1 %inner.cond, label %inner.body, label %outer.latch
+
+inner.body:
+  %idx = add nsw i64 %row, %j
+  %idx1 = add nsw i64 %idx, 1
+  %pr = getelementptr inbounds [6400 x i32], ptr @f, i64 0, i64 %idx1
+  %v = load i32, ptr %pr
+  %pw = getelementptr inbounds [6400 x i32], ptr @f, i64 0, i64 %idx
+  store i32 %v, ptr %pw
+  %j.next = add nsw i64 %j, 1
+  br label %inner.header
+
+outer.latch:
+  %i.next = add nsw i64 %i, 1
+  br label %outer.header
+
+exit:
+  ret void
+}
+
+; f[i * n + j] += 1
+define void @param(i64 %n) {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %outer.cond = icmp slt i64 %i, 100
+  br i1 %outer.cond, label %outer.body, label %exit
+
+outer.body:
+  %row = mul nsw i64 %i, %n
+  br label %inner.header
+
+inner.header:
+  %j = phi i64 [ 0, %outer.body ], [ %j.next, %inner.body ]
+  %inner.cond = icmp slt i64 %j, %n
+  br i1 %inner.cond, label %inner.body, label %outer.latch
+
+inner.body:
+  %idx = add nsw i64 %row, %j
+  %p = getelementptr inbounds [6400 x i32], ptr @f, i64 0, i64 %idx
+  %v = load i32, ptr %p
+  %add = add nsw i32 %v, 1
+  store i32 %add, ptr %p
+  %j.next = add nsw i64 %j, 1
+  br label %inner.header
+
+outer.latch:
+  %i.next = add nsw i64 %i, 1
+  br label %outer.header
+
+exit:
+  ret void
+}
+
+; f[i * n + j] = a[i * n + j + 1]
+define void @param_next(i64 %n) {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %outer.cond = icmp slt i64 %i, 100
+  br i1 %outer.cond, label %outer.body, label %exit
+
+outer.body:
+  %row = mul nsw i64 %i, %n
+  br label %inner.header
+
+inner.header:
+  %j = phi i64 [ 0, %outer.body ], [ %j.next, %inner.body ]
+  %inner.cond = icmp slt i64 %j, %n
+  br i1 %inner.cond, label %inner.body, label %outer.latch
+
+inner.body:
+  %idx = add nsw i64 %row, %j
+  %idx1 = add nsw i64 %idx, 1
+  %pr = getelementptr inbounds [6400 x i32], ptr @f, i64 0, i64 %idx1
+  %v = load i32, ptr %pr
+  %pw = getelementptr inbounds [6400 x i32], ptr @f, i64 0, i64 %idx
+  store i32 %v, ptr %pw
+  %j.next = add nsw i64 %j, 1
+  br label %inner.header
+
+outer.latch:
+  %i.next = add nsw i64 %i, 1
+  br label %outer.header
+
+exit:
+  ret void
+}
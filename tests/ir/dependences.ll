@@ -0,0 +1,127 @@
+; RUN: %opt -disable-output -passes='loop(loop-parallelization)' -loop-parallelization-dump %s 2>&1 | %FileCheck %s
+;
+; Direction and distance vectors of perfect nests, from the store to the load: @rows carries its dependence on the
+; outer loop only, @columns on the inner loop only, and in @shift the outer loop appears in no subscript, so its
+; direction stays '*' and its distance unknown, for the store against itself as for the store against the load.
+
+; CHECK-LABEL: Analysing loop nest:
+; CHECK: Direction vector: (<, =) Distance vector: (1, 0)
+; CHECK-NEXT: Outermost loop safe to be parallelized: var_1
+; CHECK-LABEL: Analysing loop nest:
+; CHECK: Direction vector: (=, <) Distance vector: (0, 2)
+; CHECK-NEXT: Outermost loop safe to be parallelized: var_0
+; CHECK-LABEL: Analysing loop nest:
+; CHECK: Direction vector: (*, =) Distance vector: (unknown, 0)
+; CHECK: Direction vector: (*, >) Distance vector: (unknown, -1)
+; CHECK-NEXT: No loop in the nest is safe to be parallelized
+
+@a = global [100 x [100 x i64]] zeroinitializer
+@v = global [100 x i64] zeroinitializer
+
+; a[i][j] = a[i - 1][j] + 1
+define void @rows() {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 1, %entry ], [ %i.next, %outer.latch ]
+  %outer.cond = icmp slt i64 %i, 100
+  br i1 %outer.cond, label %outer.body, label %exit
+
+outer.body:
+  br label %inner.header
+
+inner.header:
+  %j = phi i64 [ 0, %outer.body ], [ %j.next, %inner.body ]
+  %inner.cond = icmp slt i64 %j, 100
+  br i1 %inner.cond, label %inner.body, label %outer.latch
+
+inner.body:
+  %im1 = add nsw i64 %i, -1
+  %pl = getelementptr inbounds [100 x [100 x i64]], ptr @a, i64 0, i64 %im1, i64 %j
+  %vl = load i64, ptr %pl
+  %add = add nsw i64 %vl, 1
+  %ps = getelementptr inbounds [100 x [100 x i64]], ptr @a, i64 0, i64 %i, i64 %j
+  store i64 %add, ptr %ps
+  %j.next = add nsw i64 %j, 1
+  br label %inner.header
+
+outer.latch:
+  %i.next = add nsw i64 %i, 1
+  br label %outer.header
+
+exit:
+  ret void
+}
+
+; a[i][j] = a[i][j - 2] + 1
+define void @columns() {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %outer.cond = icmp slt i64 %i, 100
+  br i1 %outer.cond, label %outer.body, label %exit
+
+outer.body:
+  br label %inner.header
+
+inner.header:
+  %j = phi i64 [ 2, %outer.body ], [ %j.next, %inner.body ]
+  %inner.cond = icmp slt i64 %j, 100
+  br i1 %inner.cond, label %inner.body, label %outer.latch
+
+inner.body:
+  %jm2 = add nsw i64 %j, -2
+  %pl = getelementptr inbounds [100 x [100 x i64]], ptr @a, i64 0, i64 %i, i64 %jm2
+  %vl = load i64, ptr %pl
+  %add = add nsw i64 %vl, 1
+  %ps = getelementptr inbounds [100 x [100 x i64]], ptr @a, i64 0, i64 %i, i64 %j
+  store i64 %add, ptr %ps
+  %j.next = add nsw i64 %j, 1
+  br label %inner.header
+
+outer.latch:
+  %i.next = add nsw i64 %i, 1
+  br label %outer.header
+
+exit:
+  ret void
+}
+
+; v[j] = v[j + 1] + 1
+define void @shift() {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %outer.cond = icmp slt i64 %i, 100
+  br i1 %outer.cond, label %outer.body, label %exit
+
+outer.body:
+  br label %inner.header
+
+inner.header:
+  %j = phi i64 [ 0, %outer.body ], [ %j.next, %inner.body ]
+  %inner.cond = icmp slt i64 %j, 99
+  br i1 %inner.cond, label %inner.body, label %outer.latch
+
+inner.body:
+  %jp1 = add nsw i64 %j, 1
+  %pl = getelementptr inbounds [100 x i64], ptr @v, i64 0, i64 %jp1
+  %vl = load i64, ptr %pl
+  %add = add nsw i64 %vl, 1
+  %ps = getelementptr inbounds [100 x i64], ptr @v, i64 0, i64 %j
+  store i64 %add, ptr %ps
+  %j.next = add nsw i64 %j, 1
+  br label %inner.header
+
+outer.latch:
+  %i.next = add nsw i64 %i, 1
+  br label %outer.header
+
+exit:
+  ret void
+}
@@ -0,0 +1,526 @@
+; RUN: %opt -disable-output -passes=loop-parallelization-distribution -loop-parallelization-dump %s 2>&1 | grep Distributing | %FileCheck %s --check-prefix=PLAN
+; RUN: %opt -S -passes=loop-parallelization-distribution %s | %FileCheck %s
+; RUN: %opt -S -passes=loop-parallelization-distribution,loop-parallelization-openmp %s | %FileCheck %s --check-prefix=OPENMP
+; RUN: %lli %s | %FileCheck %s --check-prefix=OUT
+; RUN: %opt -passes=loop-parallelization-distribution %s -o %t.bc
+; RUN: %lli %t.bc | %FileCheck %s --check-prefix=OUT
+; RUN: %opt -passes=loop-parallelization-distribution,loop-parallelization-openmp %s -o %t.omp.bc
+; RUN: %lli %t.omp.bc | %FileCheck %s --check-prefix=OUT
+;
+; Loops whose statements do not all carry a dependence are split into a loop per group of statements, in the order of
+; the dependences between them. A recurrence is split from the statement next to it that does not take part in it
+; (@split), and goes after a statement that reads its array before it is overwritten (@read_first). Statements that
+; depend on each other across iterations form one recurrence, and their loop is left as it is (@cycle). Two statements
+; that are each parallel, with a dependence carried from one to the other, get a loop each, in the order the dependence
+; sets, since a shared loop would carry it (@no_fusion); statements without one share a loop (@fusion). Two stores to
+; the same element keep their order (@overwrite).
+
+; PLAN: Distributing loop: loc into serial(1) parallel(1)
+; PLAN-NEXT: Distributing loop: loc into parallel(1) serial(1)
+; PLAN-NEXT: Distributing loop: loc into parallel(1) parallel(1)
+; PLAN-NEXT: Distributing loop: loc into parallel(1) serial(1)
+; PLAN-NEXT: Distributing loop: loc into serial(1) parallel(2)
+; PLAN-NEXT: Distributing loop: loc into parallel(1) parallel(2)
+; PLAN-NOT: Distributing
+
+; CHECK-LABEL: define void @split()
+; CHECK: h.ldist0:
+; CHECK-NOT: store
+; CHECK: store i64 %t2.ldist0, ptr %ps3.ldist0
+; CHECK-NOT: store
+; CHECK: {{^}}h:
+; CHECK-NOT: store
+; CHECK: store i64 %t4, ptr %ps5
+; CHECK-NOT: store
+; CHECK: ret void
+
+; CHECK-LABEL: define void @read_first()
+; CHECK: h.ldist0:
+; CHECK-NOT: store
+; CHECK: store i64 %t1.ldist0, ptr %ps7.ldist0
+; CHECK-NOT: store
+; CHECK: {{^}}h:
+; CHECK-NOT: store
+; CHECK: store i64 %t3, ptr %ps9
+; CHECK-NOT: store
+; CHECK: ret void
+
+; CHECK-LABEL: define void @cycle()
+; CHECK-NOT: ldist
+; CHECK: store i64 %t1, ptr %ps11
+; CHECK-NEXT: %ix12 = add nsw i64 %i, 0
+; CHECK: store i64 %t2, ptr %ps13
+; CHECK-NOT: ldist
+; CHECK: ret void
+
+; CHECK-LABEL: define void @no_fusion()
+; CHECK: h.ldist0:
+; CHECK-NOT: store
+; CHECK: store i64 %t2.ldist0, ptr %ps17.ldist0
+; CHECK-NOT: store
+; CHECK: {{^}}h:
+; CHECK-NOT: store
+; CHECK: store i64 %t1, ptr %ps15
+; CHECK-NOT: store
+; CHECK: ret void
+
+; CHECK-LABEL: define void @fusion()
+; CHECK: h.ldist0:
+; CHECK-NOT: store
+; CHECK: store i64 %t1.ldist0, ptr %ps26.ldist0
+; CHECK-NOT: store
+; CHECK: {{^}}h:
+; CHECK-NOT: store
+; CHECK: store i64 %t2, ptr %ps28
+; CHECK-NOT: {{^}}h
+; CHECK: store i64 %t3, ptr %ps30
+; CHECK-NOT: store
+; CHECK: ret void
+
+; CHECK-LABEL: define void @overwrite()
+; CHECK: h.ldist0:
+; CHECK-NOT: store
+; CHECK: store i64 %v33.ldist0, ptr %ps34.ldist0
+; CHECK-NOT: store
+; CHECK: {{^}}h:
+; CHECK-NOT: store
+; CHECK: store i64 %v31, ptr %ps31
+; CHECK-NOT: store
+; CHECK: store i64 5, ptr %ps32
+; CHECK-NOT: store
+; CHECK: ret void
+
+; OPENMP-LABEL: define void @split()
+; OPENMP: h.ldist0:
+; OPENMP: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @split.omp_outlined,
+; OPENMP-NOT: __kmpc_fork_call
+; OPENMP-LABEL: define void @read_first()
+; OPENMP: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @read_first.omp_outlined,
+; OPENMP-NOT: __kmpc_fork_call
+; OPENMP-LABEL: define void @cycle()
+; OPENMP-NOT: __kmpc_fork_call
+; OPENMP-LABEL: define void @no_fusion()
+; OPENMP: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @no_fusion.omp_outlined,
+; OPENMP: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @no_fusion.omp_outlined.1,
+; OPENMP-LABEL: define void @conditional()
+; OPENMP-LABEL: define void @fusion()
+; OPENMP: h.ldist0:
+; OPENMP: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @fusion.omp_outlined,
+; OPENMP-NOT: __kmpc_fork_call
+; OPENMP-LABEL: define void @overwrite()
+; OPENMP: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @overwrite.omp_outlined,
+; OPENMP: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @overwrite.omp_outlined.1,
+; OPENMP-LABEL: define i64 @sum(
+; OPENMP-LABEL: define internal void @no_fusion.omp_outlined(
+; OPENMP: store i64 %t2.ldist0.omp, ptr %ps17.ldist0.omp
+; OPENMP-LABEL: define internal void @no_fusion.omp_outlined.1(
+; OPENMP: store i64 %t1.omp, ptr %ps15.omp
+
+; OUT: 51767602423283
+; OUT-NEXT: 13814819094665586
+; OUT-NEXT: 27588227471473572
+; OUT-NEXT: 2201352902941828456
+; OUT-NEXT: 41413374552586
+; OUT-NEXT: 41413372561582
+; OUT-NEXT: 13814819096680578
+; OUT-NEXT: 41392659494381502
+; OUT-NEXT: 27632816841676140
+; OUT-NEXT: 5165499949151776656
+; OUT-NEXT: -8122674878695561799
+; OUT-NEXT: 9975010
+; OUT-NEXT: 13783748715937038
+
+@a = global [2000 x i64] zeroinitializer
+@b = global [2000 x i64] zeroinitializer
+@c = global [2000 x i64] zeroinitializer
+@d = global [2000 x i64] zeroinitializer
+@e = global [2000 x i64] zeroinitializer
+@f = global [2000 x i64] zeroinitializer
+@g = global [2000 x i64] zeroinitializer
+@h = global [2000 x i64] zeroinitializer
+@p = global [2000 x i64] zeroinitializer
+@q = global [2000 x i64] zeroinitializer
+@r = global [2000 x i64] zeroinitializer
+@s = global [2000 x i64] zeroinitializer
+@t = global [2000 x i64] zeroinitializer
+@u = global [2000 x i64] zeroinitializer
+@fmt = private constant [5 x i8] c"%ld\0A\00"
+
+declare i32 @printf(ptr, ...)
+
+; a[i] = 3 * a[i - 1] + b[i] is a recurrence, c[i] = 2 * b[i] + i is independent of it
+define void @split() {
+entry:
+  br label %h
+
+h:
+  %i = phi i64 [ 2, %entry ], [ %i.n, %latch ]
+  %c = icmp slt i64 %i, 1998
+  br i1 %c, label %b, label %e
+
+b:
+  %ix1 = add nsw i64 %i, -1
+  %pl1 = getelementptr inbounds [2000 x i64], ptr @a, i64 0, i64 %ix1
+  %v1 = load i64, ptr %pl1
+  %ix2 = add nsw i64 %i, 0
+  %pl2 = getelementptr inbounds [2000 x i64], ptr @b, i64 0, i64 %ix2
+  %v2 = load i64, ptr %pl2
+  %t1 = mul i64 %v1, 3
+  %t2 = add i64 %t1, %v2
+  %ix3 = add nsw i64 %i, 0
+  %ps3 = getelementptr inbounds [2000 x i64], ptr @a, i64 0, i64 %ix3
+  store i64 %t2, ptr %ps3
+  %ix4 = add nsw i64 %i, 0
+  %pl4 = getelementptr inbounds [2000 x i64], ptr @b, i64 0, i64 %ix4
+  %v4 = load i64, ptr %pl4
+  %t3 = mul i64 %v4, 2
+  %t4 = add i64 %t3, %i
+  %ix5 = add nsw i64 %i, 0
+  %ps5 = getelementptr inbounds [2000 x i64], ptr @c, i64 0, i64 %ix5
+  store i64 %t4, ptr %ps5
+  br label %latch
+
+latch:
+  %i.n = add nsw i64 %i, 1
+  br label %h
+
+e:
+  ret void
+}
+; d[i] = 5 * a[i] reads a[i] before the recurrence a[i] = (a[i - 1] ^ i) + 7 overwrites it
+define void @read_first() {
+entry:
+  br label %h
+
+h:
+  %i = phi i64 [ 2, %entry ], [ %i.n, %latch ]
+  %c = icmp slt i64 %i, 1998
+  br i1 %c, label %b, label %e
+
+b:
+  %ix6 = add nsw i64 %i, 0
+  %pl6 = getelementptr inbounds [2000 x i64], ptr @a, i64 0, i64 %ix6
+  %v6 = load i64, ptr %pl6
+  %t1 = mul i64 %v6, 5
+  %ix7 = add nsw i64 %i, 0
+  %ps7 = getelementptr inbounds [2000 x i64], ptr @d, i64 0, i64 %ix7
+  store i64 %t1, ptr %ps7
+  %ix8 = add nsw i64 %i, -1
+  %pl8 = getelementptr inbounds [2000 x i64], ptr @a, i64 0, i64 %ix8
+  %v8 = load i64, ptr %pl8
+  %t2 = xor i64 %v8, %i
+  %t3 = add i64 %t2, 7
+  %ix9 = add nsw i64 %i, 0
+  %ps9 = getelementptr inbounds [2000 x i64], ptr @a, i64 0, i64 %ix9
+  store i64 %t3, ptr %ps9
+  br label %latch
+
+latch:
+  %i.n = add nsw i64 %i, 1
+  br label %h
+
+e:
+  ret void
+}
+; e[i] = f[i - 1] + 1 and f[i] = 2 * e[i] depend on each other: one recurrence
+define void @cycle() {
+entry:
+  br label %h
+
+h:
+  %i = phi i64 [ 2, %entry ], [ %i.n, %latch ]
+  %c = icmp slt i64 %i, 1998
+  br i1 %c, label %b, label %e
+
+b:
+  %ix10 = add nsw i64 %i, -1
+  %pl10 = getelementptr inbounds [2000 x i64], ptr @f, i64 0, i64 %ix10
+  %v10 = load i64, ptr %pl10
+  %t1 = add i64 %v10, 1
+  %ix11 = add nsw i64 %i, 0
+  %ps11 = getelementptr inbounds [2000 x i64], ptr @e, i64 0, i64 %ix11
+  store i64 %t1, ptr %ps11
+  %ix12 = add nsw i64 %i, 0
+  %pl12 = getelementptr inbounds [2000 x i64], ptr @e, i64 0, i64 %ix12
+  %v12 = load i64, ptr %pl12
+  %t2 = mul i64 %v12, 2
+  %ix13 = add nsw i64 %i, 0
+  %ps13 = getelementptr inbounds [2000 x i64], ptr @f, i64 0, i64 %ix13
+  store i64 %t2, ptr %ps13
+  br label %latch
+
+latch:
+  %i.n = add nsw i64 %i, 1
+  br label %h
+
+e:
+  ret void
+}
+; g[i] = b[i] + 1 and h[i] = 3 * g[i + 1] carry no dependence of their own, but h reads g one iteration ahead
+define void @no_fusion() {
+entry:
+  br label %h
+
+h:
+  %i = phi i64 [ 2, %entry ], [ %i.n, %latch ]
+  %c = icmp slt i64 %i, 1998
+  br i1 %c, label %b, label %e
+
+b:
+  %ix14 = add nsw i64 %i, 0
+  %pl14 = getelementptr inbounds [2000 x i64], ptr @b, i64 0, i64 %ix14
+  %v14 = load i64, ptr %pl14
+  %t1 = add i64 %v14, 1
+  %ix15 = add nsw i64 %i, 0
+  %ps15 = getelementptr inbounds [2000 x i64], ptr @g, i64 0, i64 %ix15
+  store i64 %t1, ptr %ps15
+  %ix16 = add nsw i64 %i, 1
+  %pl16 = getelementptr inbounds [2000 x i64], ptr @g, i64 0, i64 %ix16
+  %v16 = load i64, ptr %pl16
+  %t2 = mul i64 %v16, 3
+  %ix17 = add nsw i64 %i, 0
+  %ps17 = getelementptr inbounds [2000 x i64], ptr @h, i64 0, i64 %ix17
+  store i64 %t2, ptr %ps17
+  br label %latch
+
+latch:
+  %i.n = add nsw i64 %i, 1
+  br label %h
+
+e:
+  ret void
+}
+; p[i] = 3 * b[i] on odd b[i], and q[i] = q[i - 2] + b[i]
+define void @conditional() {
+entry:
+  br label %h
+
+h:
+  %i = phi i64 [ 2, %entry ], [ %i.n, %latch ]
+  %c = icmp slt i64 %i, 1998
+  br i1 %c, label %b, label %e
+
+b:
+  %ix18 = add nsw i64 %i, 0
+  %pl18 = getelementptr inbounds [2000 x i64], ptr @b, i64 0, i64 %ix18
+  %v18 = load i64, ptr %pl18
+  %odd = and i64 %v18, 1
+  %isodd = icmp ne i64 %odd, 0
+  br i1 %isodd, label %then, label %join
+
+then:
+  %t5 = mul i64 %v18, 3
+  %ix22 = add nsw i64 %i, 0
+  %ps22 = getelementptr inbounds [2000 x i64], ptr @p, i64 0, i64 %ix22
+  store i64 %t5, ptr %ps22
+  br label %join
+
+join:
+  %ix20 = add nsw i64 %i, -2
+  %pl20 = getelementptr inbounds [2000 x i64], ptr @q, i64 0, i64 %ix20
+  %v20 = load i64, ptr %pl20
+  %ix21 = add nsw i64 %i, 0
+  %pl21 = getelementptr inbounds [2000 x i64], ptr @b, i64 0, i64 %ix21
+  %v21 = load i64, ptr %pl21
+  %t6 = add i64 %v20, %v21
+  %ix23 = add nsw i64 %i, 0
+  %ps23 = getelementptr inbounds [2000 x i64], ptr @q, i64 0, i64 %ix23
+  store i64 %t6, ptr %ps23
+  br label %latch
+
+latch:
+  %i.n = add nsw i64 %i, 1
+  br label %h
+
+e:
+  ret void
+}
+; the recurrence r[i] = r[i - 1] + b[i], then c[i] += 1 and d[i] = 2 * r[i]
+define void @fusion() {
+entry:
+  br label %h
+
+h:
+  %i = phi i64 [ 2, %entry ], [ %i.n, %latch ]
+  %c = icmp slt i64 %i, 1998
+  br i1 %c, label %b, label %e
+
+b:
+  %ix24 = add nsw i64 %i, -1
+  %pl24 = getelementptr inbounds [2000 x i64], ptr @r, i64 0, i64 %ix24
+  %v24 = load i64, ptr %pl24
+  %ix25 = add nsw i64 %i, 0
+  %pl25 = getelementptr inbounds [2000 x i64], ptr @b, i64 0, i64 %ix25
+  %v25 = load i64, ptr %pl25
+  %t1 = add i64 %v24, %v25
+  %ix26 = add nsw i64 %i, 0
+  %ps26 = getelementptr inbounds [2000 x i64], ptr @r, i64 0, i64 %ix26
+  store i64 %t1, ptr %ps26
+  %ix27 = add nsw i64 %i, 0
+  %pl27 = getelementptr inbounds [2000 x i64], ptr @c, i64 0, i64 %ix27
+  %v27 = load i64, ptr %pl27
+  %t2 = add i64 %v27, 1
+  %ix28 = add nsw i64 %i, 0
+  %ps28 = getelementptr inbounds [2000 x i64], ptr @c, i64 0, i64 %ix28
+  store i64 %t2, ptr %ps28
+  %ix29 = add nsw i64 %i, 0
+  %pl29 = getelementptr inbounds [2000 x i64], ptr @r, i64 0, i64 %ix29
+  %v29 = load i64, ptr %pl29
+  %t3 = mul i64 %v29, 2
+  %ix30 = add nsw i64 %i, 0
+  %ps30 = getelementptr inbounds [2000 x i64], ptr @d, i64 0, i64 %ix30
+  store i64 %t3, ptr %ps30
+  br label %latch
+
+latch:
+  %i.n = add nsw i64 %i, 1
+  br label %h
+
+e:
+  ret void
+}
+
+; s[i] = t[i], then s[i] = 5, and t[i + 1] = u[i]
+define void @overwrite() {
+entry:
+  br label %h
+
+h:
+  %i = phi i64 [ 2, %entry ], [ %i.n, %latch ]
+  %c = icmp slt i64 %i, 1998
+  br i1 %c, label %b, label %e
+
+b:
+  %ix31 = add nsw i64 %i, 0
+  %pl31 = getelementptr inbounds [2000 x i64], ptr @t, i64 0, i64 %ix31
+  %v31 = load i64, ptr %pl31
+  %ps31 = getelementptr inbounds [2000 x i64], ptr @s, i64 0, i64 %ix31
+  store i64 %v31, ptr %ps31
+  %ix32 = add nsw i64 %i, 0
+  %ps32 = getelementptr inbounds [2000 x i64], ptr @s, i64 0, i64 %ix32
+  store i64 5, ptr %ps32
+  %ix33 = add nsw i64 %i, 0
+  %pl33 = getelementptr inbounds [2000 x i64], ptr @u, i64 0, i64 %ix33
+  %v33 = load i64, ptr %pl33
+  %ix34 = add nsw i64 %i, 1
+  %ps34 = getelementptr inbounds [2000 x i64], ptr @t, i64 0, i64 %ix34
+  store i64 %v33, ptr %ps34
+  br label %latch
+
+latch:
+  %i.n = add nsw i64 %i, 1
+  br label %h
+
+e:
+  ret void
+}
+
+define i64 @sum(ptr %p, i64 %n) {
+entry:
+  br label %h
+
+h:
+  %x = phi i64 [ 0, %entry ], [ %x.n, %b ]
+  %s = phi i64 [ 0, %entry ], [ %s.n, %b ]
+  %c = icmp slt i64 %x, %n
+  br i1 %c, label %b, label %e
+
+b:
+  %q = getelementptr inbounds i64, ptr %p, i64 %x
+  %w = load i64, ptr %q
+  %m = mul i64 %w, %x
+  %s.n = add i64 %s, %m
+  %x.n = add i64 %x, 1
+  br label %h
+
+e:
+  ret i64 %s
+}
+
+define i32 @main() {
+entry:
+  br label %ih
+
+ih:
+  %k = phi i64 [ 0, %entry ], [ %k.n, %ib ]
+  %kc = icmp slt i64 %k, 2000
+  br i1 %kc, label %ib, label %run
+
+ib:
+  %kk = mul i64 %k, 2654435761
+  %k2 = lshr i64 %kk, 9
+  %pa = getelementptr inbounds [2000 x i64], ptr @a, i64 0, i64 %k
+  %va = add i64 %k2, 0
+  store i64 %va, ptr %pa
+  %pb = getelementptr inbounds [2000 x i64], ptr @b, i64 0, i64 %k
+  %vb = add i64 %k2, 1
+  store i64 %vb, ptr %pb
+  %pc = getelementptr inbounds [2000 x i64], ptr @c, i64 0, i64 %k
+  %vc = add i64 %k2, 2
+  store i64 %vc, ptr %pc
+  %pd = getelementptr inbounds [2000 x i64], ptr @d, i64 0, i64 %k
+  %vd = add i64 %k2, 3
+  store i64 %vd, ptr %pd
+  %pe = getelementptr inbounds [2000 x i64], ptr @e, i64 0, i64 %k
+  %ve = add i64 %k2, 4
+  store i64 %ve, ptr %pe
+  %pf = getelementptr inbounds [2000 x i64], ptr @f, i64 0, i64 %k
+  %vf = add i64 %k2, 5
+  store i64 %vf, ptr %pf
+  %pg = getelementptr inbounds [2000 x i64], ptr @g, i64 0, i64 %k
+  %vg = add i64 %k2, 6
+  store i64 %vg, ptr %pg
+  %ph = getelementptr inbounds [2000 x i64], ptr @h, i64 0, i64 %k
+  %vh = add i64 %k2, 7
+  store i64 %vh, ptr %ph
+  %pp = getelementptr inbounds [2000 x i64], ptr @p, i64 0, i64 %k
+  %vp = add i64 %k2, 8
+  store i64 %vp, ptr %pp
+  %pq = getelementptr inbounds [2000 x i64], ptr @q, i64 0, i64 %k
+  %vq = add i64 %k2, 9
+  store i64 %vq, ptr %pq
+  %pr = getelementptr inbounds [2000 x i64], ptr @r, i64 0, i64 %k
+  %vr = add i64 %k2, 10
+  store i64 %vr, ptr %pr
+  %pu = getelementptr inbounds [2000 x i64], ptr @u, i64 0, i64 %k
+  %vu = add i64 %k2, 11
+  store i64 %vu, ptr %pu
+  %k.n = add i64 %k, 1
+  br label %ih
+
+run:
+  call void @split()
+  call void @read_first()
+  call void @cycle()
+  call void @no_fusion()
+  call void @conditional()
+  call void @fusion()
+  call void @overwrite()
+  %sa = call i64 @sum(ptr @a, i64 2000)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %sa)
+  %sb = call i64 @sum(ptr @b, i64 2000)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %sb)
+  %sc = call i64 @sum(ptr @c, i64 2000)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %sc)
+  %sd = call i64 @sum(ptr @d, i64 2000)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %sd)
+  %se = call i64 @sum(ptr @e, i64 2000)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %se)
+  %sf = call i64 @sum(ptr @f, i64 2000)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %sf)
+  %sg = call i64 @sum(ptr @g, i64 2000)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %sg)
+  %sh = call i64 @sum(ptr @h, i64 2000)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %sh)
+  %sp = call i64 @sum(ptr @p, i64 2000)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %sp)
+  %sq = call i64 @sum(ptr @q, i64 2000)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %sq)
+  %sr = call i64 @sum(ptr @r, i64 2000)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %sr)
+  %ss = call i64 @sum(ptr @s, i64 2000)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %ss)
+  %st = call i64 @sum(ptr @t, i64 2000)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %st)
+  ret i32 0
+}
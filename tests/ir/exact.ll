@@ -0,0 +1,64 @@
+; RUN: %opt -disable-output -passes='loop(loop-parallelization)' -loop-parallelization-dump %s 2>&1 | %FileCheck %s
+; RUN: %opt -disable-output -passes='loop(loop-parallelization)' -pass-remarks-analysis=loop-parallelization %s 2>&1 | %FileCheck %s --check-prefix=REMARK
+; RUN: %opt -disable-output -passes='loop(loop-parallelization)' -loop-parallelization-dump -pass-remarks-analysis=loop-parallelization -loop-parallelization-exact-budget=0 %s 2>&1 | %FileCheck %s --check-prefix=OFF
+;
+; The store to a[-1282 * i - 1701 * j + 10000] and the load of a[2864 * i - 143 * j + 8600] never meet in two
+; iterations of the inner loop, but the subscripts have no common divisor and their ranges overlap, so only the exact
+; test, which enumerates the 4 x 4 iterations, proves it. The Omega test runs out of its default budget on the large
+; coefficients. A budget of 0 turns the exact test off.
+
+; CHECK: Analysing loop: loc
+; CHECK: Load in: @a
+; CHECK-NEXT: Array index access: 8600 + var_0[ 0, 3 ] * 2864 + var_1[ 0, 3 ] * -143
+; CHECK: Store in: @a
+; CHECK-NEXT: Array index access: 10000 + var_0[ 0, 3 ] * -1282 + var_1[ 0, 3 ] * -1701
+; CHECK-NEXT: Loop is safe to be parallelized
+
+; REMARK: remark: <unknown>:0:0: accesses store and load to a are independent by the Exact test
+
+; OFF-NOT: remark: {{.*}} independent
+; OFF: Analysing loop: loc
+; OFF: Loop is not safe to be parallelized
+
+@a = global [20000 x i64] zeroinitializer
+
+define void @kernel() {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %outer.cond = icmp slt i64 %i, 4
+  br i1 %outer.cond, label %outer.body, label %exit
+
+outer.body:
+  br label %inner.header
+
+inner.header:
+  %j = phi i64 [ 0, %outer.body ], [ %j.next, %inner.body ]
+  %inner.cond = icmp slt i64 %j, 4
+  br i1 %inner.cond, label %inner.body, label %outer.latch
+
+inner.body:
+  %ri = mul nsw i64 %i, 2864
+  %rj = mul nsw i64 %j, -143
+  %rij = add nsw i64 %ri, %rj
+  %r = add nsw i64 %rij, 8600
+  %pr = getelementptr inbounds [20000 x i64], ptr @a, i64 0, i64 %r
+  %v = load i64, ptr %pr
+  %wi = mul nsw i64 %i, -1282
+  %wj = mul nsw i64 %j, -1701
+  %wij = add nsw i64 %wi, %wj
+  %w = add nsw i64 %wij, 10000
+  %pw = getelementptr inbounds [20000 x i64], ptr @a, i64 0, i64 %w
+  store i64 %v, ptr %pw
+  %j.next = add nsw i64 %j, 1
+  br label %inner.header
+
+outer.latch:
+  %i.next = add nsw i64 %i, 1
+  br label %outer.header
+
+exit:
+  ret void
+}
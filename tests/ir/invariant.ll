@@ -0,0 +1,87 @@
+; RUN: %opt -disable-output -passes='loop(loop-parallelization)' -loop-parallelization-dump %s 2>&1 | %FileCheck %s
+;
+; A load and a store with the same subscripts only meet within one iteration if some subscript moves with the
+; induction variable. The read-modify-writes of a[i] are parallel; those of a[0], and of a[idx[i]], whose subscript is
+; not understood, may touch the same element in every iteration.
+
+; CHECK-LABEL: Analysing loop:
+; CHECK: Loop is safe to be parallelized
+; CHECK-LABEL: Analysing loop:
+; CHECK: Loop is not safe to be parallelized
+; CHECK-LABEL: Analysing loop:
+; CHECK: Loop is not safe to be parallelized
+
+@a = global [1000 x i64] zeroinitializer
+@b = global [1000 x i64] zeroinitializer
+@idx = global [1000 x i64] zeroinitializer
+
+; a[i] += b[i]
+define void @add() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 1000
+  br i1 %cond, label %body, label %exit
+
+body:
+  %pb = getelementptr inbounds [1000 x i64], ptr @b, i64 0, i64 %i
+  %vb = load i64, ptr %pb
+  %pa = getelementptr inbounds [1000 x i64], ptr @a, i64 0, i64 %i
+  %va = load i64, ptr %pa
+  %add = add nsw i64 %va, %vb
+  store i64 %add, ptr %pa
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+; a[0] = b[i] - a[0]
+define void @alternate() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 1000
+  br i1 %cond, label %body, label %exit
+
+body:
+  %pb = getelementptr inbounds [1000 x i64], ptr @b, i64 0, i64 %i
+  %vb = load i64, ptr %pb
+  %va = load i64, ptr @a
+  %sub = sub nsw i64 %vb, %va
+  store i64 %sub, ptr @a
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+; a[idx[i]] += 1
+define void @histogram() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 1000
+  br i1 %cond, label %body, label %exit
+
+body:
+  %pidx = getelementptr inbounds [1000 x i64], ptr @idx, i64 0, i64 %i
+  %j = load i64, ptr %pidx
+  %pa = getelementptr inbounds [1000 x i64], ptr @a, i64 0, i64 %j
+  %va = load i64, ptr %pa
+  %add = add nsw i64 %va, 1
+  store i64 %add, ptr %pa
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
@@ -0,0 +1,166 @@
+; RUN: %opt -S -passes='loop(loop-parallelization-metadata)' %s | %FileCheck %s
+; RUN: %opt -S -passes='loop(loop-parallelization-metadata<vectorize>)' %s | %FileCheck %s --check-prefix=VECTORIZE
+;
+; The annotation mode puts the accesses of every parallel loop in an access group that llvm.loop.parallel_accesses
+; names, and leaves the recurrence, the loop whose iterations all store to a[0] and the loop calling a function that
+; reads what the previous iteration stored alone.
+
+; CHECK-LABEL: define void @scale()
+; CHECK: load i64, ptr %pb, {{.*}}!llvm.access.group ![[SCALE_GROUP:[0-9]+]]
+; CHECK: store i64 %add, ptr %pa, {{.*}}!llvm.access.group ![[SCALE_GROUP]]
+; CHECK: br label %header, !llvm.loop ![[SCALE_LOOP:[0-9]+]]
+; CHECK-LABEL: define i64 @sum()
+; CHECK: load i64, ptr %pa, {{.*}}!llvm.access.group ![[SUM_GROUP:[0-9]+]]
+; CHECK: br label %header, !llvm.loop ![[SUM_LOOP:[0-9]+]]
+; CHECK-LABEL: define void @prefix()
+; CHECK-NOT: !llvm.access.group
+; CHECK-NOT: !llvm.loop
+; CHECK-LABEL: define void @last()
+; CHECK-NOT: !llvm.access.group
+; CHECK-NOT: !llvm.loop
+; CHECK-LABEL: define void @running()
+; CHECK-NOT: !llvm.access.group
+; CHECK-NOT: !llvm.loop
+; CHECK-DAG: ![[SCALE_LOOP]] = distinct !{![[SCALE_LOOP]], ![[SCALE_PARALLEL:[0-9]+]]}
+; CHECK-DAG: ![[SCALE_PARALLEL]] = !{!"llvm.loop.parallel_accesses", ![[SCALE_GROUP]]}
+; CHECK-DAG: ![[SUM_LOOP]] = distinct !{![[SUM_LOOP]], ![[SUM_PARALLEL:[0-9]+]]}
+; CHECK-DAG: ![[SUM_PARALLEL]] = !{!"llvm.loop.parallel_accesses", ![[SUM_GROUP]]}
+
+; VECTORIZE-LABEL: define void @scale()
+; VECTORIZE: br label %header, !llvm.loop ![[LOOP:[0-9]+]]
+; VECTORIZE: ![[LOOP]] = distinct !{![[LOOP]], !{{[0-9]+}}, ![[ENABLE:[0-9]+]]}
+; VECTORIZE: ![[ENABLE]] = !{!"llvm.loop.vectorize.enable", i1 true}
+
+@a = global [1000 x i64] zeroinitializer
+@b = global [1000 x i64] zeroinitializer
+
+; a[i] = 3 * b[i] + i
+define void @scale() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 1000
+  br i1 %cond, label %body, label %exit
+
+body:
+  %pb = getelementptr inbounds [1000 x i64], ptr @b, i64 0, i64 %i
+  %vb = load i64, ptr %pb
+  %mul = mul nsw i64 %vb, 3
+  %add = add nsw i64 %mul, %i
+  %pa = getelementptr inbounds [1000 x i64], ptr @a, i64 0, i64 %i
+  store i64 %add, ptr %pa
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+; s += a[i] * i
+define i64 @sum() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %s = phi i64 [ 0, %entry ], [ %s.next, %body ]
+  %cond = icmp slt i64 %i, 1000
+  br i1 %cond, label %body, label %exit
+
+body:
+  %pa = getelementptr inbounds [1000 x i64], ptr @a, i64 0, i64 %i
+  %va = load i64, ptr %pa
+  %mul = mul nsw i64 %va, %i
+  %s.next = add nsw i64 %s, %mul
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret i64 %s
+}
+
+; b[i] = b[i - 1] + a[i]
+define void @prefix() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 1, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 1000
+  br i1 %cond, label %body, label %exit
+
+body:
+  %im1 = add nsw i64 %i, -1
+  %pp = getelementptr inbounds [1000 x i64], ptr @b, i64 0, i64 %im1
+  %vp = load i64, ptr %pp
+  %pa = getelementptr inbounds [1000 x i64], ptr @a, i64 0, i64 %i
+  %va = load i64, ptr %pa
+  %add = add nsw i64 %vp, %va
+  %pb = getelementptr inbounds [1000 x i64], ptr @b, i64 0, i64 %i
+  store i64 %add, ptr %pb
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+; a[0] = i: the last iteration has to write last.
+define void @last() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 1000
+  br i1 %cond, label %body, label %exit
+
+body:
+  store i64 %i, ptr @a
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+; b[i - 1], or 0 for i = 0
+define i64 @previous(i64 %i) memory(read) nounwind willreturn {
+entry:
+  %first = icmp eq i64 %i, 0
+  br i1 %first, label %exit, label %load
+
+load:
+  %im1 = add nsw i64 %i, -1
+  %pb = getelementptr inbounds [1000 x i64], ptr @b, i64 0, i64 %im1
+  %vb = load i64, ptr %pb
+  br label %exit
+
+exit:
+  %v = phi i64 [ 0, %entry ], [ %vb, %load ]
+  ret i64 %v
+}
+
+; b[i] = previous(i) + 1: the call only reads memory, but what it reads is stored by the previous iteration.
+define void @running() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 1000
+  br i1 %cond, label %body, label %exit
+
+body:
+  %vp = call i64 @previous(i64 %i)
+  %add = add nsw i64 %vp, 1
+  %pb = getelementptr inbounds [1000 x i64], ptr @b, i64 0, i64 %i
+  store i64 %add, ptr %pb
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
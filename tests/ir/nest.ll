@@ -0,0 +1,232 @@
+; RUN: %opt -disable-output -passes=loop-parallelization-openmp -loop-parallelization-dump %s 2>&1 | %FileCheck %s --check-prefix=PLAN
+; RUN: %opt -S -passes=loop-parallelization-openmp %s | %FileCheck %s
+; RUN: %lli %s | %FileCheck %s --check-prefix=OUT
+; RUN: %opt -passes=loop-parallelization-openmp %s -o %t.bc
+; RUN: %lli %t.bc | %FileCheck %s --check-prefix=OUT
+;
+; Perfect nests run as one parallel region: the rows of @rows, whose inner loop is a recurrence, are split across the
+; team; the columns of @columns, which only the outer loop carries a dependence across, are interchanged outward; and
+; the three rows of @grid are collapsed with its columns so that every thread gets some of the 300 iterations.
+
+; PLAN: Parallelizing loop: loc
+; PLAN-NEXT: Parallelizing loop nest: loc on var_1
+; PLAN-NEXT: Parallelizing loop nest: loc on var_0..var_1
+
+; CHECK-LABEL: define void @unsimplified()
+; CHECK-NOT: __kmpc_fork_call
+; CHECK-LABEL: define i32 @main()
+; CHECK-LABEL: define internal void @rows.omp_outlined(
+; CHECK: omp.loop.body:
+; CHECK: %i = add i64 %omp.start,
+; CHECK: inner.header.omp:
+; CHECK-NEXT: %j.omp = phi i64 [ 1, %outer.body.omp ], [ %j.next.omp, %inner.body.omp ]
+; CHECK-LABEL: define internal void @columns.omp_outlined(
+; CHECK: outer.header.omp:
+; CHECK-NEXT: %i.omp = phi i64 [ 1, %omp.entry ], [ %i.next.omp, %outer.latch.omp ]
+; CHECK: inner.header.omp:
+; CHECK-NEXT: %omp.iv = phi i64 [ %omp.chunk.begin, %outer.body.omp ], [ %omp.iv.next, %inner.body.omp ]
+; CHECK: br i1 %omp.in_chunk, label %inner.body.omp, label %outer.latch.omp
+; CHECK-LABEL: define internal void @grid.omp_outlined(
+; CHECK: %omp.digit = urem i64 %omp.chunk.begin,
+; CHECK: %omp.digit{{[0-9]+}} = urem i64
+
+; OUT: 115827941047500 4391497593821250 14850
+
+@a = global [100 x [100 x i64]] zeroinitializer
+@b = global [100 x [100 x i64]] zeroinitializer
+@c = global [100 x [100 x i64]] zeroinitializer
+@fmt = private constant [13 x i8] c"%ld %ld %ld\0A\00"
+
+declare i32 @printf(ptr, ...)
+
+; a[i][j] = a[i][j - 1] + b[i][j]
+define void @rows() {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %outer.cond = icmp slt i64 %i, 100
+  br i1 %outer.cond, label %outer.body, label %exit
+
+outer.body:
+  br label %inner.header
+
+inner.header:
+  %j = phi i64 [ 1, %outer.body ], [ %j.next, %inner.body ]
+  %inner.cond = icmp slt i64 %j, 100
+  br i1 %inner.cond, label %inner.body, label %outer.latch
+
+inner.body:
+  %jm1 = add nsw i64 %j, -1
+  %pl = getelementptr inbounds [100 x [100 x i64]], ptr @a, i64 0, i64 %i, i64 %jm1
+  %vl = load i64, ptr %pl
+  %pb = getelementptr inbounds [100 x [100 x i64]], ptr @b, i64 0, i64 %i, i64 %j
+  %vb = load i64, ptr %pb
+  %add = add nsw i64 %vl, %vb
+  %ps = getelementptr inbounds [100 x [100 x i64]], ptr @a, i64 0, i64 %i, i64 %j
+  store i64 %add, ptr %ps
+  %j.next = add nsw i64 %j, 1
+  br label %inner.header
+
+outer.latch:
+  %i.next = add nsw i64 %i, 1
+  br label %outer.header
+
+exit:
+  ret void
+}
+
+; b[i][j] = b[i - 1][j] + a[i][j]
+define void @columns() {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 1, %entry ], [ %i.next, %outer.latch ]
+  %outer.cond = icmp slt i64 %i, 100
+  br i1 %outer.cond, label %outer.body, label %exit
+
+outer.body:
+  br label %inner.header
+
+inner.header:
+  %j = phi i64 [ 0, %outer.body ], [ %j.next, %inner.body ]
+  %inner.cond = icmp slt i64 %j, 100
+  br i1 %inner.cond, label %inner.body, label %outer.latch
+
+inner.body:
+  %im1 = add nsw i64 %i, -1
+  %pl = getelementptr inbounds [100 x [100 x i64]], ptr @b, i64 0, i64 %im1, i64 %j
+  %vl = load i64, ptr %pl
+  %pa = getelementptr inbounds [100 x [100 x i64]], ptr @a, i64 0, i64 %i, i64 %j
+  %va = load i64, ptr %pa
+  %add = add nsw i64 %vl, %va
+  %ps = getelementptr inbounds [100 x [100 x i64]], ptr @b, i64 0, i64 %i, i64 %j
+  store i64 %add, ptr %ps
+  %j.next = add nsw i64 %j, 1
+  br label %inner.header
+
+outer.latch:
+  %i.next = add nsw i64 %i, 1
+  br label %outer.header
+
+exit:
+  ret void
+}
+
+; c[i][j] = i * j, over three rows only
+define void @grid() {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %outer.cond = icmp slt i64 %i, 3
+  br i1 %outer.cond, label %outer.body, label %exit
+
+outer.body:
+  br label %inner.header
+
+inner.header:
+  %j = phi i64 [ 0, %outer.body ], [ %j.next, %inner.body ]
+  %inner.cond = icmp slt i64 %j, 100
+  br i1 %inner.cond, label %inner.body, label %outer.latch
+
+inner.body:
+  %mul = mul nsw i64 %i, %j
+  %ps = getelementptr inbounds [100 x [100 x i64]], ptr @c, i64 0, i64 %i, i64 %j
+  store i64 %mul, ptr %ps
+  %j.next = add nsw i64 %j, 1
+  br label %inner.header
+
+outer.latch:
+  %i.next = add nsw i64 %i, 1
+  br label %outer.header
+
+exit:
+  ret void
+}
+
+; The same nest as @grid, but its inner loop is entered straight from the outer header, as before loop-simplify: it is
+; left alone.
+define void @unsimplified() {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %outer.cond = icmp slt i64 %i, 3
+  br i1 %outer.cond, label %inner.header, label %exit
+
+inner.header:
+  %j = phi i64 [ 0, %outer.header ], [ %j.next, %inner.body ]
+  %inner.cond = icmp slt i64 %j, 100
+  br i1 %inner.cond, label %inner.body, label %outer.latch
+
+inner.body:
+  %mul = mul nsw i64 %i, %j
+  %ps = getelementptr inbounds [100 x [100 x i64]], ptr @c, i64 0, i64 %i, i64 %j
+  store i64 %mul, ptr %ps
+  %j.next = add nsw i64 %j, 1
+  br label %inner.header
+
+outer.latch:
+  %i.next = add nsw i64 %i, 1
+  br label %outer.header
+
+exit:
+  ret void
+}
+
+define i32 @main() {
+entry:
+  br label %init.header
+
+init.header:
+  %k = phi i64 [ 0, %entry ], [ %k.next, %init.body ]
+  %init.cond = icmp slt i64 %k, 10000
+  br i1 %init.cond, label %init.body, label %run
+
+init.body:
+  %pb = getelementptr inbounds i64, ptr @b, i64 %k
+  %k7 = mul nsw i64 %k, 7
+  store i64 %k7, ptr %pb
+  %pa = getelementptr inbounds i64, ptr @a, i64 %k
+  store i64 %k, ptr %pa
+  %k.next = add nsw i64 %k, 1
+  br label %init.header
+
+run:
+  call void @rows()
+  call void @columns()
+  call void @grid()
+  br label %sum.header
+
+sum.header:
+  %q = phi i64 [ 0, %run ], [ %q.next, %sum.body ]
+  %s1 = phi i64 [ 0, %run ], [ %s1.next, %sum.body ]
+  %s2 = phi i64 [ 0, %run ], [ %s2.next, %sum.body ]
+  %s3 = phi i64 [ 0, %run ], [ %s3.next, %sum.body ]
+  %sum.cond = icmp slt i64 %q, 10000
+  br i1 %sum.cond, label %sum.body, label %done
+
+sum.body:
+  %sa = getelementptr inbounds i64, ptr @a, i64 %q
+  %va = load i64, ptr %sa
+  %ma = mul nsw i64 %va, %q
+  %s1.next = add nsw i64 %s1, %ma
+  %sb = getelementptr inbounds i64, ptr @b, i64 %q
+  %vb = load i64, ptr %sb
+  %mb = mul nsw i64 %vb, %q
+  %s2.next = add nsw i64 %s2, %mb
+  %sc = getelementptr inbounds i64, ptr @c, i64 %q
+  %vc = load i64, ptr %sc
+  %s3.next = add nsw i64 %s3, %vc
+  %q.next = add nsw i64 %q, 1
+  br label %sum.header
+
+done:
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s1, i64 %s2, i64 %s3)
+  ret i32 0
+}
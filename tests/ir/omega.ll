@@ -0,0 +1,64 @@
+; RUN: %opt -disable-output -passes='loop(loop-parallelization)' -loop-parallelization-dump %s 2>&1 | %FileCheck %s
+; RUN: %opt -disable-output -passes='loop(loop-parallelization)' -pass-remarks-analysis=loop-parallelization %s 2>&1 | %FileCheck %s --check-prefix=OMEGA
+; RUN: %opt -disable-output -passes='loop(loop-parallelization)' -pass-remarks-analysis=loop-parallelization -loop-parallelization-omega-budget=0 %s 2>&1 | %FileCheck %s --check-prefix=EXACT
+; RUN: %opt -disable-output -passes='loop(loop-parallelization)' -loop-parallelization-dump -pass-remarks-analysis=loop-parallelization -loop-parallelization-omega-budget=0 -loop-parallelization-exact-budget=0 %s 2>&1 | %FileCheck %s --check-prefix=OFF
+;
+; In an iteration of the outer loop, a[i + j][j] and a[i][j + 1] only meet if j == 0 in the first dimension and
+; j == j' + 1 in the second, which no iteration j' >= 0 satisfies. Each dimension on its own has a solution, so only
+; the Omega test, which solves the subscripts of both dimensions together, proves the inner loop parallel. With a budget
+; of 0 the Omega test is off and the exact test proves it instead, and with both off the loop stays serial.
+
+; CHECK: Analysing loop: loc
+; CHECK: Load in: @a
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 99 ] * 1 + var_1[ 0, 99 ] * 0
+; CHECK-NEXT: Array index access: 1 + var_0[ 0, 99 ] * 0 + var_1[ 0, 99 ] * 1
+; CHECK-NEXT: Store in: @a
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 99 ] * 1 + var_1[ 0, 99 ] * 1
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 99 ] * 0 + var_1[ 0, 99 ] * 1
+; CHECK-NEXT: Loop is safe to be parallelized
+
+; OMEGA: remark: <unknown>:0:0: accesses store and load to a are independent by the Omega test
+
+; EXACT: remark: <unknown>:0:0: accesses store and load to a are independent by the Exact test
+
+; OFF-NOT: remark: {{.*}} independent
+; OFF: Analysing loop: loc
+; OFF: Loop is not safe to be parallelized
+
+@a = global [200 x [101 x i64]] zeroinitializer
+
+define void @coupled() {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %outer.cond = icmp slt i64 %i, 100
+  br i1 %outer.cond, label %outer.body, label %exit
+
+outer.body:
+  br label %inner.header
+
+inner.header:
+  %j = phi i64 [ 0, %outer.body ], [ %j.next, %inner.body ]
+  %inner.cond = icmp slt i64 %j, 100
+  br i1 %inner.cond, label %inner.body, label %outer.latch
+
+inner.body:
+  %j1 = add nsw i64 %j, 1
+  %pr = getelementptr inbounds [200 x [101 x i64]], ptr @a, i64 0, i64 %i, i64 %j1
+  %v = load i64, ptr %pr
+  %add = add nsw i64 %v, 1
+  %ij = add nsw i64 %i, %j
+  %pw = getelementptr inbounds [200 x [101 x i64]], ptr @a, i64 0, i64 %ij, i64 %j
+  store i64 %add, ptr %pw
+  %j.next = add nsw i64 %j, 1
+  br label %inner.header
+
+outer.latch:
+  %i.next = add nsw i64 %i, 1
+  br label %outer.header
+
+exit:
+  ret void
+}
@@ -0,0 +1,270 @@
+; RUN: %opt -S -passes=loop-parallelization-openmp %s | %FileCheck %s
+; RUN: %lli %s | %FileCheck %s --check-prefix=OUT
+; RUN: %opt -passes=loop-parallelization-openmp %s -o %t.bc
+; RUN: %lli %t.bc | %FileCheck %s --check-prefix=OUT
+;
+; The OpenMP transform outlines the loops proven parallel, including the reduction, and leaves the recurrence, the
+; loop whose iterations all store to a[0], the loop calling a function that reads what the previous iteration stored
+; and the loop whose atomicrmw writes what the previous iteration read serial. Every loop is scheduled in unsigned 64
+; bits, whatever the type of its induction variable, so that an unsigned 32-bit loop may run for more than 2^31
+; iterations; @fill also runs with no iteration at all. The parallel program prints what the serial one does.
+
+; CHECK-LABEL: define void @scale()
+; CHECK: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @scale.omp_outlined, ptr %omp.context)
+; CHECK-LABEL: define i64 @sum()
+; CHECK: call i32 @omp_get_max_threads()
+; CHECK: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @sum.omp_outlined, ptr %omp.context)
+; CHECK-LABEL: define void @prefix()
+; CHECK-NOT: __kmpc_fork_call
+; CHECK-LABEL: define void @last()
+; CHECK-NOT: __kmpc_fork_call
+; CHECK-LABEL: define void @running()
+; CHECK-NOT: __kmpc_fork_call
+; CHECK-LABEL: define void @bump()
+; CHECK-NOT: __kmpc_fork_call
+; CHECK-LABEL: define void @fill(i32 %n)
+; CHECK: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @fill.omp_outlined, ptr %omp.context)
+; CHECK-LABEL: define i32 @main()
+; CHECK-LABEL: define internal void @scale.omp_outlined(
+; CHECK: call void @__kmpc_for_static_init_8u(
+; CHECK: store i64 %add.omp, ptr %pa.omp
+; CHECK: call void @__kmpc_for_static_fini(
+; CHECK-LABEL: define internal void @sum.omp_outlined(
+; CHECK: call void @__kmpc_for_static_init_8u(
+; CHECK: call void @__kmpc_barrier(
+; CHECK-LABEL: define internal void @fill.omp_outlined(
+; CHECK: %omp.empty = icmp eq i64 %omp.trip_count, 0
+; CHECK: call void @__kmpc_for_static_init_8u(
+; CHECK: %omp.iv = phi i64
+; CHECK: icmp ule i64 %omp.iv, %omp.chunk.end
+; CHECK: trunc i64 %omp.iv to i32
+
+; OUT: 7322337000 10989000 999 1000 999 0 1
+
+@a = global [1000 x i64] zeroinitializer
+@b = global [1000 x i64] zeroinitializer
+@c = global [1000 x i64] zeroinitializer
+@d = global [1000 x i32] zeroinitializer
+@e = global [1000 x i64] zeroinitializer
+@f = global [1000 x i64] zeroinitializer
+@fmt = private constant [29 x i8] c"%ld %ld %ld %ld %ld %ld %ld\0A\00"
+
+declare i32 @printf(ptr, ...)
+
+; a[i] = 3 * b[i] + i
+define void @scale() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 1000
+  br i1 %cond, label %body, label %exit
+
+body:
+  %pb = getelementptr inbounds [1000 x i64], ptr @b, i64 0, i64 %i
+  %vb = load i64, ptr %pb
+  %mul = mul nsw i64 %vb, 3
+  %add = add nsw i64 %mul, %i
+  %pa = getelementptr inbounds [1000 x i64], ptr @a, i64 0, i64 %i
+  store i64 %add, ptr %pa
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+; s += a[i] * i
+define i64 @sum() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %s = phi i64 [ 0, %entry ], [ %s.next, %body ]
+  %cond = icmp slt i64 %i, 1000
+  br i1 %cond, label %body, label %exit
+
+body:
+  %pa = getelementptr inbounds [1000 x i64], ptr @a, i64 0, i64 %i
+  %va = load i64, ptr %pa
+  %mul = mul nsw i64 %va, %i
+  %s.next = add nsw i64 %s, %mul
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret i64 %s
+}
+
+; b[i] = b[i - 1] + a[i]
+define void @prefix() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 1, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 1000
+  br i1 %cond, label %body, label %exit
+
+body:
+  %im1 = add nsw i64 %i, -1
+  %pp = getelementptr inbounds [1000 x i64], ptr @b, i64 0, i64 %im1
+  %vp = load i64, ptr %pp
+  %pa = getelementptr inbounds [1000 x i64], ptr @a, i64 0, i64 %i
+  %va = load i64, ptr %pa
+  %add = add nsw i64 %vp, %va
+  %pb = getelementptr inbounds [1000 x i64], ptr @b, i64 0, i64 %i
+  store i64 %add, ptr %pb
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+; a[0] = i: the last iteration has to write last.
+define void @last() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 1000
+  br i1 %cond, label %body, label %exit
+
+body:
+  store i64 %i, ptr @a
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+; c[i - 1], or 0 for i = 0
+define i64 @previous(i64 %i) memory(read) nounwind willreturn {
+entry:
+  %first = icmp eq i64 %i, 0
+  br i1 %first, label %exit, label %load
+
+load:
+  %im1 = add nsw i64 %i, -1
+  %pc = getelementptr inbounds [1000 x i64], ptr @c, i64 0, i64 %im1
+  %vc = load i64, ptr %pc
+  br label %exit
+
+exit:
+  %v = phi i64 [ 0, %entry ], [ %vc, %load ]
+  ret i64 %v
+}
+
+; c[i] = previous(i) + 1: the call only reads memory, but what it reads is stored by the previous iteration.
+define void @running() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 1000
+  br i1 %cond, label %body, label %exit
+
+body:
+  %vp = call i64 @previous(i64 %i)
+  %add = add nsw i64 %vp, 1
+  %pc = getelementptr inbounds [1000 x i64], ptr @c, i64 0, i64 %i
+  store i64 %add, ptr %pc
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+; f[i] = e[i + 1], then e[i] += 1 atomically: the tests only see the load, but the atomicrmw of the next iteration
+; writes the element it reads.
+define void @bump() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 999
+  br i1 %cond, label %body, label %exit
+
+body:
+  %ip1 = add nsw i64 %i, 1
+  %pn = getelementptr inbounds [1000 x i64], ptr @e, i64 0, i64 %ip1
+  %vn = load i64, ptr %pn
+  %pf = getelementptr inbounds [1000 x i64], ptr @f, i64 0, i64 %i
+  store i64 %vn, ptr %pf
+  %pe = getelementptr inbounds [1000 x i64], ptr @e, i64 0, i64 %i
+  %old = atomicrmw add ptr %pe, i64 1 seq_cst
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+; d[i] = i for unsigned i < n
+define void @fill(i32 %n) {
+entry:
+  br label %header
+
+header:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp ult i32 %i, %n
+  br i1 %cond, label %body, label %exit
+
+body:
+  %pd = getelementptr inbounds [1000 x i32], ptr @d, i32 0, i32 %i
+  store i32 %i, ptr %pd
+  %i.next = add nuw i32 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+define i32 @main() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 1000
+  br i1 %cond, label %body, label %exit
+
+body:
+  %v = mul nsw i64 %i, 7
+  %pb = getelementptr inbounds [1000 x i64], ptr @b, i64 0, i64 %i
+  store i64 %v, ptr %pb
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  call void @scale()
+  %s1 = call i64 @sum()
+  call void @prefix()
+  %pb.last = getelementptr inbounds [1000 x i64], ptr @b, i64 0, i64 999
+  %s2 = load i64, ptr %pb.last
+  call void @last()
+  %s3 = load i64, ptr @a
+  call void @running()
+  %pc.last = getelementptr inbounds [1000 x i64], ptr @c, i64 0, i64 999
+  %s4 = load i64, ptr %pc.last
+  call void @fill(i32 0)
+  call void @fill(i32 1000)
+  %pd.last = getelementptr inbounds [1000 x i32], ptr @d, i64 0, i64 999
+  %vd = load i32, ptr %pd.last
+  %s5 = sext i32 %vd to i64
+  call void @bump()
+  %pf.last = getelementptr inbounds [1000 x i64], ptr @f, i64 0, i64 998
+  %s6 = load i64, ptr %pf.last
+  %pe.last = getelementptr inbounds [1000 x i64], ptr @e, i64 0, i64 998
+  %s7 = load i64, ptr %pe.last
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s1, i64 %s2, i64 %s3, i64 %s4, i64 %s5, i64 %s6, i64 %s7)
+  ret i32 0
+}
@@ -0,0 +1,40 @@
+; RUN: %opt -disable-output -passes='loop(loop-parallelization)' -loop-parallelization-dump %s 2>&1 | %FileCheck %s
+;
+; The subscripts and the tests are computed in 64 bits, with overflow checks. The store of @wide is indexed in i128
+; by 2^32 * 2^32 * i, whose coefficient does not fit in 64 bits: the subscript is unknown instead of a wrapped
+; coefficient, and the loop is serial (the index wraps to the 64 bits of a pointer, so every iteration stores to a[0]).
+
+; CHECK-LABEL: Analysing loop:
+; CHECK-NEXT: Load in: @a
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 99 ] * 1
+; CHECK-NEXT: Store in: @a
+; CHECK-NEXT: Array index access: UnknownExpr
+; CHECK-NEXT: Loop is not safe to be parallelized
+
+@a = global [100 x i64] zeroinitializer
+
+; a[2^64 * i] = a[i] + 1
+define void @wide() {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, 100
+  br i1 %cond, label %body, label %exit
+
+body:
+  %pl = getelementptr inbounds [100 x i64], ptr @a, i64 0, i64 %i
+  %vl = load i64, ptr %pl
+  %add = add nsw i64 %vl, 1
+  %scaled = mul nsw i64 %i, 4294967296
+  %wide = sext i64 %scaled to i128
+  %idx = mul nsw i128 %wide, 4294967296
+  %ps = getelementptr inbounds [100 x i64], ptr @a, i64 0, i128 %idx
+  store i64 %add, ptr %ps
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
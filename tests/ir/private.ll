@@ -0,0 +1,447 @@
+; RUN: %opt -disable-output -passes='loop(loop-parallelization)' -loop-parallelization-dump %s 2>&1 | %FileCheck %s --check-prefix=PRIVATE
+; RUN: %opt -S -passes=loop-parallelization-openmp %s | %FileCheck %s
+; RUN: %lli %s | %FileCheck %s --check-prefix=OUT
+; RUN: %opt -passes=loop-parallelization-openmp %s -o %t.bc
+; RUN: %lli %t.bc | %FileCheck %s --check-prefix=OUT
+;
+; Arrays and scalars kept in an alloca that every iteration writes before it reads them get a copy of their own in each
+; thread. A copy that is read after the loop is initialized from the original and written back by the thread that ran
+; the last iteration. Temporaries that are read before they are written, or written only on some iterations, carry a
+; dependence and keep their loops serial. The scratch row of @row_scratch is indexed by the outer loop, which runs in
+; parallel on the shared array.
+
+; PRIVATE-LABEL: Analysing loop: loc
+; PRIVATE: Private array: t
+; PRIVATE-NEXT: Loop is safe to be parallelized
+; PRIVATE-LABEL: Analysing loop: loc
+; PRIVATE: Private array: t (copied out)
+; PRIVATE-NEXT: Loop is safe to be parallelized
+; PRIVATE-LABEL: Analysing loop: loc
+; PRIVATE-NOT: Private
+; PRIVATE: Loop is not safe to be parallelized
+; PRIVATE-LABEL: Analysing loop: loc
+; PRIVATE-NOT: Private
+; PRIVATE: Loop is not safe to be parallelized
+; PRIVATE-LABEL: Analysing loop nest: loc
+; PRIVATE: Outermost loop safe to be parallelized: var_0
+; PRIVATE-LABEL: Analysing loop: loc
+; PRIVATE: Private scalar: t
+; PRIVATE-NEXT: Loop is safe to be parallelized
+; PRIVATE-LABEL: Analysing loop: loc
+; PRIVATE: Private scalar: t (copied out)
+; PRIVATE-NEXT: Loop is safe to be parallelized
+; PRIVATE-LABEL: Analysing loop: loc
+; PRIVATE-NOT: Private
+; PRIVATE: Loop is not safe to be parallelized
+
+; CHECK-LABEL: define void @scratch()
+; CHECK: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @scratch.omp_outlined,
+; CHECK-LABEL: define i64 @last_value()
+; CHECK: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @last_value.omp_outlined,
+; CHECK-LABEL: define void @carried()
+; CHECK-NOT: __kmpc_fork_call
+; CHECK-LABEL: define i64 @conditional()
+; CHECK-NOT: __kmpc_fork_call
+; CHECK-LABEL: define void @row_scratch()
+; CHECK: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @row_scratch.omp_outlined,
+; CHECK-LABEL: define void @scalar(
+; CHECK: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @scalar.omp_outlined,
+; CHECK-LABEL: define i64 @scalar_last_value()
+; CHECK: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @scalar_last_value.omp_outlined,
+; CHECK-LABEL: define void @scalar_carried()
+; CHECK-NOT: __kmpc_fork_call
+; CHECK-LABEL: define i64 @sum(
+; CHECK-LABEL: define i32 @main()
+
+; CHECK-LABEL: define internal void @scratch.omp_outlined(
+; CHECK: %t.private = alloca [4 x i64]
+; CHECK-NOT: memcpy
+; CHECK: call void @__kmpc_for_static_init_8u(
+; CHECK: %t0.omp = getelementptr inbounds [4 x i64], ptr %t.private, i64 0, i64 0
+; CHECK-NOT: memcpy
+; CHECK: ret void
+
+; CHECK-LABEL: define internal void @last_value.omp_outlined(
+; CHECK: %t = load ptr, ptr
+; CHECK: %t.private = alloca [4 x i64]
+; CHECK-NEXT: call void @llvm.memcpy.p0.p0.i64(ptr align 8 %t.private, ptr align 8 %t, i64 32, i1 false)
+; CHECK-NEXT: %[[T0:.*]] = getelementptr inbounds [4 x i64], ptr %t.private, i64 0, i64 0
+; CHECK-NEXT: call void @__kmpc_barrier(
+; CHECK: store i64 %v.omp, ptr %[[T0]]
+; CHECK: omp.copy_out:
+; CHECK-NEXT: call void @llvm.memcpy.p0.p0.i64(ptr align 8 %t, ptr align 8 %t.private, i64 32, i1 false)
+
+; CHECK-LABEL: define internal void @row_scratch.omp_outlined(
+; CHECK-NOT: %t.private
+; CHECK: %ti.omp = getelementptr inbounds [100 x i64], ptr %t, i64 0, i64 %i
+
+; CHECK-LABEL: define internal void @scalar.omp_outlined(
+; CHECK: %t.private = alloca i64
+; CHECK-NOT: memcpy
+; CHECK: store i64 %v2.omp, ptr %t.private
+; CHECK: %cv.omp = load i64, ptr %c.addr
+
+; CHECK-LABEL: define internal void @scalar_last_value.omp_outlined(
+; CHECK: %t.private = alloca i64
+; CHECK-NEXT: call void @llvm.memcpy.p0.p0.i64(ptr align 8 %t.private, ptr align 8 %t, i64 8, i1 false)
+; CHECK-NEXT: call void @__kmpc_barrier(
+; CHECK: omp.copy_out:
+; CHECK-NEXT: call void @llvm.memcpy.p0.p0.i64(ptr align 8 %t, ptr align 8 %t.private, i64 8, i1 false)
+
+; OUT: 344817488
+; OUT-NEXT: 7133
+; OUT-NEXT: 2020974968
+; OUT-NEXT: 2001489490
+; OUT-NEXT: 3
+; OUT-NEXT: 1911050070
+; OUT-NEXT: 23967976
+; OUT-NEXT: 1009
+; OUT-NEXT: 335829497
+; OUT-NEXT: 3998
+
+@A = global [1000 x i64] zeroinitializer
+@B = global [1000 x i64] zeroinitializer
+@C = global [100 x [50 x i64]] zeroinitializer
+@D = global [100 x [50 x i64]] zeroinitializer
+@fmt = private constant [5 x i8] c"%ld\0A\00"
+
+declare i32 @printf(ptr, ...)
+
+; scratch array, dead after the loop
+define void @scratch() {
+entry:
+  %t = alloca [4 x i64]
+  br label %h
+
+h:
+  %i = phi i64 [ 0, %entry ], [ %i.n, %body ]
+  %c = icmp slt i64 %i, 1000
+  br i1 %c, label %body, label %x
+
+body:
+  %pa = getelementptr inbounds [1000 x i64], ptr @A, i64 0, i64 %i
+  %v = load i64, ptr %pa
+  %t0 = getelementptr inbounds [4 x i64], ptr %t, i64 0, i64 0
+  store i64 %v, ptr %t0
+  %v2 = mul i64 %v, 3
+  %t1 = getelementptr inbounds [4 x i64], ptr %t, i64 0, i64 1
+  store i64 %v2, ptr %t1
+  %l0 = load i64, ptr %t0
+  %l1 = load i64, ptr %t1
+  %s = add i64 %l0, %l1
+  %s2 = add i64 %s, %i
+  %pb = getelementptr inbounds [1000 x i64], ptr @B, i64 0, i64 %i
+  store i64 %s2, ptr %pb
+  %i.n = add nsw i64 %i, 1
+  br label %h
+
+x:
+  ret void
+}
+
+; scratch array read after the loop (last-private), t[2] untouched by the loop, address hoisted
+define i64 @last_value() {
+entry:
+  %t = alloca [4 x i64]
+  %t2 = getelementptr inbounds [4 x i64], ptr %t, i64 0, i64 2
+  store i64 7, ptr %t2
+  %t0 = getelementptr inbounds [4 x i64], ptr %t, i64 0, i64 0
+  br label %h
+
+h:
+  %i = phi i64 [ 0, %entry ], [ %i.n, %body ]
+  %c = icmp slt i64 %i, 1000
+  br i1 %c, label %body, label %x
+
+body:
+  %pa = getelementptr inbounds [1000 x i64], ptr @A, i64 0, i64 %i
+  %v = load i64, ptr %pa
+  store i64 %v, ptr %t0
+  %v2 = add i64 %v, %i
+  %t1 = getelementptr inbounds [4 x i64], ptr %t, i64 0, i64 1
+  store i64 %v2, ptr %t1
+  %l0 = load i64, ptr %t0
+  %l1 = load i64, ptr %t1
+  %s = mul i64 %l0, %l1
+  %pb = getelementptr inbounds [1000 x i64], ptr @B, i64 0, i64 %i
+  store i64 %s, ptr %pb
+  %i.n = add nsw i64 %i, 1
+  br label %h
+
+x:
+  %r0 = load i64, ptr %t0
+  %t1x = getelementptr inbounds [4 x i64], ptr %t, i64 0, i64 1
+  %r1 = load i64, ptr %t1x
+  %r2 = load i64, ptr %t2
+  %r = add i64 %r0, %r1
+  %rr = mul i64 %r, %r2
+  ret i64 %rr
+}
+
+; read before written in the iteration: carried, not private
+define void @carried() {
+entry:
+  %t = alloca [4 x i64]
+  %t0 = getelementptr inbounds [4 x i64], ptr %t, i64 0, i64 0
+  store i64 0, ptr %t0
+  br label %h
+
+h:
+  %i = phi i64 [ 0, %entry ], [ %i.n, %body ]
+  %c = icmp slt i64 %i, 1000
+  br i1 %c, label %body, label %x
+
+body:
+  %l0 = load i64, ptr %t0
+  %pa = getelementptr inbounds [1000 x i64], ptr @A, i64 0, i64 %i
+  %v = load i64, ptr %pa
+  %s = add i64 %v, %l0
+  store i64 %s, ptr %t0
+  %pb = getelementptr inbounds [1000 x i64], ptr @B, i64 0, i64 %i
+  store i64 %s, ptr %pb
+  %i.n = add nsw i64 %i, 1
+  br label %h
+
+x:
+  ret void
+}
+
+; live after the loop, but only written on some iterations: not private
+define i64 @conditional() {
+entry:
+  %t = alloca [4 x i64]
+  %t0 = getelementptr inbounds [4 x i64], ptr %t, i64 0, i64 0
+  store i64 0, ptr %t0
+  br label %h
+
+h:
+  %i = phi i64 [ 0, %entry ], [ %i.n, %l ]
+  %c = icmp slt i64 %i, 1000
+  br i1 %c, label %body, label %x
+
+body:
+  %pa = getelementptr inbounds [1000 x i64], ptr @A, i64 0, i64 %i
+  %v = load i64, ptr %pa
+  %odd = and i64 %v, 1
+  %isodd = icmp ne i64 %odd, 0
+  br i1 %isodd, label %w, label %l
+
+w:
+  store i64 %v, ptr %t0
+  %l0 = load i64, ptr %t0
+  %pb = getelementptr inbounds [1000 x i64], ptr @B, i64 0, i64 %i
+  store i64 %l0, ptr %pb
+  br label %l
+
+l:
+  %i.n = add nsw i64 %i, 1
+  br label %h
+
+x:
+  %r = load i64, ptr %t0
+  ret i64 %r
+}
+
+; scratch array in the innermost loop of a nest, indexed by the outer loop
+define void @row_scratch() {
+entry:
+  %t = alloca [100 x i64]
+  br label %h0
+
+h0:
+  %i = phi i64 [ 0, %entry ], [ %i.n, %l0 ]
+  %c0 = icmp slt i64 %i, 100
+  br i1 %c0, label %h1p, label %x
+
+h1p:
+  br label %h1
+
+h1:
+  %j = phi i64 [ 0, %h1p ], [ %j.n, %b1 ]
+  %c1 = icmp slt i64 %j, 50
+  br i1 %c1, label %b1, label %l0
+
+b1:
+  %pc = getelementptr inbounds [100 x [50 x i64]], ptr @C, i64 0, i64 %i, i64 %j
+  %v = load i64, ptr %pc
+  %ti = getelementptr inbounds [100 x i64], ptr %t, i64 0, i64 %i
+  %v1 = add i64 %v, %j
+  store i64 %v1, ptr %ti
+  %lt = load i64, ptr %ti
+  %v2 = mul i64 %lt, 5
+  %pd = getelementptr inbounds [100 x [50 x i64]], ptr @D, i64 0, i64 %i, i64 %j
+  store i64 %v2, ptr %pd
+  %j.n = add nsw i64 %j, 1
+  br label %h1
+
+l0:
+  %i.n = add nsw i64 %i, 1
+  br label %h0
+
+x:
+  ret void
+}
+
+; t = a[i]*2; b[i] = t + t*c, with t and c kept in memory
+define void @scalar(i64 %c) {
+entry:
+  %c.addr = alloca i64
+  %t = alloca i64
+  store i64 %c, ptr %c.addr
+  br label %h
+
+h:
+  %i = phi i64 [ 0, %entry ], [ %i.n, %body ]
+  %cmp = icmp slt i64 %i, 1000
+  br i1 %cmp, label %body, label %x
+
+body:
+  %pa = getelementptr inbounds [1000 x i64], ptr @A, i64 0, i64 %i
+  %v = load i64, ptr %pa
+  %v2 = mul i64 %v, 2
+  store i64 %v2, ptr %t
+  %t1 = load i64, ptr %t
+  %t2 = load i64, ptr %t
+  %cv = load i64, ptr %c.addr
+  %m = mul i64 %t2, %cv
+  %s = add i64 %t1, %m
+  %pb = getelementptr inbounds [1000 x i64], ptr @B, i64 0, i64 %i
+  store i64 %s, ptr %pb
+  %i.n = add nsw i64 %i, 1
+  br label %h
+
+x:
+  ret void
+}
+
+; the temporary is used after the loop: its value from the last iteration
+define i64 @scalar_last_value() {
+entry:
+  %t = alloca i64
+  store i64 -1, ptr %t
+  br label %h
+
+h:
+  %i = phi i64 [ 0, %entry ], [ %i.n, %body ]
+  %cmp = icmp slt i64 %i, 1000
+  br i1 %cmp, label %body, label %x
+
+body:
+  %pa = getelementptr inbounds [1000 x i64], ptr @A, i64 0, i64 %i
+  %v = load i64, ptr %pa
+  %v2 = add i64 %v, %i
+  store i64 %v2, ptr %t
+  %t1 = load i64, ptr %t
+  %pb = getelementptr inbounds [1000 x i64], ptr @B, i64 0, i64 %i
+  store i64 %t1, ptr %pb
+  %i.n = add nsw i64 %i, 1
+  br label %h
+
+x:
+  %r = load i64, ptr %t
+  ret i64 %r
+}
+
+; read before it is written: carried
+define void @scalar_carried() {
+entry:
+  %t = alloca i64
+  store i64 0, ptr %t
+  br label %h
+
+h:
+  %i = phi i64 [ 0, %entry ], [ %i.n, %body ]
+  %cmp = icmp slt i64 %i, 1000
+  br i1 %cmp, label %body, label %x
+
+body:
+  %old = load i64, ptr %t
+  %pa = getelementptr inbounds [1000 x i64], ptr @A, i64 0, i64 %i
+  %v = load i64, ptr %pa
+  store i64 %v, ptr %t
+  %s = sub i64 %v, %old
+  %pb = getelementptr inbounds [1000 x i64], ptr @B, i64 0, i64 %i
+  store i64 %s, ptr %pb
+  %i.n = add nsw i64 %i, 1
+  br label %h
+
+x:
+  ret void
+}
+
+define i64 @sum(ptr %p, i64 %n) {
+entry:
+  br label %h
+
+h:
+  %x = phi i64 [ 0, %entry ], [ %x.n, %b ]
+  %s = phi i64 [ 0, %entry ], [ %s.n, %b ]
+  %c = icmp slt i64 %x, %n
+  br i1 %c, label %b, label %e
+
+b:
+  %q = getelementptr inbounds i64, ptr %p, i64 %x
+  %w = load i64, ptr %q
+  %m = mul i64 %w, %x
+  %s.n = add i64 %s, %m
+  %x.n = add i64 %x, 1
+  br label %h
+
+e:
+  ret i64 %s
+}
+
+define void @init() {
+entry:
+  br label %h
+
+h:
+  %i = phi i64 [ 0, %entry ], [ %i.n, %b ]
+  %c = icmp slt i64 %i, 5000
+  br i1 %c, label %b, label %e
+
+b:
+  %v = mul i64 %i, 7
+  %v2 = urem i64 %v, 13
+  %p = getelementptr inbounds i64, ptr @C, i64 %i
+  store i64 %v2, ptr %p
+  %i1 = urem i64 %i, 1000
+  %pa = getelementptr inbounds [1000 x i64], ptr @A, i64 0, i64 %i1
+  store i64 %v2, ptr %pa
+  %i.n = add nsw i64 %i, 1
+  br label %h
+
+e:
+  ret void
+}
+
+define i32 @main() {
+entry:
+  call void @init()
+  call void @scratch()
+  %s1 = call i64 @sum(ptr @B, i64 1000)
+  %r2 = call i64 @last_value()
+  %s2 = call i64 @sum(ptr @B, i64 1000)
+  call void @carried()
+  %s3 = call i64 @sum(ptr @B, i64 1000)
+  %r4 = call i64 @conditional()
+  call void @row_scratch()
+  %s5 = call i64 @sum(ptr @D, i64 5000)
+  call void @scalar(i64 3)
+  %s6 = call i64 @sum(ptr @B, i64 1000)
+  %r7 = call i64 @scalar_last_value()
+  %s7 = call i64 @sum(ptr @B, i64 1000)
+  call void @scalar_carried()
+  %s8 = call i64 @sum(ptr @B, i64 1000)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s1)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %r2)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s2)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s3)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %r4)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s5)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s6)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %r7)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s7)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s8)
+  ret i32 0
+}
@@ -0,0 +1,90 @@
+; RUN: %opt -disable-output -passes='loop(loop-parallelization)' -loop-parallelization-dump %s 2>&1 | %FileCheck %s
+;
+; -O2 turns the indexing of @a into byte offsets (getelementptr i8) and rotates the loops. The offset of the pointer
+; from @a is split back into a row and a column: in @rows every column stays within its row, and the nest is parallel.
+; In @next the column of a[i][j + 1] reaches 64, the first element of the next row, so its subscripts stay unknown and
+; the loop is serial.
+
+; CHECK-LABEL: Analysing loop: loc
+; CHECK-NEXT: Load in: @a
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 99 ] * 1 + var_1[ 0, 63 ] * 0
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 99 ] * 0 + var_1[ 0, 63 ] * 1
+; CHECK-NEXT: Store in: @a
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 99 ] * 1 + var_1[ 0, 63 ] * 0
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 99 ] * 0 + var_1[ 0, 63 ] * 1
+; CHECK-NEXT: Loop is safe to be parallelized
+; CHECK: Outermost loop safe to be parallelized: var_0
+
+; CHECK-LABEL: Analysing loop: loc
+; CHECK-NEXT: Load in: @a
+; CHECK-NEXT: Array index access: UnknownExpr
+; CHECK-NEXT: Array index access: UnknownExpr
+; CHECK-NEXT: Store in: @a
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 98 ] * 1 + var_1[ 0, 63 ] * 0
+; CHECK-NEXT: Array index access: 0 + var_0[ 0, 98 ] * 0 + var_1[ 0, 63 ] * 1
+; CHECK-NEXT: Loop is not safe to be parallelized
+; CHECK: No loop in the nest is safe to be parallelized
+
+@a = global [100 x [64 x i32]] zeroinitializer
+
+; a[i][j] += 1
+define void @rows() {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %row = mul nuw nsw i64 %i, 256
+  %prow = getelementptr inbounds i8, ptr @a, i64 %row
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %col = shl nuw nsw i64 %j, 2
+  %p = getelementptr inbounds i8, ptr %prow, i64 %col
+  %v = load i32, ptr %p
+  %add = add nsw i32 %v, 1
+  store i32 %add, ptr %p
+  %j.next = add nuw nsw i64 %j, 1
+  %inner.done = icmp eq i64 %j.next, 64
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %outer.done = icmp eq i64 %i.next, 100
+  br i1 %outer.done, label %exit, label %outer
+
+exit:
+  ret void
+}
+
+; a[i][j] = a[i][j + 1]
+define void @next() {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %row = mul nuw nsw i64 %i, 256
+  %prow = getelementptr inbounds i8, ptr @a, i64 %row
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %col = shl nuw nsw i64 %j, 2
+  %p = getelementptr inbounds i8, ptr %prow, i64 %col
+  %q = getelementptr inbounds i8, ptr %p, i64 4
+  %v = load i32, ptr %q
+  store i32 %v, ptr %p
+  %j.next = add nuw nsw i64 %j, 1
+  %inner.done = icmp eq i64 %j.next, 64
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %outer.done = icmp eq i64 %i.next, 99
+  br i1 %outer.done, label %exit, label %outer
+
+exit:
+  ret void
+}
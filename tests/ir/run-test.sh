@@ -0,0 +1,27 @@
+#!/bin/bash
+#
+# Runs the "; RUN:" lines of an IR test, as lit would: %opt, %lli, %FileCheck and %loop-par-batch are the commands in
+# the OPT, LLI, FILECHECK and LOOP_PAR_BATCH environment variables, %s is the test, %S its directory and %t a prefix for
+# scratch files, and the first line that fails fails the test. ctest runs every test of this directory with it (see
+# CMakeLists.txt); by hand:
+#
+#   OPT="opt -load-pass-plugin=build/libLoopParallelization.so" LLI="lli -load=/path/to/libomp.so" FILECHECK=FileCheck \
+#       LOOP_PAR_BATCH=build/loop-par-batch tests/ir/run-test.sh tests/ir/openmp.ll /tmp/openmp
+#
+
+test=$1
+scratch=$2
+mkdir -p "$(dirname "$scratch")"
+
+while IFS= read -r line; do
+    command=${line#*RUN: }
+    command=${command//%opt/$OPT}
+    command=${command//%lli/$LLI}
+    command=${command//%FileCheck/$FILECHECK}
+    command=${command//%loop-par-batch/$LOOP_PAR_BATCH}
+    command=${command//%s/$test}
+    command=${command//%S/$(dirname "$test")}
+    command=${command//%t/$scratch}
+    echo "RUN: $command"
+    bash -c "set -o pipefail; $command" || exit 1
+done < <(grep '^; RUN: ' "$test")
@@ -0,0 +1,225 @@
+; RUN: %opt -disable-output -passes=loop-parallelization-tasks -loop-parallelization-dump %s 2>&1 | %FileCheck %s --check-prefix=PLAN
+; RUN: %opt -S -passes=loop-parallelization-tasks %s | %FileCheck %s
+; RUN: %lli %s | %FileCheck %s --check-prefix=OUT
+; RUN: %opt -passes=loop-parallelization-tasks,loop-parallelization-openmp %s -o %t.bc
+; RUN: %lli %t.bc | %FileCheck %s --check-prefix=OUT
+;
+; The serial sibling loops of @kernel run as concurrent sections where no dependence links them: n1 and n2, the
+; recurrences on a and b, together, then n4 and n5, which read a and b, together. The nest n3 in between is left to
+; the OpenMP transform, and n6 reads what n4 writes, so it runs after both sections.
+
+; PLAN: Running 2 loop nests as tasks: loc loc
+; PLAN-NEXT: Running 2 loop nests as tasks: loc loc
+
+; CHECK-LABEL: define void @kernel(
+; CHECK: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @kernel.omp_tasks.1,
+; CHECK: n3.h:
+; CHECK: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @kernel.omp_tasks,
+; CHECK: n6.h:
+; CHECK-LABEL: define internal void @kernel.omp_tasks(
+; CHECK: call void @__kmpc_for_static_init_8u(
+; CHECK: switch i64 %omp.section, label %omp.section.latch [
+; CHECK-NEXT: i64 0, label %omp.section.0
+; CHECK-NEXT: i64 1, label %omp.section.1
+; CHECK-NEXT: ]
+; CHECK: omp.section.0:
+; CHECK-NEXT: br label %n4.h.omp
+; CHECK: omp.section.1:
+; CHECK-NEXT: br label %n5.h.omp
+; CHECK-LABEL: define internal void @kernel.omp_tasks.1(
+; CHECK: omp.section.0:
+; CHECK-NEXT: br label %n1.h.omp
+; CHECK: omp.section.1:
+; CHECK-NEXT: br label %n2.h.omp
+
+; OUT: -5684080318500809032
+; OUT-NEXT: 63989329334000
+; OUT-NEXT: 11183477760
+; OUT-NEXT: 697235561771228760
+; OUT-NEXT: 38230003412424
+; OUT-NEXT: 1028781345323843040
+
+@a = global [4000 x i64] zeroinitializer
+@b = global [4000 x i64] zeroinitializer
+@d = global [4000 x i64] zeroinitializer
+@e = global [4000 x i64] zeroinitializer
+@f = global [4000 x i64] zeroinitializer
+@c = global [64 x [64 x i64]] zeroinitializer
+@fmt = private constant [5 x i8] c"%ld\0A\00"
+
+declare i32 @printf(ptr, ...)
+
+define void @kernel(i64 %n) {
+entry:
+  br label %n1.h
+
+n1.h:
+  %n1.i = phi i64 [ 1, %entry ], [ %n1.in, %n1.b ]
+  %n1.c = icmp slt i64 %n1.i, %n
+  br i1 %n1.c, label %n1.b, label %x1
+
+n1.b:
+  %n1.im = sub nsw i64 %n1.i, 1
+  %n1.q0 = getelementptr inbounds [4000 x i64], ptr @a, i64 0, i64 %n1.im
+  %n1.v0 = load i64, ptr %n1.q0
+  %n1.t = mul nsw i64 %n1.v0, 3
+  %n1.r = add nsw i64 %n1.t, %n1.i
+  %n1.q1 = getelementptr inbounds [4000 x i64], ptr @a, i64 0, i64 %n1.i
+  store i64 %n1.r, ptr %n1.q1
+  %n1.in = add nsw i64 %n1.i, 1
+  br label %n1.h
+
+x1:
+  %m = mul nsw i64 %n, 1
+  br label %n2.h
+
+n2.h:
+  %n2.i = phi i64 [ 1, %x1 ], [ %n2.in, %n2.b ]
+  %n2.c = icmp slt i64 %n2.i, %m
+  br i1 %n2.c, label %n2.b, label %x2
+
+n2.b:
+  %n2.im = sub nsw i64 %n2.i, 1
+  %n2.q0 = getelementptr inbounds [4000 x i64], ptr @b, i64 0, i64 %n2.im
+  %n2.v0 = load i64, ptr %n2.q0
+  %n2.t = shl nsw i64 %n2.i, 1
+  %n2.r = add nsw i64 %n2.v0, %n2.t
+  %n2.q1 = getelementptr inbounds [4000 x i64], ptr @b, i64 0, i64 %n2.i
+  store i64 %n2.r, ptr %n2.q1
+  %n2.in = add nsw i64 %n2.i, 1
+  br label %n2.h
+
+x2:
+  br label %n3.h
+
+n3.h:
+  %n3.i = phi i64 [ 1, %x2 ], [ %n3.in, %n3.l ]
+  %n3.c = icmp slt i64 %n3.i, 64
+  br i1 %n3.c, label %n3.ph, label %x3
+
+n3.ph:
+  br label %n3.jh
+
+n3.jh:
+  %n3.j = phi i64 [ 0, %n3.ph ], [ %n3.jn, %n3.jb ]
+  %n3.jc = icmp slt i64 %n3.j, 64
+  br i1 %n3.jc, label %n3.jb, label %n3.l
+
+n3.jb:
+  %n3.im = sub nsw i64 %n3.i, 1
+  %n3.q0 = getelementptr inbounds [64 x [64 x i64]], ptr @c, i64 0, i64 %n3.im, i64 %n3.j
+  %n3.v0 = load i64, ptr %n3.q0
+  %n3.r = add nsw i64 %n3.v0, %n3.j
+  %n3.q1 = getelementptr inbounds [64 x [64 x i64]], ptr @c, i64 0, i64 %n3.i, i64 %n3.j
+  store i64 %n3.r, ptr %n3.q1
+  %n3.jn = add nsw i64 %n3.j, 1
+  br label %n3.jh
+
+n3.l:
+  %n3.in = add nsw i64 %n3.i, 1
+  br label %n3.h
+
+x3:
+  br label %n4.h
+
+n4.h:
+  %n4.i = phi i64 [ 1, %x3 ], [ %n4.in, %n4.b ]
+  %n4.c = icmp slt i64 %n4.i, %n
+  br i1 %n4.c, label %n4.b, label %x4
+
+n4.b:
+  %n4.im = sub nsw i64 %n4.i, 1
+  %n4.q0 = getelementptr inbounds [4000 x i64], ptr @d, i64 0, i64 %n4.im
+  %n4.v0 = load i64, ptr %n4.q0
+  %n4.qa = getelementptr inbounds [4000 x i64], ptr @a, i64 0, i64 %n4.i
+  %n4.va = load i64, ptr %n4.qa
+  %n4.r = add nsw i64 %n4.v0, %n4.va
+  %n4.q1 = getelementptr inbounds [4000 x i64], ptr @d, i64 0, i64 %n4.i
+  store i64 %n4.r, ptr %n4.q1
+  %n4.in = add nsw i64 %n4.i, 1
+  br label %n4.h
+
+x4:
+  br label %n5.h
+
+n5.h:
+  %n5.i = phi i64 [ 1, %x4 ], [ %n5.in, %n5.b ]
+  %n5.c = icmp slt i64 %n5.i, %n
+  br i1 %n5.c, label %n5.b, label %x5
+
+n5.b:
+  %n5.im = sub nsw i64 %n5.i, 1
+  %n5.q0 = getelementptr inbounds [4000 x i64], ptr @e, i64 0, i64 %n5.im
+  %n5.v0 = load i64, ptr %n5.q0
+  %n5.qa = getelementptr inbounds [4000 x i64], ptr @b, i64 0, i64 %n5.i
+  %n5.va = load i64, ptr %n5.qa
+  %n5.t = add nsw i64 %n5.va, %n5.i
+  %n5.r = xor i64 %n5.v0, %n5.t
+  %n5.q1 = getelementptr inbounds [4000 x i64], ptr @e, i64 0, i64 %n5.i
+  store i64 %n5.r, ptr %n5.q1
+  %n5.in = add nsw i64 %n5.i, 1
+  br label %n5.h
+
+x5:
+  br label %n6.h
+
+n6.h:
+  %n6.i = phi i64 [ 1, %x5 ], [ %n6.in, %n6.b ]
+  %n6.c = icmp slt i64 %n6.i, %n
+  br i1 %n6.c, label %n6.b, label %x6
+
+n6.b:
+  %n6.im = sub nsw i64 %n6.i, 1
+  %n6.q0 = getelementptr inbounds [4000 x i64], ptr @f, i64 0, i64 %n6.im
+  %n6.v0 = load i64, ptr %n6.q0
+  %n6.qa = getelementptr inbounds [4000 x i64], ptr @d, i64 0, i64 %n6.i
+  %n6.va = load i64, ptr %n6.qa
+  %n6.r = add nsw i64 %n6.v0, %n6.va
+  %n6.q1 = getelementptr inbounds [4000 x i64], ptr @f, i64 0, i64 %n6.i
+  store i64 %n6.r, ptr %n6.q1
+  %n6.in = add nsw i64 %n6.i, 1
+  br label %n6.h
+
+x6:
+  ret void
+}
+
+define i64 @sum(ptr %p, i64 %n) {
+entry:
+  br label %h
+
+h:
+  %x = phi i64 [ 0, %entry ], [ %x.n, %b ]
+  %s = phi i64 [ 0, %entry ], [ %s.n, %b ]
+  %c = icmp slt i64 %x, %n
+  br i1 %c, label %b, label %e
+
+b:
+  %q = getelementptr inbounds i64, ptr %p, i64 %x
+  %w = load i64, ptr %q
+  %m = mul i64 %w, %x
+  %s.n = add i64 %s, %m
+  %x.n = add i64 %x, 1
+  br label %h
+
+e:
+  ret i64 %s
+}
+
+define i32 @main() {
+entry:
+  call void @kernel(i64 4000)
+  %s1 = call i64 @sum(ptr @a, i64 4000)
+  %s2 = call i64 @sum(ptr @b, i64 4000)
+  %s3 = call i64 @sum(ptr @c, i64 4096)
+  %s4 = call i64 @sum(ptr @d, i64 4000)
+  %s5 = call i64 @sum(ptr @e, i64 4000)
+  %s6 = call i64 @sum(ptr @f, i64 4000)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s1)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s2)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s3)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s4)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s5)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s6)
+  ret i32 0
+}
@@ -0,0 +1,171 @@
+; RUN: %opt -S -passes=loop-parallelization-versioning %s | %FileCheck %s
+; RUN: %opt -S -passes=loop-parallelization-versioning,loop-parallelization-openmp %s | %FileCheck %s --check-prefix=OPENMP
+; RUN: %lli %s | %FileCheck %s --check-prefix=OUT
+; RUN: %opt -passes=loop-parallelization-versioning,loop-parallelization-openmp %s -o %t.bc
+; RUN: %lli %t.bc | %FileCheck %s --check-prefix=OUT
+;
+; The versioning pass runs the loop over pointer parameters in parallel when the ranges they access, which depend on
+; the trip count, do not overlap, and the loop whose iterations only touch different elements for small trip counts when
+; its trip count is below the bound guard. The calls in main take both paths of both loops. The loop that also counts
+; its iterations with an atomicrmw cannot be annotated, so it is not versioned either.
+
+; CHECK-LABEL: define void @copy(
+; CHECK: %lver.conflict = and i1
+; CHECK: br i1 %lver.conflict, label %header.ph.lver.orig, label %header.ph
+; CHECK: header.lver.orig:
+; CHECK: store i64 %add.lver.orig, ptr %pa.lver.orig
+; CHECK-NOT: !llvm.access.group
+; CHECK: br label %header.lver.orig
+; CHECK: header:
+; CHECK: store i64 %add, ptr %pa, {{.*}}!llvm.access.group
+; CHECK: br label %header, !llvm.loop ![[COPY_LOOP:[0-9]+]]
+; CHECK-LABEL: define void @spread(
+; CHECK: %lver.guard = icmp sgt i64 %{{[0-9]+}}, 499
+; CHECK: br i1 %lver.guard, label %header.ph.lver.orig, label %header.ph
+; CHECK: br label %header, !llvm.loop ![[SPREAD_LOOP:[0-9]+]]
+; CHECK-LABEL: define void @count(
+; CHECK-NOT: lver
+; CHECK-NOT: !llvm.access.group
+; CHECK-LABEL: define i32 @main()
+; CHECK-DAG: ![[COPY_LOOP]] = distinct !{![[COPY_LOOP]], ![[COPY_PARALLEL:[0-9]+]]}
+; CHECK-DAG: ![[COPY_PARALLEL]] = !{!"llvm.loop.parallel_accesses", !{{[0-9]+}}}
+; CHECK-DAG: ![[SPREAD_LOOP]] = distinct !{![[SPREAD_LOOP]], ![[SPREAD_PARALLEL:[0-9]+]]}
+; CHECK-DAG: ![[SPREAD_PARALLEL]] = !{!"llvm.loop.parallel_accesses", !{{[0-9]+}}}
+
+; OPENMP-LABEL: define void @copy(
+; OPENMP: br i1 %lver.conflict, label %header.ph.lver.orig, label %header.ph
+; OPENMP: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @copy.omp_outlined,
+; OPENMP-LABEL: define void @spread(
+; OPENMP: br i1 %lver.guard, label %header.ph.lver.orig, label %header.ph
+; OPENMP: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @spread.omp_outlined,
+
+; OUT: 3995500500 2483270100
+
+@x = global [1000 x i64] zeroinitializer
+@y = global [1000 x i64] zeroinitializer
+@g = global [2000 x i64] zeroinitializer
+@fmt = private constant [9 x i8] c"%ld %ld\0A\00"
+
+declare i32 @printf(ptr, ...)
+
+; a[i] = 2 * b[i] + 1, where a and b may overlap.
+define void @copy(ptr %a, ptr %b, i64 %n) {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, %n
+  br i1 %cond, label %body, label %exit
+
+body:
+  %pb = getelementptr inbounds i64, ptr %b, i64 %i
+  %vb = load i64, ptr %pb
+  %mul = mul nsw i64 %vb, 2
+  %add = add nsw i64 %mul, 1
+  %pa = getelementptr inbounds i64, ptr %a, i64 %i
+  store i64 %add, ptr %pa
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+; g[2 * i] = g[i + 1000] + 1, whose iterations only touch different elements while n <= 500.
+define void @spread(i64 %n) {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, %n
+  br i1 %cond, label %body, label %exit
+
+body:
+  %ir = add nsw i64 %i, 1000
+  %pr = getelementptr inbounds [2000 x i64], ptr @g, i64 0, i64 %ir
+  %vr = load i64, ptr %pr
+  %add = add nsw i64 %vr, 1
+  %iw = shl nsw i64 %i, 1
+  %pw = getelementptr inbounds [2000 x i64], ptr @g, i64 0, i64 %iw
+  store i64 %add, ptr %pw
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+; a[i] = b[i], and *c += 1 atomically.
+define void @count(ptr %a, ptr %b, ptr %c, i64 %n) {
+entry:
+  br label %header
+
+header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %cond = icmp slt i64 %i, %n
+  br i1 %cond, label %body, label %exit
+
+body:
+  %pb = getelementptr inbounds i64, ptr %b, i64 %i
+  %vb = load i64, ptr %pb
+  %pa = getelementptr inbounds i64, ptr %a, i64 %i
+  store i64 %vb, ptr %pa
+  %old = atomicrmw add ptr %c, i64 1 monotonic
+  %i.next = add nsw i64 %i, 1
+  br label %header
+
+exit:
+  ret void
+}
+
+define i32 @main() {
+entry:
+  br label %init.header
+
+init.header:
+  %k = phi i64 [ 0, %entry ], [ %k.next, %init.body ]
+  %init.cond = icmp slt i64 %k, 2000
+  br i1 %init.cond, label %init.body, label %run
+
+init.body:
+  %pg = getelementptr inbounds [2000 x i64], ptr @g, i64 0, i64 %k
+  %k3 = mul nsw i64 %k, 3
+  store i64 %k3, ptr %pg
+  %k.next = add nsw i64 %k, 1
+  br label %init.header
+
+run:
+  call void @copy(ptr @x, ptr @g, i64 1000)
+  call void @copy(ptr @y, ptr @x, i64 1000)
+  %g1 = getelementptr inbounds i64, ptr @g, i64 1
+  call void @copy(ptr @g, ptr %g1, i64 999)
+  call void @spread(i64 400)
+  call void @spread(i64 900)
+  br label %sum.header
+
+sum.header:
+  %q = phi i64 [ 0, %run ], [ %q.next, %sum.body ]
+  %s1 = phi i64 [ 0, %run ], [ %s1.next, %sum.body ]
+  %s2 = phi i64 [ 0, %run ], [ %s2.next, %sum.body ]
+  %sum.cond = icmp slt i64 %q, 1000
+  br i1 %sum.cond, label %sum.body, label %done
+
+sum.body:
+  %py = getelementptr inbounds [1000 x i64], ptr @y, i64 0, i64 %q
+  %vy = load i64, ptr %py
+  %my = mul nsw i64 %vy, %q
+  %s1.next = add nsw i64 %s1, %my
+  %q2 = shl nsw i64 %q, 1
+  %pq = getelementptr inbounds [2000 x i64], ptr @g, i64 0, i64 %q2
+  %vq = load i64, ptr %pq
+  %mq = mul nsw i64 %vq, %q
+  %s2.next = add nsw i64 %s2, %mq
+  %q.next = add nsw i64 %q, 1
+  br label %sum.header
+
+done:
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s1, i64 %s2)
+  ret i32 0
+}
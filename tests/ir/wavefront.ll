@@ -0,0 +1,385 @@
+; RUN: %opt -disable-output -passes=loop-parallelization-openmp -loop-parallelization-dump %s 2>&1 | %FileCheck %s --check-prefix=PLAN
+; RUN: %opt -S -passes=loop-parallelization-openmp %s | %FileCheck %s
+; RUN: %lli %s | %FileCheck %s --check-prefix=OUT
+; RUN: %opt -passes=loop-parallelization-openmp %s -o %t.bc
+; RUN: %lli %t.bc | %FileCheck %s --check-prefix=OUT
+; RUN: %opt -passes=loop-parallelization-openmp -loop-parallelization-wavefront-tile=7 %s -o %t.tile7.bc
+; RUN: %lli %t.tile7.bc | %FileCheck %s --check-prefix=OUT
+;
+; Stencils whose two loops both carry dependences run as wavefronts of tiles, with a barrier between the waves: @k_s0
+; as it is, and @k_s1 and @k_s2, whose dependences point back in the inner loop, skewed by 1 and 2. The Gauss-Seidel
+; sweeps of @k_gs run the same way inside the time loop, which stays serial. Tiles of 7 do not divide the trip counts,
+; so the last tiles of every row and column are partial. The triangular nest of @k_tri has inner bounds that vary with
+; the outer loop, and stays serial.
+
+; PLAN: Parallelizing loop nest as wavefronts: loc on var_0 and var_1, skew 0, tile 32
+; PLAN-NEXT: Parallelizing loop nest as wavefronts: loc on var_0 and var_1, skew 1, tile 32
+; PLAN-NEXT: Parallelizing loop nest as wavefronts: loc on var_0 and var_1, skew 2, tile 32
+; PLAN-NEXT: Parallelizing loop nest as wavefronts: loc on var_1 and var_2, skew 0, tile 32
+; PLAN-NOT: wavefronts
+
+; CHECK-LABEL: define void @k_s0()
+; CHECK: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @k_s0.omp_wavefront,
+; CHECK-LABEL: define void @k_gs()
+; CHECK: h0:
+; CHECK: call void (ptr, i32, ptr, ...) @__kmpc_fork_call(ptr @{{[0-9]+}}, i32 1, ptr @k_gs.omp_wavefront,
+; CHECK: %t.n = add nsw i64 %t, 1
+; CHECK-LABEL: define void @k_tri()
+; CHECK-NOT: __kmpc_fork_call
+; CHECK-LABEL: define i64 @sum(
+; CHECK-LABEL: define internal void @k_s0.omp_wavefront(
+; CHECK: %omp.rows = udiv i64 %{{[0-9]+}}, 32
+; CHECK: %omp.columns = udiv i64 %{{[0-9]+}}, 32
+; CHECK: omp.wave.header:
+; CHECK: call void @__kmpc_for_static_init_8u(
+; CHECK: omp.tile.body:
+; CHECK-NEXT: %omp.row = add i64 %omp.first_row, %omp.tile
+; CHECK-NEXT: %omp.column = sub i64 %omp.wave, %omp.row
+; CHECK: omp.wave.latch:
+; CHECK: call void @__kmpc_barrier(
+
+; OUT: 4051547698407450842
+; OUT-NEXT: -4280935615797253517
+; OUT-NEXT: 5449728704887481101
+; OUT-NEXT: 1496362050884957095
+; OUT-NEXT: 4803696164632991464
+
+@a = global [100 x [120 x i64]] zeroinitializer
+@b = global [100 x [120 x i64]] zeroinitializer
+@c = global [100 x [120 x i64]] zeroinitializer
+@d = global [100 x [120 x i64]] zeroinitializer
+@e = global [100 x [120 x i64]] zeroinitializer
+@fmt = private constant [5 x i8] c"%ld\0A\00"
+
+declare i32 @printf(ptr, ...)
+
+define void @k_s0() {
+entry:
+  br label %h0
+
+h0:
+  %i = phi i64 [ 1, %entry ], [ %i.n, %l0 ]
+  %c0 = icmp slt i64 %i, 100
+  br i1 %c0, label %b0, label %e0
+
+b0:
+  br label %h1
+
+h1:
+  %j = phi i64 [ 1, %b0 ], [ %j.n, %l1 ]
+  %c1 = icmp slt i64 %j, 120
+  br i1 %c1, label %b1, label %e1
+
+b1:
+  %im = sub nsw i64 %i, 1
+  %ip = add nsw i64 %i, 1
+  %jm = sub nsw i64 %j, 1
+  %jp = add nsw i64 %j, 1
+  %x.p = getelementptr inbounds [100 x [120 x i64]], ptr @a, i64 0, i64 %im, i64 %j
+  %x = load i64, ptr %x.p
+  %y.p = getelementptr inbounds [100 x [120 x i64]], ptr @a, i64 0, i64 %i, i64 %jm
+  %y = load i64, ptr %y.p
+  %y3 = mul i64 %y, 3
+  %r0 = add i64 %x, %y3
+  %r = add i64 %r0, %i
+  %st.p = getelementptr inbounds [100 x [120 x i64]], ptr @a, i64 0, i64 %i, i64 %j
+  store i64 %r, ptr %st.p
+  br label %l1
+
+l1:
+  %j.n = add nsw i64 %j, 1
+  br label %h1
+
+e1:
+  br label %l0
+
+l0:
+  %i.n = add nsw i64 %i, 1
+  br label %h0
+
+e0:
+  ret void
+}
+
+define void @k_s1() {
+entry:
+  br label %h0
+
+h0:
+  %i = phi i64 [ 1, %entry ], [ %i.n, %l0 ]
+  %c0 = icmp slt i64 %i, 100
+  br i1 %c0, label %b0, label %e0
+
+b0:
+  br label %h1
+
+h1:
+  %j = phi i64 [ 1, %b0 ], [ %j.n, %l1 ]
+  %c1 = icmp slt i64 %j, 119
+  br i1 %c1, label %b1, label %e1
+
+b1:
+  %im = sub nsw i64 %i, 1
+  %ip = add nsw i64 %i, 1
+  %jm = sub nsw i64 %j, 1
+  %jp = add nsw i64 %j, 1
+  %x.p = getelementptr inbounds [100 x [120 x i64]], ptr @b, i64 0, i64 %im, i64 %jp
+  %x = load i64, ptr %x.p
+  %y.p = getelementptr inbounds [100 x [120 x i64]], ptr @b, i64 0, i64 %i, i64 %jm
+  %y = load i64, ptr %y.p
+  %x5 = mul i64 %x, 5
+  %r0 = xor i64 %x5, %y
+  %r = add i64 %r0, %j
+  %st.p = getelementptr inbounds [100 x [120 x i64]], ptr @b, i64 0, i64 %i, i64 %j
+  store i64 %r, ptr %st.p
+  br label %l1
+
+l1:
+  %j.n = add nsw i64 %j, 1
+  br label %h1
+
+e1:
+  br label %l0
+
+l0:
+  %i.n = add nsw i64 %i, 1
+  br label %h0
+
+e0:
+  ret void
+}
+
+define void @k_s2() {
+entry:
+  br label %h0
+
+h0:
+  %i = phi i64 [ 1, %entry ], [ %i.n, %l0 ]
+  %c0 = icmp slt i64 %i, 100
+  br i1 %c0, label %b0, label %e0
+
+b0:
+  br label %h1
+
+h1:
+  %j = phi i64 [ 2, %b0 ], [ %j.n, %l1 ]
+  %c1 = icmp slt i64 %j, 118
+  br i1 %c1, label %b1, label %e1
+
+b1:
+  %im = sub nsw i64 %i, 1
+  %ip = add nsw i64 %i, 1
+  %jm = sub nsw i64 %j, 1
+  %jp = add nsw i64 %j, 1
+  %jm2 = sub nsw i64 %j, 2
+  %jp2 = add nsw i64 %j, 2
+  %x.p = getelementptr inbounds [100 x [120 x i64]], ptr @c, i64 0, i64 %im, i64 %jp2
+  %x = load i64, ptr %x.p
+  %y.p = getelementptr inbounds [100 x [120 x i64]], ptr @c, i64 0, i64 %i, i64 %jm
+  %y = load i64, ptr %y.p
+  %z.p = getelementptr inbounds [100 x [120 x i64]], ptr @c, i64 0, i64 %im, i64 %jm2
+  %z = load i64, ptr %z.p
+  %y7 = mul i64 %y, 7
+  %r0 = sub i64 %x, %y7
+  %r1 = add i64 %r0, %z
+  %r = add i64 %r1, %i
+  %st.p = getelementptr inbounds [100 x [120 x i64]], ptr @c, i64 0, i64 %i, i64 %j
+  store i64 %r, ptr %st.p
+  br label %l1
+
+l1:
+  %j.n = add nsw i64 %j, 1
+  br label %h1
+
+e1:
+  br label %l0
+
+l0:
+  %i.n = add nsw i64 %i, 1
+  br label %h0
+
+e0:
+  ret void
+}
+
+define void @k_gs() {
+entry:
+  br label %h0
+
+h0:
+  %t = phi i64 [ 0, %entry ], [ %t.n, %l0 ]
+  %c0 = icmp slt i64 %t, 5
+  br i1 %c0, label %b0, label %e0
+
+b0:
+  br label %h1
+
+h1:
+  %i = phi i64 [ 1, %b0 ], [ %i.n, %l1 ]
+  %c1 = icmp slt i64 %i, 99
+  br i1 %c1, label %b1, label %e1
+
+b1:
+  br label %h2
+
+h2:
+  %j = phi i64 [ 1, %b1 ], [ %j.n, %l2 ]
+  %c2 = icmp slt i64 %j, 120
+  br i1 %c2, label %b2, label %e2
+
+b2:
+  %im = sub nsw i64 %i, 1
+  %ip = add nsw i64 %i, 1
+  %jm = sub nsw i64 %j, 1
+  %jp = add nsw i64 %j, 1
+  %n.p = getelementptr inbounds [100 x [120 x i64]], ptr @d, i64 0, i64 %im, i64 %j
+  %n = load i64, ptr %n.p
+  %s.p = getelementptr inbounds [100 x [120 x i64]], ptr @d, i64 0, i64 %ip, i64 %j
+  %s = load i64, ptr %s.p
+  %w.p = getelementptr inbounds [100 x [120 x i64]], ptr @d, i64 0, i64 %i, i64 %jm
+  %w = load i64, ptr %w.p
+  %e.p = getelementptr inbounds [100 x [120 x i64]], ptr @d, i64 0, i64 %i, i64 %jp
+  %e = load i64, ptr %e.p
+  %r0 = add i64 %n, %s
+  %r1 = mul i64 %w, 3
+  %r2 = xor i64 %r0, %r1
+  %r3 = add i64 %r2, %e
+  %r = add i64 %r3, %t
+  %st.p = getelementptr inbounds [100 x [120 x i64]], ptr @d, i64 0, i64 %i, i64 %j
+  store i64 %r, ptr %st.p
+  br label %l2
+
+l2:
+  %j.n = add nsw i64 %j, 1
+  br label %h2
+
+e2:
+  br label %l1
+
+l1:
+  %i.n = add nsw i64 %i, 1
+  br label %h1
+
+e1:
+  br label %l0
+
+l0:
+  %t.n = add nsw i64 %t, 1
+  br label %h0
+
+e0:
+  ret void
+}
+
+define void @k_tri() {
+entry:
+  br label %h0
+
+h0:
+  %i = phi i64 [ 1, %entry ], [ %i.n, %l0 ]
+  %c0 = icmp slt i64 %i, 100
+  br i1 %c0, label %b0, label %e0
+
+b0:
+  br label %h1
+
+h1:
+  %j = phi i64 [ 1, %b0 ], [ %j.n, %l1 ]
+  %c1 = icmp slt i64 %j, %i
+  br i1 %c1, label %b1, label %e1
+
+b1:
+  %im = sub nsw i64 %i, 1
+  %ip = add nsw i64 %i, 1
+  %jm = sub nsw i64 %j, 1
+  %jp = add nsw i64 %j, 1
+  %x.p = getelementptr inbounds [100 x [120 x i64]], ptr @e, i64 0, i64 %im, i64 %j
+  %x = load i64, ptr %x.p
+  %y.p = getelementptr inbounds [100 x [120 x i64]], ptr @e, i64 0, i64 %i, i64 %jm
+  %y = load i64, ptr %y.p
+  %r0 = add i64 %x, %y
+  %r = add i64 %r0, 1
+  %st.p = getelementptr inbounds [100 x [120 x i64]], ptr @e, i64 0, i64 %i, i64 %j
+  store i64 %r, ptr %st.p
+  br label %l1
+
+l1:
+  %j.n = add nsw i64 %j, 1
+  br label %h1
+
+e1:
+  br label %l0
+
+l0:
+  %i.n = add nsw i64 %i, 1
+  br label %h0
+
+e0:
+  ret void
+}
+
+define i64 @sum(ptr %p, i64 %n) {
+entry:
+  br label %h
+
+h:
+  %x = phi i64 [ 0, %entry ], [ %x.n, %b ]
+  %s = phi i64 [ 0, %entry ], [ %s.n, %b ]
+  %c = icmp slt i64 %x, %n
+  br i1 %c, label %b, label %e
+
+b:
+  %q = getelementptr inbounds i64, ptr %p, i64 %x
+  %w = load i64, ptr %q
+  %m = mul i64 %w, %x
+  %s.n = add i64 %s, %m
+  %x.n = add i64 %x, 1
+  br label %h
+
+e:
+  ret i64 %s
+}
+
+define i32 @main(i32 %argc, ptr %argv) {
+entry:
+  br label %ih
+
+ih:
+  %k = phi i64 [ 0, %entry ], [ %k.n, %ib ]
+  %kc = icmp slt i64 %k, 12000
+  br i1 %kc, label %ib, label %run
+
+ib:
+  %kk = mul i64 %k, 2654435761
+  %k2 = lshr i64 %kk, 7
+  %pa = getelementptr inbounds i64, ptr @a, i64 %k
+  store i64 %k2, ptr %pa
+  %pb = getelementptr inbounds i64, ptr @b, i64 %k
+  store i64 %k2, ptr %pb
+  %pc = getelementptr inbounds i64, ptr @c, i64 %k
+  store i64 %k2, ptr %pc
+  %pd = getelementptr inbounds i64, ptr @d, i64 %k
+  store i64 %k2, ptr %pd
+  %pe = getelementptr inbounds i64, ptr @e, i64 %k
+  store i64 %k2, ptr %pe
+  %k.n = add i64 %k, 1
+  br label %ih
+
+run:
+  call void @k_s0()
+  call void @k_s1()
+  call void @k_s2()
+  call void @k_gs()
+  call void @k_tri()
+  %s1 = call i64 @sum(ptr @a, i64 12000)
+  %s2 = call i64 @sum(ptr @b, i64 12000)
+  %s3 = call i64 @sum(ptr @c, i64 12000)
+  %s4 = call i64 @sum(ptr @d, i64 12000)
+  %s5 = call i64 @sum(ptr @e, i64 12000)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s1)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s2)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s3)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s4)
+  call i32 (ptr, ...) @printf(ptr @fmt, i64 %s5)
+  ret i32 0
+}
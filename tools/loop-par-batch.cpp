@@ -0,0 +1,151 @@
+#include "LoopParallelization.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LLVMRemarkStreamer.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Remarks/RemarkStreamer.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+/*
+ * Batch driver: runs the pre-pipeline of the README and the analysis on many IR or bitcode files in one process, on a
+ * thread pool, and writes the reports of all modules, in the order of the inputs, to one file. The optimization remarks
+ * of all modules can be merged into one YAML file in the same way.
+ */
+
+static cl::list<std::string> InputFilenames(cl::Positional, cl::OneOrMore, cl::desc("<input .ll/.bc files>"));
+
+static cl::opt<std::string> OutputFilename("o", cl::init("-"), cl::value_desc("filename"),
+                                           cl::desc("Merged report (default: stdout)"));
+
+static cl::opt<std::string> RemarksFilename("remarks-output", cl::value_desc("filename"),
+                                            cl::desc("Merged YAML optimization remarks of loop-parallelization"));
+
+static cl::opt<unsigned> Threads("j", cl::init(0), cl::desc("Number of worker threads (default: all cores)"));
+
+static cl::opt<std::string> Pipeline("passes", cl::init("mem2reg,simplifycfg,loop-simplify,loop(loop-parallelization)"),
+                                     cl::desc("Pipeline run on every module"));
+
+namespace {
+    /*
+     * Run the pipeline on one file in a context of its own, so workers never share LLVM state, and write its report to
+     * report. The remarks of the module are serialized to remarks. Returns false if the file or the pipeline could not
+     * be parsed, in which case the report holds the error.
+     */
+    bool analyseFile(const std::string &Filename, std::string &report, std::string &remarks) {
+        raw_string_ostream reportStream(report);
+        raw_string_ostream remarksStream(remarks);
+
+        LLVMContext Context;
+        if (!RemarksFilename.empty()) {
+            if (Error E = setupLLVMOptimizationRemarks(Context, remarksStream, "loop-parallelization", "yaml",
+                                                       /* RemarksWithHotness = */ false)) {
+                reportStream << "loop-par-batch: " << toString(std::move(E)) << "\n";
+                return false;
+            }
+        }
+        SMDiagnostic Err;
+        std::unique_ptr<Module> M = parseIRFile(Filename, Err, Context);
+        if (!M) {
+            Err.print("loop-par-batch", reportStream);
+            return false;
+        }
+
+        LoopAnalysisManager LAM;
+        FunctionAnalysisManager FAM;
+        CGSCCAnalysisManager CGAM;
+        ModuleAnalysisManager MAM;
+        PassBuilder PB;
+        getParallelizePassInfo().RegisterPassBuilderCallbacks(PB);
+        PB.registerModuleAnalyses(MAM);
+        PB.registerCGSCCAnalyses(CGAM);
+        PB.registerFunctionAnalyses(FAM);
+        PB.registerLoopAnalyses(LAM);
+        PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+        ModulePassManager MPM;
+        if (Error E = PB.parsePassPipeline(MPM, Pipeline)) {
+            reportStream << "loop-par-batch: " << toString(std::move(E)) << "\n";
+            return false;
+        }
+
+        setLoopParallelizationReport(&reportStream);
+        MPM.run(*M, MAM);
+        setLoopParallelizationReport(nullptr);
+        // The serializer writes to remarksStream, which has to go before the string is read.
+        Context.setLLVMRemarkStreamer(nullptr);
+        Context.setMainRemarkStreamer(nullptr);
+        remarksStream.flush();
+        reportStream.flush();
+        return true;
+    }
+}
+
+int main(int argc, char **argv) {
+    InitLLVM X(argc, argv);
+    // The report is the point of the driver, so the verdicts are printed unless -loop-parallelization-dump=false.
+    setLoopParallelizationDumpDefault(true);
+    cl::ParseCommandLineOptions(argc, argv, "loop parallelization batch driver\n");
+
+    std::error_code EC;
+    ToolOutputFile Out(OutputFilename, EC, sys::fs::OF_Text);
+    if (EC) {
+        errs() << "loop-par-batch: " << OutputFilename << ": " << EC.message() << "\n";
+        return 1;
+    }
+    std::unique_ptr<ToolOutputFile> RemarksOut;
+    if (!RemarksFilename.empty()) {
+        RemarksOut = std::make_unique<ToolOutputFile>(RemarksFilename, EC, sys::fs::OF_Text);
+        if (EC) {
+            errs() << "loop-par-batch: " << RemarksFilename << ": " << EC.message() << "\n";
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> reports(InputFilenames.size()), remarks(InputFilenames.size());
+    // A vector<bool> packs its elements into shared words, which the workers must not write concurrently.
+    std::vector<char> succeeded(InputFilenames.size());
+    {
+        DefaultThreadPool Pool(hardware_concurrency(Threads));
+        for (size_t i = 0; i < InputFilenames.size(); ++i)
+            Pool.async([&reports, &remarks, &succeeded, i] {
+                succeeded[i] = analyseFile(InputFilenames[i], reports[i], remarks[i]);
+            });
+        Pool.wait();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+    size_t failures = 0;
+    for (size_t i = 0; i < InputFilenames.size(); ++i) {
+        Out.os() << "## " << InputFilenames[i] << "\n" << reports[i];
+        if (!succeeded[i]) {
+            errs() << "loop-par-batch: " << InputFilenames[i] << " failed\n";
+            ++failures;
+        }
+    }
+    Out.keep();
+
+    // Every remark is a YAML document of its own, so the files can simply be concatenated.
+    if (RemarksOut) {
+        for (const std::string &moduleRemarks : remarks)
+            RemarksOut->os() << moduleRemarks;
+        RemarksOut->keep();
+    }
+
+    errs() << "Analysed " << InputFilenames.size() - failures << " of " << InputFilenames.size() << " modules in "
+           << format("%.2f", elapsed.count()) << "s\n";
+    return failures ? 1 : 0;
+}